@@ -4,6 +4,8 @@
 #include <DEM/HostSideHelpers.hpp>
 #include <DEM/utils/Samplers.hpp>
 
+#include "utils/StepSize.hpp"
+
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -43,8 +45,6 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         DEMSim.SetMaterialPropertyPair("mu", mat_type_terrain, mat_type_analyticalb, 0.67);
         DEMSim.SetMaterialPropertyPair("mu", mat_type_terrain, mat_type_flexibleb, 0.67);
 
-        // Step size
-        float step_size = 1e-5;
         float world_size = 0.5;
 
         // Analytical boundary definition
@@ -80,6 +80,19 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         float terrain_rad = 0.01;
         auto template_terrain = DEMSim.LoadSphereType(terrain_rad * terrain_rad * terrain_rad * 2.69e3 * 4/3 * 3.141, terrain_rad, mat_type_terrain);
 
+        // Step sizes: the bulk step serves the terrain and the analytical walls, and only while the steel cube is
+        // about to hit or is still moving on the bed is each bulk step split into sub-steps
+        StableStepController step_controller;
+        step_controller.SetSafetyFactor(0.2);
+        step_controller.AddParticleTemplate(template_terrain);
+        step_controller.AddWallMaterial(mat_type_analyticalb);
+        step_controller.AddWallMaterial(mat_type_flexibleb);
+        step_controller.AddWallMaterial(mat_type_cube, true);
+        float impact_vel = std::sqrt(2 * 9.81 * std::max(drop_height - fill_height, 0.f));
+        step_controller.ShowStats(impact_vel);
+        MultiRateStepper stepper(step_controller, impact_vel);
+        stepper.Watch(DEMSim.Track(projectile), cube_thickness / 2);
+
         // Terrain sampling
         HCPSampler sampler(terrain_rad * 2.2);
         float3 fill_center = make_float3(0, 0, fill_height/2 + 2 * terrain_rad);
@@ -89,9 +102,11 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
 
         std::cout << "Total num of particles: " << particles->GetNumClumps() << std::endl;
         std::cout << "Total num of spheres: " << particles->GetNumSpheres() << std::endl;
+        // Bed top for the stepper
+        auto max_z_finder = DEMSim.CreateInspector("clump_max_z");
 
         // Initialization of simulation
-        DEMSim.SetInitTimeStep(step_size);
+        DEMSim.SetInitTimeStep(stepper.GetBulkStep());
         DEMSim.SetGravitationalAcceleration(make_float3(0, 0 , -9.81));
         DEMSim.SetMaxVelocity(15.);
 
@@ -146,6 +161,7 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
             writeFloat3VectorsToCSV(force_csv_header, {points, forces}, force_filename, num_force_pairs);
             curr_frame++;
             num_force_pairs = bottom_tracker->GetContactForces(points, forces);
+            stepper.Update(DEMSim, frame_time, max_z_finder->GetValue() + terrain_rad);
             DEMSim.DoDynamicsThenSync(frame_time);
             DEMSim.ShowThreadCollaborationStats();
         }
@@ -155,6 +171,7 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         std::cout << time_sec.count() << " seconds (wall time) to finish the simulation" << std::endl;
 
         // Post simulation housekeeping
+        stepper.ShowStats();
         DEMSim.ShowTimingStats();
         DEMSim.ShowAnomalies();
         std::cout << "Simulation exiting" << std::endl;
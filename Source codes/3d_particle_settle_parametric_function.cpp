@@ -4,6 +4,9 @@
 #include <DEM/HostSideHelpers.hpp>
 #include <DEM/utils/Samplers.hpp>
 
+#include "utils/PrimitiveMesh.hpp"
+#include "utils/Quiescence.hpp"
+
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -91,16 +94,15 @@ int main() {
                     float cube_thickness = 0.05 * world_size;
                     float cube_size = 0.5 * world_size;
 
-                    // Add the impact cube to the simulation
-                    auto projectile = DEMSim.AddWavefrontMeshObject((GET_DATA_PATH() / "mesh/cube.obj").string(), mat_type_cube);
-                    projectile->Scale(make_float3(cube_size, cube_size, cube_thickness));
-                    projectile->SetInitPos(make_float3(0.0, 0.0, drop_height));
+                    // Add the impact cube to the simulation, built at its plate size with mass and MOI from its mesh
                     float cube_density = 7.6e3;
-                    float cube_mass = cube_density * (cube_size * cube_size * cube_thickness);
-                    projectile->SetMass(cube_mass);
-                    projectile->SetMOI(make_float3(cube_mass * 1 / 6, cube_mass * 1 / 6, cube_mass * 1 / 6));
+                    PrimitiveMesh cube_mesh = MakeBox(make_float3(cube_size, cube_size, cube_thickness));
+                    auto projectile = AddPrimitiveMesh(DEMSim, cube_mesh, (master_dir / "cube.obj").string(), mat_type_cube,
+                                                       cube_density);
+                    projectile->SetInitPos(make_float3(0.0, 0.0, drop_height));
                     projectile->SetFamily(2);
                     DEMSim.SetFamilyFixed(2);
+                    auto projectile_tracker = DEMSim.Track(projectile);
 
                     // Define the terrain particles
                     float terrain_rad = 0.08;
@@ -112,16 +114,33 @@ int main() {
                     float3 fill_halfsize = make_float3(world_size / 2, world_size / 2, fill_height / 2);
                     auto input_xyz = sampler.SampleBox(fill_center, fill_halfsize);
                     auto particles = DEMSim.AddClumps(template_terrain, input_xyz);
+                    auto particle_tracker = DEMSim.Track(particles);
 
                     std::cout << "Total num of particles: " << particles->GetNumClumps() << std::endl;
                     std::cout << "Total num of spheres: " << particles->GetNumSpheres() << std::endl;
 
+                    // Particles that have come to rest during settling are put to sleep (family 9, fixed) and
+                    // woken up again when a fast neighbor comes near them or their load changes. Everything is
+                    // woken before the drop: sleepers are rigid between checks, which would stiffen the bed under
+                    // the bottom-wall force measured there.
+                    bool sleep_while_settling = true;
+                    QuiescenceManager sleeper(DEMSim, 9);
+                    if (sleep_while_settling) {
+                        sleeper.SetSleepThresholds(1e-3, 0.05 * 9.81, 5);
+                        sleeper.SetWakeThresholds(5e-3, 3 * terrain_rad, 0.1 * 9.81);
+                        sleeper.Configure();
+                    }
+
                     // Initialize the simulation
                     DEMSim.SetInitTimeStep(step_size);
                     DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
                     DEMSim.SetMaxVelocity(15.);
                     DEMSim.Initialize();
 
+                    if (sleep_while_settling) {
+                        sleeper.Watch(particle_tracker, particles->GetNumClumps(), 0);
+                    }
+
                     // Create output directory based on parameters within the master directory
                     path out_dir = master_dir / ("BottomBoundary_E_" + std::to_string(static_cast<int>(E_bottom))) /
                                    ("SidePlanes_E_" + std::to_string(static_cast<int>(E_side))) /
@@ -151,8 +170,15 @@ int main() {
                         curr_frame++;
                         num_force_pairs = bottom_tracker->GetContactForces(points, forces);
                         DEMSim.DoDynamicsThenSync(frame_time);
+                        if (sleep_while_settling) {
+                            sleeper.Update(frame_time);
+                        }
                         DEMSim.ShowThreadCollaborationStats();
                     }
+                    if (sleep_while_settling) {
+                        sleeper.ShowStats();
+                        sleeper.WakeAll();
+                    }
 
                     // Drop the cube
                     DEMSim.ChangeFamily(2, 1);
@@ -4,6 +4,11 @@
 #include <DEM/HostSideHelpers.hpp>
 #include <DEM/utils/Samplers.hpp>
 
+#include "utils/BedIO.hpp"
+#include "utils/LoadTable.hpp"
+#include "utils/StepSize.hpp"
+#include "utils/Timeline.hpp"
+
 #include <cstdio>
 #include <chrono>
 #include <filesystem>
@@ -58,10 +63,6 @@ int main() {
     // Defining some of the quantities that are used later for this script.
     float terrain_rad = 0.01;
     float gravityMagnitude = 9.81;
-    // See Equation (4) in Zhang et al. (2024).
-    float DTc = PI * terrain_rad * sqrt((sp_gr*1000) / (1e7 / (2 * (1 + 0.33)))) / (0.8766 + 0.163 * 0.33);
-    // float step_size = 5 * 1.0e-5 * sqrt(terrain_rad * gravityMagnitude);
-    float step_size = 0.1 * DTc;
     double world_sizeX = 122.0 * terrain_rad;  // 122.0 works fine for frictionless
     double world_sizeZ = 27 * terrain_rad;
 
@@ -80,22 +81,12 @@ int main() {
 
     // Loading the position of the spheres from an external file.
     //! Note that this list does not include the particle located at (0.0,0.0).
-    auto data_xyz = DEMSim.ReadClumpXyzFromCsv("./data/clumps/ContactChain_initial.csv");
-    std::vector<float3> input_xyz;
-
-    std::vector<std::shared_ptr<DEMClumpTemplate>> input_pile_template_type;
-
-    std::cout << data_xyz.size() << " Data points are loaded from the external list." << std::endl;
+    BedData bed = ReadBedCsv("./data/clumps/ContactChain_initial.csv");
+    std::vector<float3> input_xyz = bed.xyz;
 
-    for (unsigned int i = 0; i < data_xyz.size(); i++) {
-        char t_name[20];
-        sprintf(t_name, "%d", i);
+    std::vector<std::shared_ptr<DEMClumpTemplate>> input_pile_template_type(bed.size(), templates_terrain[0]);
 
-        auto this_type_xyz = data_xyz[std::string(t_name)];
-        input_xyz.insert(input_xyz.end(), this_type_xyz.begin(), this_type_xyz.end());
-
-        input_pile_template_type.push_back(templates_terrain[0]);
-    }
+    std::cout << bed.size() << " Data points are loaded from the external list." << std::endl;
 
     auto allParticles = DEMSim.AddClumps(input_pile_template_type, input_xyz);
     allParticles->SetFamily(1);
@@ -110,19 +101,42 @@ int main() {
     float Aext = -gravityMagnitude * (massMultiplier);
     //float timeApplication = 101.355 * (2*terrain_rad) * (2*terrain_rad) * sqrt(massMultiplier * sp_gr);
     float timeApplication = 3.0;
-    std::string Aext_pattern = to_string_with_precision(Aext) + "*sin(2*3.14159*t/" + to_string_with_precision(timeApplication / 5) + ")";
-    DEMSim.AddFamilyPrescribedAcc(2, "none", "none", Aext_pattern);
+    // The load acts on the driver while it is in family 2. By default it is the sinusoid
+    // Aext*sin(2*PI*t/(timeApplication/5)) in simulation time t, prescribed on the device. A measured history can be
+    // dropped in as ./data/loads/driver_acc.csv (time since load application, acceleration in z); it is then applied
+    // from the host through the tracker before every step of the load window, at the cost of one call per step.
+    bool use_load_table = exists("./data/loads/driver_acc.csv");
+    TimeSeriesTable load_table;
+    if (use_load_table) {
+        load_table.LoadCsv("./data/loads/driver_acc.csv");
+        load_table.SetInterpolation(TABLE_INTERP::CUBIC);
+    } else {
+        std::string Aext_pattern = to_string_with_precision(Aext) + "*sin(2*3.14159*t/" +
+                                   to_string_with_precision(timeApplication / 5) + ")";
+        DEMSim.AddFamilyPrescribedAcc(2, "none", "none", Aext_pattern);
+    }
 
     std::cout << "Total num of particles: " << (int)input_pile_template_type.size() + 1 << "." << std::endl;
 
+    // The step size is derived from the loaded templates and the boundary material: 0.1 of the Rayleigh step (see
+    // Equation (4) in Zhang et al. (2024)), or less if a Hertzian impact at the max velocity would be under-resolved.
+    StableStepController step_controller;
+    step_controller.SetSafetyFactor(0.1);
+    for (const auto& tmpl : templates_terrain) {
+        step_controller.AddParticleTemplate(tmpl);
+    }
+    step_controller.AddWallMaterial(mat_type_terrain);
+    // Peak speed of the driver particle under the sinusoidal acceleration
+    float driver_peak_vel = std::abs(Aext) * (timeApplication / 5) / (2 * PI);
+    float step_size = step_controller.GetStepSize(driver_peak_vel);
+    step_controller.ShowStats(driver_peak_vel);
+
     DEMSim.SetInitTimeStep(step_size);
     DEMSim.SetMaxVelocity(30.);
     DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -gravityMagnitude));
 
     DEMSim.Initialize();
 
-    float sim_time = 20.0;
-    float time_settling = 5.0;
     unsigned int fps = 5;
     float frame_time = 1.0 / fps;
     unsigned int out_steps = (unsigned int)(1.0 / (fps * step_size));
@@ -131,9 +145,26 @@ int main() {
     unsigned int currframe = 0;
     double terrain_max_z;
 
-    bool status = true;
-    bool changeMaterial = true;
-    bool familyReverted = false;
+    // All phase changes are scheduled up front, so the output loop does not need zero-length syncs around them. The
+    // times are those the original frame-by-frame checks ended up with: each condition was tested a frame after it
+    // held, and the load window was run in one 3 s sync while the loop time stood still. So the material swap comes
+    // at 2.8 s, the load acts from 5.4 s to 11.4 s and the run ends at 23 s.
+    float material_time = 2.8;
+    float load_start = 5.4;
+    float load_end = 11.4;
+    float sim_time = 23.0;
+    EventTimeline timeline(step_size);
+    // Past half the 5 s settling, the targeted properties for the material are applied.
+    timeline.SetFamilyClumpMaterialAt(material_time, 1, mat_type_terrain);
+    // Once the settling is up, we apply the external force...
+    timeline.ChangeFamilyAt(load_start, 3, 2);
+    if (use_load_table) {
+        timeline.During(load_start, load_end, [&](DEMSolver&, double t_load) {
+            driver->AddAcc(make_float3(0, 0, load_table.Sample(t_load)));
+        });
+    }
+    // ... and revert the family change after the load application.
+    timeline.ChangeFamilyAt(load_end, 2, 3);
 
     for (float t = 0; t < sim_time; t += frame_time) {
         std::cout << "Output file: " << currframe << " at time " << t << " s." << std::endl;
@@ -145,29 +176,7 @@ int main() {
         DEMSim.WriteContactFile(std::string(cnt_filename));
         currframe++;
 
-        DEMSim.DoDynamicsThenSync(frame_time);
-        // Half time through the settling, the targeted properties for the material are applied.
-        if (t > time_settling / 2 && changeMaterial) {
-            DEMSim.DoDynamicsThenSync(0);
-            std::cout << "Including restitution coefficient." << std::endl;
-            changeMaterial = false;
-            DEMSim.SetFamilyClumpMaterial(1, mat_type_terrain);
-        }
-        // Once the settling is up, we apply the external force.
-        if (t > time_settling && status) {
-            DEMSim.DoDynamicsThenSync(0);
-            DEMSim.ChangeFamily(3, 2);
-            std::cout << "Ramping up the applied load for " << timeApplication << " s." << std::endl;
-            status = false;
-            DEMSim.DoDynamicsThenSync(timeApplication);
-        }
-        // Revert the family change after the load application time has elapsed.
-        if (t > time_settling + timeApplication && !familyReverted) {
-            DEMSim.DoDynamicsThenSync(0);
-            DEMSim.ChangeFamily(2, 3);
-            std::cout << "Reverting the family change after the load application." << std::endl;
-            familyReverted = true;
-        }
+        timeline.AdvanceTo(DEMSim, t + frame_time);
     }
 
     DEMSim.ShowTimingStats();
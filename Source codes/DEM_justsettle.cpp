@@ -7,7 +7,8 @@
 #include <cstdio>
 #include <chrono>
 #include <filesystem>
-#include <random>
+
+#include "utils/CounterRNG.hpp"
 
 using namespace deme;
 using namespace std::filesystem;
@@ -48,14 +49,11 @@ int main() {
     auto sample_center = make_float3(0, 0, fullheight / 2 + 1 * terrain_rad);
     auto input_xyz = sampler.SampleBox(sample_center, make_float3(sample_halfwidth, 0.f, fullheight / 2.));
 
-    // Random selection of templates for each particle
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> dist(0, templates_terrain.size() - 1);
-
+    // Random selection of templates for each particle, reproducible for a given DEME_DRIVERS_SEED
+    CounterRNG rng(GetGlobalSeed());
     std::vector<std::shared_ptr<DEMClumpTemplate>> template_to_use(input_xyz.size());
     for (unsigned int i = 0; i < input_xyz.size(); i++) {
-        template_to_use[i] = templates_terrain[dist(gen)];
+        template_to_use[i] = templates_terrain[rng.Stream(i).UniformInt(templates_terrain.size())];
     }
     DEMSim.AddClumps(template_to_use, input_xyz);
 
@@ -19,9 +19,19 @@
 #include <time.h>
 #include <filesystem>
 
+#include "utils/Lattice.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
+// Square rows in x and z, packed sqrt(3) * R apart in y
+struct CloseRowLattice {
+    static constexpr int dim = 3;
+    static constexpr int num_basis = 1;
+    static float3 Step() { return make_float3(1.f, 0.8660254f, 1.f); }
+    static float3 Site(int i, int j, int k, int b) { return make_float3(i, 0.8660254f * j, k); }
+};
+
 int main() {
     DEMSolver DEMSim;
     DEMSim.SetVerbosity(INFO);
@@ -30,9 +40,6 @@ int main() {
     DEMSim.EnsureKernelErrMsgLineNum();
     DEMSim.SetErrorOutVelocity(2000.);
 
-    // srand(time(NULL));
-    srand(4150);
-
     //defining the material type
     auto mat_type_1 =
         DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.8}, {"mu", 0.3}, {"Crr", 0.01}});
@@ -51,22 +58,16 @@ int main() {
     std::vector<std::shared_ptr<DEMClumpTemplate>> clump_types;
 
     // Generate the custom lattice
+    LatticeGenerator<CloseRowLattice> lattice(particleDiameter);
     for (int layer = 0; layer < totalLayers; ++layer) {
         int layerCountX = baseLayerCountX - layer; // Decrease the number of particles for every other layer for a triangular lattice structure
         int layerCountY = static_cast<int>(std::round(0.1 * layerCountX)); // number of particles in the y-direction would essentially be 10% of that in the y-direction, rounded to the nearest integer
-        for (int y = 0; y < layerCountY; ++y) {
-            for (int x = 0; x < layerCountX; ++x) {
-                
-                //positions of particles in each layer in z-direction
-                
-                float xPos = x * particleDiameter;
-                float yPos = y * sqrt(3) * R; // Keeping the close packing in y
-                float zPos = layer * particleDiameter; // Stack the layers directly on top of each other
-
-                positions.push_back(make_float3(xPos, yPos, zPos));
-                clump_types.push_back(sph_type_1); // Assume sph_type_1 is defined as before
-            }
-        }
+        // Layers are stacked directly on top of each other
+        auto layer_xyz = lattice.Generate(make_float3(-0.5f * R, -0.5f * R, (layer - 0.5f) * particleDiameter),
+                                          make_float3((layerCountX - 0.5f) * particleDiameter,
+                                                      (layerCountY - 0.5f) * sqrt(3) * R, (layer + 0.5f) * particleDiameter));
+        positions.insert(positions.end(), layer_xyz.begin(), layer_xyz.end());
+        clump_types.insert(clump_types.end(), layer_xyz.size(), sph_type_1);
     }
 
     auto particles = DEMSim.AddClumps(clump_types, positions);
@@ -17,6 +17,8 @@
 #include <chrono>
 #include <filesystem>
 
+#include "utils/PrimitiveMesh.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
@@ -47,15 +49,16 @@ int main() {
     float dropobj_height = 0.025;
     float dropobj_width = 6.5;
 
-    auto projectile = DEMSim.AddWavefrontMeshObject((GET_DATA_PATH() / "mesh/cube.obj").string(), mat_type_ball);
-    std::cout << "Total num of triangles: " << projectile->GetNumTriangles() << std::endl;
+    path out_dir = current_path();
+    out_dir += "/DemoOutput_CUBEDrop";
+    create_directory(out_dir);
 
-    projectile->Scale(make_float3(dropobj_width, dropobj_width, dropobj_height));
+    // A thin steel plate built at its exact size, so its MOI is a plate's and not a cube's
+    PrimitiveMesh plate_mesh = MakeBox(make_float3(dropobj_width, dropobj_width, dropobj_height));
+    auto projectile = AddPrimitiveMesh(DEMSim, plate_mesh, (out_dir / "plate.obj").string(), mat_type_ball, 7.8e3);
+    std::cout << "Total num of triangles: " << projectile->GetNumTriangles() << std::endl;
 
     projectile->SetInitPos(make_float3(world_size / 2, world_size / 2, cube_pos));
-    float ball_mass = 7.8e3;
-    projectile->SetMass(ball_mass);
-    projectile->SetMOI(make_float3(ball_mass * 1 / 6, ball_mass * 1 / 6, ball_mass * 1 / 6));
     projectile->SetFamily(2);
     DEMSim.SetFamilyFixed(2);
 
@@ -101,10 +104,6 @@ int main() {
 
     DEMSim.Initialize();
 
-    path out_dir = current_path();
-    out_dir += "/DemoOutput_CUBEDrop";
-    create_directory(out_dir);
-
     float sim_time = 6.0;
     float settle_time = 2.0;
     float compressor_vel = 0.01;
@@ -0,0 +1,146 @@
+// DEM force model: Hertz-Mindlin contact in parallel with a breakable bond (linear parallel bond, PFC style).
+//
+// Use with:
+//   SetMustHaveMatProp({"E", "nu", "CoR", "mu", "pb_E", "pb_kratio", "pb_ten", "pb_coh", "pb_rmul", "pb_gap",
+//                       "pb_install"})
+//   SetMustPairwiseMatProp({"CoR", "mu"})
+//   SetPerContactWildcards({"delta_time", "delta_tan_x", "delta_tan_y", "delta_tan_z", "pb_state", "pb_fn",
+//                           "pb_fs_x", "pb_fs_y", "pb_fs_z"})
+//
+// Bond properties are per material; a pair uses the mean stiffness and the weaker strength of its two materials.
+//   pb_E, pb_kratio: bond modulus and normal-to-shear stiffness ratio; kn = pb_E / (RA + RB), ks = kn / pb_kratio
+//   pb_ten, pb_coh:  tensile and shear strength (stress)
+//   pb_rmul:         bond radius as a fraction of the smaller sphere radius; 0 never bonds (walls, meshes)
+//   pb_gap:          largest gap between two surfaces that still gets bonded
+//   pb_install:      1 while bonds are being installed, 0 otherwise. Swap the particles' material (e.g. with
+//                    SetFamilyClumpMaterial) to a copy with 1 for a step or two: every contact within pb_gap is then
+//                    bonded, stress free; contacts made later are not.
+//
+// pb_state is 0 for an unbonded contact, 1 for a bonded one and 2 once its bond broke; a broken bond never forms
+// again. The bond force is incremental: pb_fn (tension positive) and the shear force pb_fs grow with the relative
+// motion of the pair. The bond breaks as soon as pb_fn / A exceeds pb_ten or |pb_fs| / A exceeds pb_coh, A being the
+// bond's cross section; it then carries nothing, and the pair is left with the plain Hertz-Mindlin contact. The bond
+// carries forces only; bending and twisting moments are not modelled.
+//
+// Bonded pairs must stay in the contact list while they are apart, so give the particle family an extra margin of
+// at least pb_gap (SetFamilyExtraMargin); the Hertz-Mindlin part is skipped for pairs that do not overlap.
+
+// Material properties
+float E_cnt, G_cnt, CoR_cnt, mu_cnt;
+{
+    // E and nu are associated with each material, so obtain them this way
+    float E_A = E[bodyAMatType];
+    float nu_A = nu[bodyAMatType];
+    float E_B = E[bodyBMatType];
+    float nu_B = nu[bodyBMatType];
+    matProxy2ContactParam<float>(E_cnt, G_cnt, E_A, nu_A, E_B, nu_B);
+    // CoR and mu are pair-wise, so obtain them this way
+    CoR_cnt = CoR[bodyAMatType][bodyBMatType];
+    mu_cnt = mu[bodyAMatType][bodyBMatType];
+}
+
+float3 rotVelCPA, rotVelCPB;
+{
+    // We also need the relative velocity between A and B in global frame to use in the damping terms
+    // To get that, we need contact points' rotational velocity in GLOBAL frame
+    // This is local rotational velocity (the portion of linear vel contributed by rotation)
+    rotVelCPA = cross(ARotVel, locCPA);
+    rotVelCPB = cross(BRotVel, locCPB);
+    // This is mapping from local rotational velocity to global
+    applyOriQToVector3<float, deme::oriQ_t>(rotVelCPA.x, rotVelCPA.y, rotVelCPA.z, AOriQ.w, AOriQ.x, AOriQ.y, AOriQ.z);
+    applyOriQToVector3<float, deme::oriQ_t>(rotVelCPB.x, rotVelCPB.y, rotVelCPB.z, BOriQ.w, BOriQ.x, BOriQ.y, BOriQ.z);
+}
+
+// The (total) relative linear velocity of A relative to B, split into normal and tangential parts
+const float3 velB2A = (ALinVel + rotVelCPA) - (BLinVel + rotVelCPB);
+const float projection = dot(velB2A, B2A);
+const float3 vrel_tan = velB2A - projection * B2A;
+
+// Hertz-Mindlin part, for overlapping pairs only
+float3 delta_tan = make_float3(delta_tan_x, delta_tan_y, delta_tan_z);
+if (overlapDepth > 0) {
+    // Contact history
+    {
+        delta_tan += ts * vrel_tan;
+        const float disp_proj = dot(delta_tan, B2A);
+        delta_tan -= disp_proj * B2A;
+        delta_time += ts;
+    }
+
+    const float mass_eff = (AOwnerMass * BOwnerMass) / (AOwnerMass + BOwnerMass);
+    const float sqrt_Rd = sqrt(overlapDepth * (ARadius * BRadius) / (ARadius + BRadius));
+    const float Sn = 2. * E_cnt * sqrt_Rd;
+
+    const float loge = (CoR_cnt < DEME_TINY_FLOAT) ? log(DEME_TINY_FLOAT) : log(CoR_cnt);
+    const float beta = loge / sqrt(loge * loge + deme::PI_SQUARED);
+
+    const float k_n = deme::TWO_OVER_THREE * Sn;
+    const float gamma_n = deme::TWO_TIMES_SQRT_FIVE_OVER_SIX * beta * sqrt(Sn * mass_eff);
+    force += (k_n * overlapDepth + gamma_n * projection) * B2A;
+
+    const float kt = 8. * G_cnt * sqrt_Rd;
+    const float gt = -deme::TWO_TIMES_SQRT_FIVE_OVER_SIX * beta * sqrt(mass_eff * kt);
+    float3 tangent_force = -kt * delta_tan - gt * vrel_tan;
+    const float ft = length(tangent_force);
+    if (ft > DEME_TINY_FLOAT) {
+        // Reverse-engineer to get tangential displacement
+        const float ft_max = length(force) * mu_cnt;
+        if (ft > ft_max) {
+            tangent_force = (ft_max / ft) * tangent_force;
+            delta_tan = (tangent_force + gt * vrel_tan) / (-kt);
+        }
+    } else {
+        tangent_force = make_float3(0, 0, 0);
+    }
+    force += tangent_force;
+} else {
+    delta_tan = make_float3(0, 0, 0);
+}
+delta_tan_x = delta_tan.x;
+delta_tan_y = delta_tan.y;
+delta_tan_z = delta_tan.z;
+
+// Parallel bond part; a broken bond costs one comparison
+if (pb_state < 2.f) {
+    const float pb_rmul_cnt = fminf(pb_rmul[bodyAMatType], pb_rmul[bodyBMatType]);
+    if (pb_state < 0.5f && pb_rmul_cnt > 0.f && fminf(pb_install[bodyAMatType], pb_install[bodyBMatType]) > 0.f &&
+        overlapDepth > -fminf(pb_gap[bodyAMatType], pb_gap[bodyBMatType])) {
+        pb_state = 1.f;
+        pb_fn = 0.f;
+        pb_fs_x = 0.f;
+        pb_fs_y = 0.f;
+        pb_fs_z = 0.f;
+    }
+    if (pb_state > 0.5f) {
+        const float pb_r = pb_rmul_cnt * fminf(ARadius, BRadius);
+        const float pb_area = deme::PI * pb_r * pb_r;
+        const float pb_kn = 0.5f * (pb_E[bodyAMatType] + pb_E[bodyBMatType]) / (ARadius + BRadius);
+        const float pb_ks = pb_kn / (0.5f * (pb_kratio[bodyAMatType] + pb_kratio[bodyBMatType]));
+
+        // Normal: tension grows as the pair separates
+        pb_fn += pb_kn * pb_area * projection * ts;
+        // Shear: turn the old shear force into the current tangent plane, keeping its size, then add the increment
+        float3 pb_fs = make_float3(pb_fs_x, pb_fs_y, pb_fs_z);
+        const float fs_old = length(pb_fs);
+        pb_fs -= dot(pb_fs, B2A) * B2A;
+        const float fs_rot = length(pb_fs);
+        if (fs_rot > DEME_TINY_FLOAT) {
+            pb_fs *= fs_old / fs_rot;
+        }
+        pb_fs -= (pb_ks * pb_area * ts) * vrel_tan;
+
+        const float pb_sigma = pb_fn / pb_area;
+        const float pb_tau = length(pb_fs) / pb_area;
+        if (pb_sigma > fminf(pb_ten[bodyAMatType], pb_ten[bodyBMatType]) ||
+            pb_tau > fminf(pb_coh[bodyAMatType], pb_coh[bodyBMatType])) {
+            pb_state = 2.f;
+            pb_fn = 0.f;
+            pb_fs = make_float3(0, 0, 0);
+        } else {
+            force += pb_fs - pb_fn * B2A;
+        }
+        pb_fs_x = pb_fs.x;
+        pb_fs_y = pb_fs.y;
+        pb_fs_z = pb_fs.z;
+    }
+}
@@ -4,6 +4,8 @@
 #include <DEM/HostSideHelpers.hpp>
 #include <DEM/utils/Samplers.hpp>
 
+#include "../utils/StepSize.hpp"
+
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -42,8 +44,6 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         auto mat_type_flexibleb = DEMSim.LoadMaterial({{"E", E_side}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.3}, {"Crr", 0.01}});
         DEMSim.SetMaterialPropertyPair("mu", mat_type_terrain, mat_type_analyticalb, 0.5);
 
-        // Step size
-        float step_size = 1e-4;
         float world_size = 2;
 
         // Analytical boundary definition
@@ -79,6 +79,17 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         float terrain_rad = 0.001;
         auto template_terrain = DEMSim.LoadSphereType(terrain_rad * terrain_rad * terrain_rad * 2.69e3 * 4/3 * 3.141, terrain_rad, mat_type_terrain);
 
+        // Step size: 1 mm particles at E = 1e8 need a much shorter step than the 1e-4 used before, and the impact
+        // speed of the cube on the bed sets the Hertzian limit
+        StableStepController step_controller;
+        step_controller.SetSafetyFactor(0.2);
+        step_controller.AddParticleTemplate(template_terrain);
+        step_controller.AddWallMaterial(mat_type_analyticalb);
+        step_controller.AddWallMaterial(mat_type_flexibleb);
+        step_controller.AddWallMaterial(mat_type_cube);
+        float impact_vel = std::sqrt(2 * 9.81 * (drop_height - fill_height));
+        step_controller.ShowStats(impact_vel);
+
         // Terrain sampling
         HCPSampler sampler(terrain_rad * 2.2);
         float3 fill_center = make_float3(0, 0, fill_height/2 + 2 * terrain_rad);
@@ -90,9 +101,10 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         std::cout << "Total num of spheres: " << particles->GetNumSpheres() << std::endl;
 
         // Initialization of simulation
-        DEMSim.SetInitTimeStep(step_size);
+        step_controller.Apply(DEMSim, impact_vel);
         DEMSim.SetGravitationalAcceleration(make_float3(0, 0 , -9.81));
         DEMSim.SetMaxVelocity(15.);
+        auto max_v_finder = DEMSim.CreateInspector("clump_max_absv");
 
         DEMSim.Initialize();
 
@@ -144,6 +156,8 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
             curr_frame++;
             num_force_pairs = bottom_tracker->GetContactForces(points, forces);
             DEMSim.DoDynamicsThenSync(frame_time);
+            // The step follows the peak velocity of the bed through the impact
+            step_controller.Adapt(DEMSim, std::max(max_v_finder->GetValue(), impact_vel));
             DEMSim.ShowThreadCollaborationStats();
         }
 
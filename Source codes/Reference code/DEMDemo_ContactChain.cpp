@@ -21,6 +21,8 @@
 #include <filesystem>
 #include <random>
 
+#include "../utils/BedIO.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
@@ -77,22 +79,12 @@ int main() {
 
     // Loading the position of the spheres from an external file.
     //! Note that this list does not include the particle located at (0.0,0.0).
-    auto data_xyz = DEMSim.ReadClumpXyzFromCsv("./data/clumps/ContactChain_initial.csv");
-    std::vector<float3> input_xyz;
-
-    std::vector<std::shared_ptr<DEMClumpTemplate>> input_pile_template_type;
-
-    std::cout << data_xyz.size() << " Data points are loaded from the external list." << std::endl;
+    BedData bed = ReadBedCsv("./data/clumps/ContactChain_initial.csv");
+    std::vector<float3> input_xyz = bed.xyz;
 
-    for (unsigned int i = 0; i < data_xyz.size(); i++) {
-        char t_name[20];
-        sprintf(t_name, "%d", i);
+    std::vector<std::shared_ptr<DEMClumpTemplate>> input_pile_template_type(bed.size(), templates_terrain[0]);
 
-        auto this_type_xyz = data_xyz[std::string(t_name)];
-        input_xyz.insert(input_xyz.end(), this_type_xyz.begin(), this_type_xyz.end());
-
-        input_pile_template_type.push_back(templates_terrain[0]);
-    }
+    std::cout << bed.size() << " Data points are loaded from the external list." << std::endl;
 
     auto allParticles = DEMSim.AddClumps(input_pile_template_type, input_xyz);
     allParticles->SetFamily(1);
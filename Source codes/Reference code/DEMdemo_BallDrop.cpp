@@ -17,18 +17,13 @@
 #include <cstdio>
 #include <chrono>
 #include <filesystem>
-#include <random>
+
+#include "../utils/BedIO.hpp"
+#include "../utils/CounterRNG.hpp"
 
 using namespace deme;
 using namespace std::filesystem;
 
-double randomBetween0and1() {
-    static std::mt19937 gen(std::random_device{}());                       // Random number generator
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);  // Uniform distribution between 0 and 1
-
-    return distribution(gen);
-}
-
 int main() {
     float ball_densities[] = {2.2e3, 3.8e3, 7.8e3, 15e3};
     float Hs[] = {0.05, 0.1, 0.2};
@@ -100,23 +95,16 @@ int main() {
                 char cp_filename[200];
                 sprintf(cp_filename, "%s/bed.csv", out_dir.c_str());
 
-                auto clump_xyz = DEMSim.ReadClumpXyzFromCsv(std::string(cp_filename));
-                auto clump_quaternion = DEMSim.ReadClumpQuatFromCsv(std::string(cp_filename));
-                for (int i = 0; i < templates_terrain.size(); i++) {
-                    char t_name[20];
-                    sprintf(t_name, "%04d", i);
-
-                    auto this_xyz = clump_xyz[std::string(t_name)];
-                    auto this_quaternion = clump_quaternion[std::string(t_name)];
-                    auto batch = DEMSim.AddClumps(templates_terrain[i], this_xyz);
-                    batch->SetOriQ(this_quaternion);
-                    num_particle += this_quaternion.size();
-                }
+                // One parallel pass over the bed file (or its binary copy, after the first reload)
+                BedData bed = LoadBed(std::string(cp_filename));
+                auto bed_templates =
+                    bed.TemplatesByName([&](const std::string& name) { return templates_terrain.at(std::stoi(name)); });
+                auto batch = DEMSim.AddClumps(bed_templates, bed.xyz);
+                batch->SetOriQ(bed.quat);
+                num_particle += bed.size();
             } else {
-                std::random_device rd;   // Random number device to seed the generator
-                std::mt19937 gen(rd());  // Mersenne Twister generator
-                std::uniform_int_distribution<> dist(
-                    0, templates_terrain.size() - 1);  // Uniform distribution of integers between 0 and n
+                // Template of particle n drawn from its own stream, so the bed is reproducible
+                CounterRNG rng(GetGlobalSeed());
 
                 PDSampler sampler(2.01 * terrain_rad);
                 while (sample_z < fullheight) {
@@ -125,7 +113,8 @@ int main() {
                         sampler.SampleBox(sample_center, make_float3(sample_halfwidth, sample_halfwidth, 0.000001));
                     std::vector<std::shared_ptr<DEMClumpTemplate>> template_to_use(input_xyz.size());
                     for (unsigned int i = 0; i < input_xyz.size(); i++) {
-                        template_to_use[i] = templates_terrain[dist(gen)];
+                        template_to_use[i] =
+                            templates_terrain[rng.Stream(num_particle + i).UniformInt(templates_terrain.size())];
                     }
                     DEMSim.AddClumps(template_to_use, input_xyz);
                     num_particle += input_xyz.size();
@@ -17,18 +17,12 @@
 #include <cstdio>
 #include <chrono>
 #include <filesystem>
-#include <random>
+
+#include "../utils/CounterRNG.hpp"
 
 using namespace deme;
 using namespace std::filesystem;
 
-double randomBetween0and1() {
-    static std::mt19937 gen(std::random_device{}());                       // Random number generator
-    static std::uniform_real_distribution<double> distribution(0.0, 1.0);  // Uniform distribution between 0 and 1
-
-    return distribution(gen);
-}
-
 int main() {
     float ball_density = 6.2e3;
     float H = 0.1;
@@ -92,10 +86,8 @@ int main() {
     float sample_halfwidth = world_size / 2 - 2 * terrain_rad;
     float init_v = 0.01;
 
-    std::random_device rd;   // Random number device to seed the generator
-    std::mt19937 gen(rd());  // Mersenne Twister generator
-    std::uniform_int_distribution<> dist(
-        0, templates_terrain.size() - 1);  // Uniform distribution of integers between 0 and n
+    // Template of each particle drawn from its own stream, so the bed is reproducible
+    CounterRNG rng(GetGlobalSeed());
 
     // HCPSampler sampler(2.01 * terrain_rad); // to be tested
     PDSampler sampler(2.01 * terrain_rad);
@@ -104,7 +96,7 @@ int main() {
     auto input_xyz = sampler.SampleBox(sample_center, make_float3(sample_halfwidth, 0.f, fullheight / 2.));
     std::vector<std::shared_ptr<DEMClumpTemplate>> template_to_use(input_xyz.size());
     for (unsigned int i = 0; i < input_xyz.size(); i++) {
-        template_to_use[i] = templates_terrain[dist(gen)];
+        template_to_use[i] = templates_terrain[rng.Stream(i).UniformInt(templates_terrain.size())];
     }
     DEMSim.AddClumps(template_to_use, input_xyz);
     num_particle += input_xyz.size();
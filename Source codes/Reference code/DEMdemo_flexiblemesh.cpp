@@ -21,8 +21,13 @@
 #include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <memory>
 #include <vector>
 
+#include "../utils/ClumpBuilder.hpp"
+#include "../utils/MembraneSolver.hpp"
+#include "../utils/MeshNodeBuffer.hpp"
+
 using namespace deme;
 const double math_PI = 3.1415927;
 const std::string force_csv_header = "point_x,point_y,point_z,force_x,force_y,force_z";
@@ -68,15 +73,11 @@ int main() {
     walls->AddPlane(make_float3(0, -world_size / 2, 0), make_float3(0, 1, 0), mat_type_mesh);
 
     // Define the terrain particle templates
-    // Calculate its mass and MOI
+    // Its volume and MOI are integrated over the union of its spheres rather than taken as those of a unit sphere
     float terrain_density = 2.6e3;
-    double clump_vol = 4. / 3. * math_PI;
-    float mass = terrain_density * clump_vol;
-    float3 MOI = make_float3(2. / 5.) * mass;
-    // Then load it to system
-    std::shared_ptr<DEMClumpTemplate> my_template =
-        DEMSim.LoadClumpType(mass, MOI, GetDEMEDataFile("clumps/spiky_sphere.csv"), mat_type_particle);
-    my_template->SetVolume(clump_vol);
+    ClumpBuilder clump_builder;
+    clump_builder.SetSpheres(ReadClumpCsv(GetDEMEDataFile("clumps/spiky_sphere.csv")));
+    std::shared_ptr<DEMClumpTemplate> my_template = clump_builder.Load(DEMSim, terrain_density, mat_type_particle);
     // Decide the scalings of the templates we just created (so that they are... like particles, not rocks)
     double scale = 0.05;
     my_template->Scale(scale);
@@ -178,13 +179,37 @@ int main() {
         DEMSim.DoDynamics(frame_time);
     }
 
-    // It's possible that you don't have to update the mesh every time step so you can set this number larger than 1.
-    // However, you have to then ensure the simulation does not de-stabilize because the mesh--particles contacts are
-    // running in a delayed fashion and large penetrations can occur. If the mesh is super soft, then it's probably OK.
-    int ts_per_mesh_update = 5;
+    // The mesh update only writes the node array in place and sends it, so it is cheap enough to do every time step.
+    // You can set this number larger than 1, but then the mesh--particles contacts run in a delayed fashion and large
+    // penetrations can occur, which may de-stabilize the simulation. If the mesh is super soft, then it's probably OK.
+    int ts_per_mesh_update = 1;
     // Some constants that are used to define the artificial mesh motion. You'll see in the main simulation loop.
     float max_wave_magnitude = 0.3;
     float wave_period = 3.0;
+    // How much each node `waves', from its resting location. Remember z = 1 is where the highest (relative) mesh
+    // node is. Again, this is artificial and only for showcasing this utility.
+    std::vector<float> node_wave_weight(node_resting_location.size());
+    for (size_t i = 0; i < node_resting_location.size(); i++) {
+        node_wave_weight[i] = std::pow((1. - node_resting_location[i].z) / 2., 2) * max_wave_magnitude;
+    }
+    // A persistent copy of the RELATIVE (to the CoM) node locations that we deform in place and send to the solver
+    MeshNodeBuffer mesh_nodes(flex_mesh_tracker);
+
+    // Instead of the artificial wave, the plate can deform under the particles' contact forces, as a membrane solved
+    // by explicit finite elements with its top edge attached to the ceiling. Both faces of the plate are membranes, so
+    // each takes half of its thickness.
+    bool use_membrane_solver = false;
+    std::unique_ptr<MembraneSolver> membrane;
+    if (use_membrane_solver) {
+        float top_z = -1e10;
+        for (const auto& node : node_resting_location) {
+            top_z = std::max(top_z, node.z);
+        }
+        membrane = std::make_unique<MembraneSolver>(flex_mesh_tracker, 0.025, 1e7, 0.3, 1.5e3);
+        membrane->FixNodesWhere([&](const float3& node) { return node.z > top_z - 1e-3; });
+        membrane->SetDamping(50.);
+        std::cout << "Membrane stable time step: " << membrane->GetStableStep() << std::endl;
+    }
 
     // Main simulation loop starts...
     std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
@@ -201,56 +226,42 @@ int main() {
             num_force_pairs = flex_mesh_tracker->GetContactForces(points, forces);
             writeFloat3VectorsToCSV(force_csv_header, {points, forces}, force_filename, num_force_pairs);
             DEMSim.ShowThreadCollaborationStats();
+            if (membrane) {
+                membrane->ShowStats();
+            }
         }
 
         // We probably don't have to update the mesh every time step
         if (step_count % ts_per_mesh_update == 0) {
-            // For real use cases, you probably will use an external solver to solve the defomration of the mesh,
-            // then feed it to DEME. Here, we create an artificial defomration pattern for the mesh based on mesh node
-            // location and time. This is just for show.
-
-            // First, get where the mesh nodes are currently.
-            std::vector<float3> node_current_location = flex_mesh_tracker->GetMeshNodesGlobal();
-            // If you need the current RELATIVE (to the CoM) locations of the mesh nodes instead of global coordinates,
-            // you can get it like the following:
-            // std::vector<float3> node_current_location(mesh_handle->GetCoordsVertices());
-
-            // Now calculate how much each node should `wave' and update the node location array. Remember z = 1 is
-            // where the highest (relative) mesh node is. Again, this is artificial and only for showcasing this
-            // utility.
-            for (unsigned int i = 0; i < node_current_location.size(); i++) {
-                // Use resting locations to calculate the magnitude of waving for nodes...
-                float my_wave_distance = std::pow((1. - node_resting_location[i].z) / 2., 2) * max_wave_magnitude *
-                                         std::sin(t / wave_period * 2 * math_PI);
-                // Then update the current location array...
-                node_current_location[i].x = node_resting_location[i].x + my_wave_distance;
-            }
-
-            // Now instruct the mesh to deform. Two things to pay attention to:
-
-            // 1. We should respect the actual CoM location of the mesh. We get the global coords of mesh nodes using
-            // GetMeshNodesGlobal, but UpdateMesh works with mesh's local or say relative coordinates, and that is why
-            // we do applyFrameTransformGlobalToLocal first. And depending on your setup, the CoM and coord frame of
-            // your mesh might be moving, and if it moves and rotates then you probably need to move and rotate the
-            // points you got to offset the influence of CoM and local frame first. That said, if you use
-            // mesh_handle->GetCoordsVertices() as I mentioned above to get the relative node positions of the mesh,
-            // then no need to applyFrameTransformGlobalToLocal the CoM and rotate the frame.
-
-            // 2. UpdateMesh will update the relative locations of mesh nodes to your specified locations. But if you
-            // just have the information on the amount of mesh deformation, then you can use UpdateMeshByIncrement
-            // instead, to incremenet mesh nodes' relative locations.
-
-            float3 mesh_CoM_pos = flex_mesh_tracker->Pos();
-            float4 mesh_frame_oriQ = flex_mesh_tracker->OriQ();
-            for (auto& node : node_current_location) {
-                applyFrameTransformGlobalToLocal(node, mesh_CoM_pos, mesh_frame_oriQ);
+            if (membrane) {
+                // The contact forces load the membrane, which then catches up with the DEM time since the last update,
+                // in as many sub-steps as its own stable time step needs, and writes the nodes back to the mesh.
+                num_force_pairs = flex_mesh_tracker->GetContactForces(points, forces);
+                membrane->ApplyContactForces(points, forces, num_force_pairs, 2 * scale);
+                membrane->Advance(ts_per_mesh_update * step_size);
+            } else {
+                // For real use cases, you probably will use a solver to solve the defomration of the mesh, such as
+                // the membrane above or an external one, then feed it to DEME. Here, we create an artificial
+                // defomration pattern for the mesh based on mesh node location and time. This is just for show.
+
+                // The nodes are written in the mesh's local, or say relative, coordinates, which is what UpdateMesh
+                // works with, so neither the CoM location nor the frame of the mesh is involved, and nothing is read
+                // back from the solver. If your solver gives global coordinates instead, use mesh_nodes.SetFromGlobal,
+                // which moves them into the mesh frame in one batch; mesh_nodes.GetGlobal gives the global coordinates
+                // if you need them. If you just have the amount of mesh deformation, add it to the nodes in place.
+                float wave = std::sin(t / wave_period * 2 * math_PI);
+                float3* node = mesh_nodes.Local();
+                for (size_t i = 0; i < mesh_nodes.size(); i++) {
+                    node[i].x = node_resting_location[i].x + node_wave_weight[i] * wave;
+                }
+                // Sends the nodes with UpdateMesh, unless none of them moved since the last time
+                mesh_nodes.Flush();
+
+                // Forces need to be extracted, if you want to use an external solver to solve the mesh's deformation.
+                // You can do it like shown below. In this example, we did not use it other than writing it to a file;
+                // however you may want to feed the array directly to your soild mechanics solver.
+                num_force_pairs = flex_mesh_tracker->GetContactForces(points, forces);
             }
-            flex_mesh_tracker->UpdateMesh(node_current_location);
-
-            // Forces need to be extracted, if you want to use an external solver to solve the mesh's deformation. You
-            // can do it like shown below. In this example, we did not use it other than writing it to a file; however
-            // you may want to feed the array directly to your soild mechanics solver.
-            num_force_pairs = flex_mesh_tracker->GetContactForces(points, forces);
         }
 
         // Means advance simulation by one time step
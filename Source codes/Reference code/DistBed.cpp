@@ -13,6 +13,12 @@
 #include <chrono>
 #include <filesystem>
 
+#include "../utils/CounterRNG.hpp"
+#include "../utils/ForceSensor.hpp"
+#include "../utils/GradedBed.hpp"
+#include "../utils/MeshBVH.hpp"
+#include "../utils/MeshSimplify.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
@@ -50,12 +56,24 @@ void write_csv(std::string filename, std::vector<std::pair<std::string, std::vec
     myFile.close();
 }
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Particle-triangle candidate pairs the screw generates at its current pose: for each particle, the triangles whose
+// BVH boxes come within reach (the largest grain radius) of its center. This is a host-side estimate of the
+// broadphase load the screw mesh brings; the solver's own broadphase does not use the BVH.
+size_t ScrewCandidatePairs(const MeshBVH& bvh, float3 screw_pos, float4 screw_oriQ, const std::vector<float3>& xyz,
+                           float reach) {
+    size_t pairs = 0;
+    for (const auto& p : xyz) {
+        bvh.ForEachNear(MeshBVH::ToLocal(p, screw_pos, screw_oriQ), reach, [&](unsigned int) { pairs++; });
+    }
+    return pairs;
+}
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // | OUTPUT_CONTENT:: VEL //|  OUTPUT_CONTENT:: ACC 
 // | NORMAL
 
 
-int main() {
+int main(int argc, char* argv[]) {
 
     DEMSolver DEMSim;
     DEMSim.SetVerbosity(INFO);
@@ -94,17 +112,26 @@ int main() {
 
     
     //2-Bottom Wall:
-    bot_wall->SetMass(1000);//1000 is the assumed mass of boundary. 
-    bot_wall->SetMOI(make_float3(1./12.*1000.0*yBoundary*yBoundary, 1./12.*1000.0*xBoundary*xBoundary, 1./12.*1000.0*(xBoundary*xBoundary+yBoundary*yBoundary)));
+    // Its load is summed from its contacts (see sensors below), so it needs no made-up mass
     auto bot_wall_tracker = DEMSim.Track(bot_wall);
 
         // 2- Screw:
 
     // At the beginning of the simulation and until the end of the copression, the screw has a family type =1. this family is set to be fixed and does not contact the particles.
     // After, the screw family type is set to 3. 
-    auto projectile = DEMSim.AddWavefrontMeshObject("./screwCM.obj", mat_type_screw);
+    // Grain sizes, see 3-Particles below
+    float mean_radius = 0.0015;
+    float std_radius = 0.0005;
+    // The CAD screw is much finer than the grains can feel: decimate it to edges of the smallest grain radius (the
+    // sample is truncated at mean - std), keeping the surface within a tenth of that. The result is cached on disk.
+    float min_grain_radius = mean_radius - std_radius;
+    MeshSimplifier screw_simplifier(min_grain_radius, 0.1 * min_grain_radius);
+    std::string screw_file = screw_simplifier.SimplifyFile("./screwCM.obj", "./mesh_cache");
+    screw_simplifier.ShowStats();
+    auto projectile = DEMSim.AddWavefrontMeshObject(screw_file, mat_type_screw);
     std::cout << "Total num of triangles: " << projectile->GetNumTriangles() << std::endl;
-    projectile->InformCentroidPrincipal(make_float3(0.095965,0.237612,0.095964),make_float4 ( 0,0,0,1));
+    float3 screw_centroid = make_float3(0.095965, 0.237612, 0.095964);
+    projectile->InformCentroidPrincipal(screw_centroid, make_float4(0, 0, 0, 1));
     projectile->SetInitPos(make_float3(0, 0.061, 0.1 ));
     float screw_mass = 0.59; // screw mass 0.59kg . 
     float I_XX = 0.0062;
@@ -117,6 +144,24 @@ int main() {
     DEMSim.DisableContactBetweenFamilies(0, 1);
     // Track the projectile
     auto proj_tracker = DEMSim.Track(projectile);
+    // Net contact force and torque (global frame, about the CoM) on the screw and the bottom wall
+    ForceSensor sensors;
+    size_t screw_sensor = sensors.Add("screw", proj_tracker);
+    size_t bc_sensor = sensors.Add("bottom", bot_wall_tracker);
+    // BVH of the screw in its centroid frame, built once; the screw is rigid, so it never needs a refit
+    DEMMeshConnected screw_mesh;
+    screw_mesh.LoadWavefrontMesh(screw_file, false);
+    std::vector<float3> screw_nodes = screw_mesh.GetCoordsVertices();
+    for (auto& v : screw_nodes) {
+        v -= screw_centroid;
+    }
+    MeshBVH screw_bvh(screw_nodes, screw_mesh.m_face_v_indices);
+    std::cout << "Screw BVH: " << screw_bvh.GetNumNodes() << " nodes over " << screw_bvh.GetNumTriangles()
+              << " triangles" << std::endl;
+    // Report the screw's candidate pairs at every spin-phase output frame, as a diagnostic for tuning the screw mesh.
+    // It copies all particle positions to the host and queries the BVH for each of them, and the time it takes is
+    // printed with it; it leaves the solver's step time unchanged, so it is off by default.
+    bool report_broadphase = false;
     
     float rev_per_sec = 2;
     float ang_vel_Z = rev_per_sec * 3.14;
@@ -139,46 +184,40 @@ int main() {
     //Then the code samples a 1000 values of the distribution to generate clumps. 
     //The code in a way it ignores any sampled value that is less or more than the mean -/+ standered deviation. 
     // 3-Particles:
-    float mean_radius = 0.0015;
-    float std_radius = 0.0005;
-    std::default_random_engine generator;
-    std::normal_distribution<float> distribution(mean_radius, std_radius);//Normal Dist. of particles
+    CounterRNG rng(GetGlobalSeed()); // each sample draws from its own stream, so the bed is the same on every run
     int num_particles = 4000; // number if different clumbs types (number of samples taken from distribution)
     //auto template_terrain = DEMSim.LoadSphereType(0.0, 0.0, mat_type_terrain);
-    std::vector<std::shared_ptr<DEMClumpTemplate>> clump_types;
+    std::vector<float> sampled_radii;
     for (int i = 0; i < num_particles; i++) {
-    float radius = distribution(generator);
+    RandomStream sample_rng = rng.Stream(i);
+    float radius = sample_rng.Normal(mean_radius, std_radius);//Normal Dist. of particles
     while(radius < mean_radius - std_radius || radius > mean_radius + std_radius) {
-        radius = distribution(generator); // sample a different radius value until the condition is false
+        radius = sample_rng.Normal(mean_radius, std_radius); // sample a different radius value until the condition is false
     }
-    auto clump_template = DEMSim.LoadSphereType(radius * radius * radius * 2.5e3 * 4.0 / 3.0 * 3.14, radius, mat_type_terrain);
-    clump_types.push_back(clump_template);
+    sampled_radii.push_back(radius);
 }
+    // Grain-size curve: a measured sieve curve (diameter in mm, percent passing) if one is given on the command
+    // line, otherwise the mass-passing curve of the truncated normal sample above. The bed uses the fewest size
+    // classes that reproduce it within 2% passing, one template each.
+    GrainSizeCurve gsd = (argc > 1) ? GrainSizeCurve::FromCsv(argv[1], 1e-3) : GrainSizeCurve::FromRadii(sampled_radii);
+    GradedBed bed(gsd, 0.02);
+    bed.SetSeed(GetGlobalSeed());
+    std::vector<std::shared_ptr<DEMClumpTemplate>> class_types = bed.LoadTemplates(DEMSim, 2.5e3, mat_type_terrain);
 // Generate initial clumps for piling
-    float spacing = 2.005*(mean_radius+std_radius);
-    float sample_halfwidth_x = xBoundary / 2.000  - 2.005*(mean_radius+std_radius);
-    float sample_halfwidth_y = yBoundary / 2.000  - 2.005*(mean_radius+std_radius);
+    // Loose (porosity 0.85, about what the old PDSampler layers gave) through the lower 0.5 m of the box; the bed
+    // settles under gravity first
     float fill_height = 0.5;
-    float fill_bottom = -zBoundary / 2.0+ spacing;
-    PDSampler sampler(spacing);
-// Use a PDSampler-based clump generation process
-    std::vector<std::shared_ptr<DEMClumpTemplate>> input_pile_template_type;
-    std::vector<float3> input_pile_xyz;
-    float layer_z = 0;
-    while (layer_z < fill_height) {
-    float3 sample_center = make_float3(0, 0, fill_bottom + layer_z );
-    auto layer_xyz = sampler.SampleBox(sample_center, make_float3(sample_halfwidth_x, sample_halfwidth_y, 0));
-    unsigned int num_clumps = layer_xyz.size();
-    // Select from available clump types
-    for (unsigned int i = 0; i < num_clumps; i++) {
-        input_pile_template_type.push_back(clump_types.at(i % num_particles));
-        }
-    input_pile_xyz.insert(input_pile_xyz.end(), layer_xyz.begin(), layer_xyz.end());
-    layer_z += spacing;
-    }
+    float fill_bottom = -zBoundary / 2.0;
+    bed.SetBox(make_float3(-xBoundary / 2.0, -yBoundary / 2.0, fill_bottom),
+               make_float3(xBoundary / 2.0, yBoundary / 2.0, fill_bottom + fill_height));
+    std::vector<float3> input_pile_xyz = bed.Build(0.85);
+    std::vector<std::shared_ptr<DEMClumpTemplate>> input_pile_template_type = bed.TemplatesOf(class_types);
+    bed.ShowStats();
+    float max_grain_radius = *std::max_element(bed.GetClassRadii().begin(), bed.GetClassRadii().end());
 // Calling AddClumps a to add clumps to the system
     auto the_pile = DEMSim.AddClumps(input_pile_template_type, input_pile_xyz);
     the_pile->SetFamily(0);
+    auto pile_tracker = DEMSim.Track(the_pile);
     
     
     std::cout << "Terrain loaded: " <<  std::endl;
@@ -289,8 +328,9 @@ int main() {
         DEMSim.WriteMeshFile(std::string(meshfilename));
         //DEMSim.WriteContactFile(std::string(cnt_filename));
         float3 pos_screw = proj_tracker->Pos();
-        float3 force = proj_tracker->ContactAcc();
-        float3 torque_screw = proj_tracker->ContactAngAccLocal();
+        sensors.Sample(sim_time, false);
+        float3 force = sensors.Get(screw_sensor).force;
+        float3 torque_screw = sensors.Get(screw_sensor).torque;
         float3 VelocityScrew = proj_tracker->Vel();
         KE = KE_finder->GetValue();
 
@@ -301,9 +341,9 @@ int main() {
         ScrewYForceVector[currframe] = force.y;
         ScrewZForceVector[currframe] = force.z;
 
-        ScrewXtorqueVector[currframe] = torque_screw.x*I_XX;
-        ScrewYtorqueVector[currframe] = torque_screw.y*I_YY;
-        ScrewZtorqueVector[currframe] = torque_screw.z*I_ZZ;
+        ScrewXtorqueVector[currframe] = torque_screw.x;
+        ScrewYtorqueVector[currframe] = torque_screw.y;
+        ScrewZtorqueVector[currframe] = torque_screw.z;
 
         ScrewXVelVector[currframe] = VelocityScrew.x;
         ScrewYVelVector[currframe] = VelocityScrew.y;
@@ -317,7 +357,7 @@ int main() {
         KEVector[currframe] = KE;
 
         float3 BC_pos = bot_wall_tracker->Pos();
-        float3 BC_force = (bot_wall_tracker->ContactAcc())/1000.0;
+        float3 BC_force = sensors.Get(bc_sensor).force;
         //std::cout << "Bottom wall pos: " << BC_pos.x << ", " << BC_pos.y << ", " << BC_pos.z << std::endl;
         //std::cout << "Bottom wall force: " << BC_force.x << ", " << BC_force.y << ", " << BC_force.z << std::endl;
         BC_XForceVector[currframe] = BC_force.x;
@@ -451,10 +491,10 @@ int main() {
         //DEMSim.WriteContactFile(std::string(cnt_filename));
         
         float3 pos_screw = proj_tracker->Pos();
-        float3 force = proj_tracker->ContactAcc();
-        float3 torque_screw = proj_tracker->ContactAngAccLocal();
+        sensors.Sample(sim_time, false);
+        float3 force = sensors.Get(screw_sensor).force;
+        float3 torque_screw = sensors.Get(screw_sensor).torque;
         float3 VelocityScrew = proj_tracker->Vel();
-        force *= screw_mass;
         KE = KE_finder->GetValue();
         
 
@@ -471,9 +511,9 @@ int main() {
         ScrewYVelVector[currframe] = VelocityScrew.y;
         ScrewZVelVector[currframe] = VelocityScrew.z;
 
-        ScrewXtorqueVector[currframe] = torque_screw.x*I_XX;
-        ScrewYtorqueVector[currframe] = torque_screw.y*I_YY;
-        ScrewZtorqueVector[currframe] = torque_screw.z*I_ZZ;
+        ScrewXtorqueVector[currframe] = torque_screw.x;
+        ScrewYtorqueVector[currframe] = torque_screw.y;
+        ScrewZtorqueVector[currframe] = torque_screw.z;
         
         timeVector[currframe] = sim_time;
         ScrewXVector[currframe] = pos_screw.x;
@@ -482,7 +522,7 @@ int main() {
         KEVector[currframe] = KE;
 
         float3 BC_pos = bot_wall_tracker->Pos();
-        float3 BC_force = (bot_wall_tracker->ContactAcc())/1000.0;
+        float3 BC_force = sensors.Get(bc_sensor).force;
         BC_XForceVector[currframe] = BC_force.x;
         BC_YForceVector[currframe] = BC_force.y;
         BC_ZForceVector[currframe] = BC_force.z;
@@ -498,6 +538,8 @@ int main() {
     }
 
     DEMSim.ShowThreadCollaborationStats();
+    // Kinematic (contact detection) and dynamic thread time spent so far, for comparing screw meshes
+    DEMSim.ShowTimingStats();
     DEMSim.ClearThreadCollaborationStats();
 
     // Spen Screw:   
@@ -521,15 +563,23 @@ int main() {
         //DEMSim.WriteContactFile(std::string(cnt_filename));
         
         float3 pos_screw = proj_tracker->Pos();
-        float3 force = proj_tracker->ContactAcc();
-        float3 torque_screw = proj_tracker->ContactAngAccLocal();
+        sensors.Sample(sim_time, false);
+        float3 force = sensors.Get(screw_sensor).force;
+        float3 torque_screw = sensors.Get(screw_sensor).torque;
         float3 VelocityScrew = proj_tracker->Vel();
-        force *= screw_mass;
         KE = KE_finder->GetValue();
         
         
         std::cout << "Max velocity of clump " << max_v_finder->GetValue() <<  " m/s" << std::endl;
         std::cout << "screw postion: " << pos_screw.x << ", " << pos_screw.y << ", " << pos_screw.z << std::endl;
+        if (report_broadphase) {
+            auto query_start = std::chrono::high_resolution_clock::now();
+            size_t pairs = ScrewCandidatePairs(screw_bvh, pos_screw, proj_tracker->OriQ(), pile_tracker->Positions(),
+                                               max_grain_radius);
+            auto query_end = std::chrono::high_resolution_clock::now();
+            std::cout << "screw candidate pairs: " << pairs << " (host query "
+                      << std::chrono::duration<double>(query_end - query_start).count() << " s)" << std::endl;
+        }
 
 
         ScrewXForceVector[currframe] = force.x;
@@ -540,16 +590,16 @@ int main() {
         ScrewYVelVector[currframe] = VelocityScrew.y;
         ScrewZVelVector[currframe] = VelocityScrew.z;
 
-        ScrewXtorqueVector[currframe] = torque_screw.x*I_XX;
-        ScrewYtorqueVector[currframe] = torque_screw.y*I_YY;
-        ScrewZtorqueVector[currframe] = torque_screw.z*I_ZZ;
+        ScrewXtorqueVector[currframe] = torque_screw.x;
+        ScrewYtorqueVector[currframe] = torque_screw.y;
+        ScrewZtorqueVector[currframe] = torque_screw.z;
         
         timeVector[currframe] = sim_time;
         ScrewXVector[currframe] = pos_screw.x;
         ScrewYVector[currframe] = pos_screw.y;
         ScrewZVector[currframe] = pos_screw.z;
         float3 BC_pos = bot_wall_tracker->Pos();
-        float3 BC_force = (bot_wall_tracker->ContactAcc())/1000.0;
+        float3 BC_force = sensors.Get(bc_sensor).force;
         BC_XForceVector[currframe] = BC_force.x;
         BC_YForceVector[currframe] = BC_force.y;
         BC_ZForceVector[currframe] = BC_force.z;
@@ -0,0 +1,197 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Unconfined compression test of a bonded (cemented) sample, after the PFC
+// triaxial_test.lua setup without its sleeve. A cylinder of spheres is packed
+// and relaxed, every contact within a small gap is bonded with the parallel
+// bond model (Force models/ParallelBond.cu), the mould is removed and the top
+// platen is driven down at a constant speed. The axial stress is measured on
+// both platens until it falls to 85% of its peak.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/DensePacker.hpp"
+#include "utils/ForceSensor.hpp"
+
+using namespace deme;
+
+int main() {
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity(INFO);
+    DEMSim.SetOutputFormat(OUTPUT_FORMAT::CSV);
+    DEMSim.SetOutputContent(OUTPUT_CONTENT::ABSV);
+
+    std::filesystem::path out_dir = std::filesystem::current_path();
+    out_dir += "/DemoOutput_BondedUCS";
+    std::filesystem::create_directory(out_dir);
+
+    // Sample and grains, scaled from the PFC test (radius 1, height 3, grains 0.05-0.1)
+    float sample_radius = 0.025;
+    float sample_height = 0.075;
+    float r_small = 1.25e-3, r_large = 2.5e-3;
+    float grain_density = 2.6e3;
+
+    // The bond: modulus, stiffness ratio, tensile and shear strength (pb_ten 2e5, pb_coh 2e6 as in PFC), radius
+    // multiplier and installation gap. Walls get pb_rmul = 0 so they never bond.
+    float pb_gap = 0.1 * r_small;
+    std::unordered_map<std::string, float> grain_props = {{"E", 1e8},
+                                                          {"nu", 0.3},
+                                                          {"CoR", 0.5},
+                                                          {"mu", 0.3},
+                                                          {"Crr", 0.0},
+                                                          {"pb_E", 1e8},
+                                                          {"pb_kratio", 1},
+                                                          {"pb_ten", 2e5},
+                                                          {"pb_coh", 2e6},
+                                                          {"pb_rmul", 1},
+                                                          {"pb_gap", pb_gap},
+                                                          {"pb_install", 0}};
+    auto mat_type_grain = DEMSim.LoadMaterial(grain_props);
+    // The same material, but bonding its contacts; the grains wear it only while the bonds are installed
+    grain_props["pb_install"] = 1;
+    auto mat_type_bonding = DEMSim.LoadMaterial(grain_props);
+    auto mat_type_wall = DEMSim.LoadMaterial({{"E", 1e9},
+                                              {"nu", 0.3},
+                                              {"CoR", 0.5},
+                                              {"mu", 0.0},
+                                              {"Crr", 0.0},
+                                              {"pb_E", 0},
+                                              {"pb_kratio", 1},
+                                              {"pb_ten", 0},
+                                              {"pb_coh", 0},
+                                              {"pb_rmul", 0},
+                                              {"pb_gap", 0},
+                                              {"pb_install", 0}});
+
+    // Bonded contact model; the bond state lives in per-contact wildcards, which DEME carries over contact detection
+    // updates for pairs that stay in the contact list
+    std::filesystem::path model_file = std::filesystem::path(__FILE__).parent_path() / "Force models/ParallelBond.cu";
+    auto bond_model = DEMSim.ReadContactForceModel(model_file.string());
+    bond_model->SetMustHaveMatProp(
+        {"E", "nu", "CoR", "mu", "pb_E", "pb_kratio", "pb_ten", "pb_coh", "pb_rmul", "pb_gap", "pb_install"});
+    bond_model->SetMustPairwiseMatProp({"CoR", "mu"});
+    bond_model->SetPerContactWildcards({"delta_time", "delta_tan_x", "delta_tan_y", "delta_tan_z", "pb_state", "pb_fn",
+                                        "pb_fs_x", "pb_fs_y", "pb_fs_z"});
+
+    DEMSim.InstructBoxDomainDimension(0.2, 0.2, 0.2);
+    DEMSim.InstructBoxDomainBoundingBC("none", mat_type_wall);
+    double bottom = -sample_height / 2;
+
+    // Mould, removed once the sample is bonded
+    auto mould = DEMSim.AddExternalObject();
+    mould->AddCylinder(make_float3(0), make_float3(0, 0, 1), sample_radius, mat_type_wall, 0);
+    mould->SetFamily(10);
+    DEMSim.SetFamilyFixed(10);
+    // Platens: the bottom one is fixed, the top one sits on the sample and is driven down later
+    auto bottom_platen = DEMSim.AddExternalObject();
+    bottom_platen->AddPlane(make_float3(0), make_float3(0, 0, 1), mat_type_wall);
+    bottom_platen->SetInitPos(make_float3(0, 0, bottom));
+    bottom_platen->SetFamily(11);
+    DEMSim.SetFamilyFixed(11);
+    auto top_platen = DEMSim.AddExternalObject();
+    top_platen->AddPlane(make_float3(0), make_float3(0, 0, -1), mat_type_wall);
+    top_platen->SetInitPos(make_float3(0, 0, bottom + sample_height));
+    top_platen->SetFamily(12);
+    DEMSim.SetFamilyFixed(12);
+    float platen_speed = 0.02;
+    DEMSim.SetFamilyPrescribedLinVel(13, "0", "0", "-" + to_string_with_precision(platen_speed));
+    DEMSim.SetFamilyPrescribedAngVel(13);
+
+    // Grains: two sizes, equal numbers, packed into the mould
+    std::vector<float> radii = {r_small, r_large};
+    std::vector<std::shared_ptr<DEMClumpTemplate>> grain_types;
+    for (float r : radii) {
+        float mass = grain_density * 4. / 3. * PI * r * r * r;
+        grain_types.push_back(DEMSim.LoadSphereType(mass, r, mat_type_grain));
+    }
+    DensePacker packer(radii, {1.f, 1.f});
+    packer.SetCylinderZ(make_float3(0, 0, bottom), sample_radius, sample_height);
+    auto input_xyz = packer.Pack();
+    std::vector<std::shared_ptr<DEMClumpTemplate>> input_types;
+    for (unsigned int id : packer.GetClassIds()) {
+        input_types.push_back(grain_types[id]);
+    }
+    auto grains = DEMSim.AddClumps(input_types, input_xyz);
+    std::cout << "Total num of particles: " << grains->GetNumClumps() << std::endl;
+    std::cout << "Packed solid fraction: " << packer.GetPackingFraction() << std::endl;
+    // Keeps bonded pairs in the contact list after they move apart a little
+    DEMSim.SetFamilyExtraMargin(0, 2 * pb_gap);
+
+    auto top_tracker = DEMSim.Track(top_platen);
+    auto bottom_tracker = DEMSim.Track(bottom_platen);
+    ForceSensor platen_sensor;
+    size_t top_sensor = platen_sensor.Add("top", top_tracker);
+    size_t bottom_sensor = platen_sensor.Add("bottom", bottom_tracker);
+
+    float step_size = 1e-6;
+    DEMSim.SetInitTimeStep(step_size);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, 0));
+    DEMSim.SetMaxVelocity(5.);
+    DEMSim.Initialize();
+
+    // Relax the packing, then bond every contact within pb_gap, stress free
+    DEMSim.DoDynamicsThenSync(0.01);
+    DEMSim.SetFamilyClumpMaterial(0, mat_type_bonding);
+    DEMSim.DoDynamicsThenSync(2 * step_size);
+    DEMSim.SetFamilyClumpMaterial(0, mat_type_grain);
+    // Remove the mould and start loading
+    DEMSim.DisableContactBetweenFamilies(0, 10);
+    DEMSim.ChangeFamily(12, 13);
+
+    double area = PI * sample_radius * sample_radius;
+    double peak_stress = 0., peak_strain = 0.;
+    float frame_time = 1e-4;
+    unsigned int frame_count = 0;
+    std::ofstream curve(out_dir.string() + "/stress_strain.csv");
+    curve << "strain,stress" << std::endl;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (double t = 0.; t < 0.2; t += frame_time, frame_count++) {
+        platen_sensor.Sample(t);
+        double top_force = std::abs(platen_sensor.Get(top_sensor).force.z);
+        double bottom_force = std::abs(platen_sensor.Get(bottom_sensor).force.z);
+        double stress = 0.5 * (top_force + bottom_force) / area;
+        double strain = (top_tracker->Pos().z - bottom_tracker->Pos().z - sample_height) / -sample_height;
+        curve << strain << "," << stress << std::endl;
+        if (stress >= peak_stress) {
+            peak_stress = stress;
+            peak_strain = strain;
+        }
+        if (frame_count % 50 == 0) {
+            char filename[200];
+            sprintf(filename, "%s/DEMdemo_output_%04d.csv", out_dir.c_str(), frame_count / 50);
+            DEMSim.WriteSphereFile(std::string(filename));
+            std::cout << "Axial strain: " << strain << ", stress: " << stress << std::endl;
+        }
+        // Stop once the sample has clearly failed; the first half percent of strain is the platen seating
+        if (strain > 0.005 && stress < 0.85 * peak_stress) {
+            break;
+        }
+        DEMSim.DoDynamicsThenSync(frame_time);
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+    std::cout << time_sec.count() << " seconds (wall time) to finish the simulation" << std::endl;
+
+    std::cout << "Unconfined compressive strength: " << peak_stress << " Pa at axial strain " << peak_strain
+              << std::endl;
+    platen_sensor.WriteCsv(out_dir.string() + "/platen_forces.csv");
+    DEMSim.ShowTimingStats();
+    std::cout << "BondedUCS demo exiting..." << std::endl;
+    return 0;
+}
@@ -0,0 +1,188 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Step time of the cone penetrometer with the stock meshes (cone.obj and
+// cyl_r1_h2.obj, stretched as modified_CPT.cpp used to do) against the meshes
+// generated at their exact size by PrimitiveMesh.hpp, with facets within a
+// tenth of a grain's bounding radius. Both cases use the same packed bed and
+// push the cone to the same depth at the same speed, and sample the tip
+// resistance at the same depth increments. Contact is sphere-triangle in both,
+// so any difference in step time comes from the triangle count alone.
+//
+// The bin is smaller than in modified_CPT.cpp so that a case runs in minutes.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "utils/ClumpBuilder.hpp"
+#include "utils/DensePacker.hpp"
+#include "utils/ForceSensor.hpp"
+#include "utils/PrimitiveMesh.hpp"
+
+using namespace deme;
+
+const double math_PI = 3.14159;
+
+const float cone_speed = 0.1;
+const float step_size = 5e-6;
+const double soil_bin_diameter = 0.2;
+const double cone_surf_area = 323e-6;
+const double penetration_depth = 0.04;
+// Depth between two samples of the tip resistance
+const double depth_resolution = 1e-3;
+
+struct BenchResult {
+    size_t num_triangles;
+    size_t num_steps;
+    double wall_time;
+    // Tip resistance (Pa) at each sampled depth
+    std::vector<float> pressure;
+};
+
+BenchResult RunCase(bool generated, const std::filesystem::path& out_dir) {
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity("ERROR");
+    DEMSim.SetOutputFormat(OUTPUT_FORMAT::CSV);
+
+    auto mat_type_cone = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.8}, {"mu", 0.7}, {"Crr", 0.00}});
+    auto mat_type_terrain = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.8}, {"mu", 0.4}, {"Crr", 0.00}});
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_cone, mat_type_terrain, 0.8);
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_cone, mat_type_terrain, 0.7);
+
+    double cone_diameter = std::sqrt(cone_surf_area / math_PI) * 2;
+    DEMSim.InstructBoxDomainDimension(1, 1, 1);
+    DEMSim.InstructBoxDomainBoundingBC("none", mat_type_terrain);
+    double bottom = -0.25;
+    auto walls = DEMSim.AddExternalObject();
+    walls->AddCylinder(make_float3(0), make_float3(0, 0, 1), soil_bin_diameter / 2., mat_type_terrain, 0);
+    walls->AddPlane(make_float3(0, 0, bottom), make_float3(0, 0, 1), mat_type_terrain);
+
+    // Same grains and packing as modified_CPT.cpp, seeded the same in both cases
+    float terrain_density = 2.6e3;
+    ClumpBuilder clump_builder;
+    clump_builder.SetSpheres(ReadClumpCsv(GetDEMEDataFile("clumps/3_clump.csv")));
+    std::shared_ptr<DEMClumpTemplate> my_template = clump_builder.Load(DEMSim, terrain_density, mat_type_terrain);
+    double scale = 0.0044;
+    my_template->Scale(scale);
+    float fill_height = 0.1;
+    float bounding_radius = clump_builder.GetPrincipalSpheres().BoundingRadius() * scale;
+    DensePacker packer({bounding_radius}, {1.f});
+    packer.SetCylinderZ(make_float3(0, 0, bottom), soil_bin_diameter / 2., fill_height);
+    packer.SetSeed(1);
+    auto input_xyz = packer.Pack();
+    DEMSim.AddClumps(my_template, input_xyz);
+
+    float tip_height = std::sqrt(3.);
+    std::shared_ptr<DEMMeshConnected> cone_tip, cone_body;
+    BenchResult res;
+    if (generated) {
+        double cone_radius = cone_diameter / 2;
+        int cone_segments = SegmentsForDeviation(cone_radius, 0.1 * bounding_radius);
+        PrimitiveMesh tip_mesh = MakeConeFrustum(0., cone_radius, cone_radius * tip_height, cone_segments);
+        PrimitiveMesh body_mesh = MakeCappedCylinder(cone_radius, 1., cone_segments);
+        cone_tip = AddPrimitiveMesh(DEMSim, tip_mesh, out_dir.string() + "/bench_cone_tip.obj", mat_type_cone, 7.8e3);
+        cone_body =
+            AddPrimitiveMesh(DEMSim, body_mesh, out_dir.string() + "/bench_cone_body.obj", mat_type_cone, 7.8e3);
+    } else {
+        // The stock meshes, stretched and given mass properties as modified_CPT.cpp did before PrimitiveMesh
+        cone_tip = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/cone.obj"), mat_type_cone);
+        cone_body = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/cyl_r1_h2.obj"), mat_type_cone);
+        cone_tip->Scale(make_float3(1, 1, tip_height));
+        float cone_mass = 7.8e3 * tip_height / 3 * math_PI;
+        cone_tip->SetMass(cone_mass);
+        cone_tip->SetMOI(make_float3(cone_mass * (3. / 20. + 3. / 80. * tip_height * tip_height),
+                                     cone_mass * (3. / 20. + 3. / 80. * tip_height * tip_height), 3 * cone_mass / 10));
+        cone_tip->InformCentroidPrincipal(make_float3(0, 0, 3. / 4. * tip_height), make_float4(0, 0, 0, 1));
+        cone_tip->Scale(cone_diameter / 2);
+        float body_mass = 7.8e3 * math_PI;
+        cone_body->SetMass(body_mass);
+        cone_body->SetMOI(make_float3(body_mass * 7 / 12, body_mass * 7 / 12, body_mass / 2));
+        cone_body->Scale(make_float3(cone_diameter / 2, cone_diameter / 2, 0.5));
+    }
+    res.num_triangles = cone_tip->GetNumTriangles() + cone_body->GetNumTriangles();
+    cone_tip->SetFamily(2);
+    cone_body->SetFamily(2);
+    auto tip_tracker = DEMSim.Track(cone_tip);
+    auto body_tracker = DEMSim.Track(cone_body);
+    ForceSensor tip_sensor;
+    tip_sensor.Add("tip", tip_tracker);
+
+    DEMSim.SetFamilyPrescribedLinVel(1, "0", "0", "-" + to_string_with_precision(cone_speed));
+    DEMSim.SetFamilyFixed(2);
+    DEMSim.DisableContactBetweenFamilies(0, 2);
+    auto max_z_finder = DEMSim.CreateInspector("clump_max_z");
+
+    DEMSim.SetInitTimeStep(step_size);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.SetCDUpdateFreq(20);
+    DEMSim.SetMaxVelocity(10.);
+    DEMSim.Initialize();
+
+    // The packed bed only needs a short relaxation
+    DEMSim.DoDynamicsThenSync(0.1);
+    double terrain_max_z = max_z_finder->GetValue();
+
+    // Tip just touching the surface, as in modified_CPT.cpp but without the approach
+    double tip_z = terrain_max_z;
+    double tip_centroid_z = tip_z + cone_diameter / 2 * 3 / 4 * tip_height;
+    tip_tracker->SetPos(make_float3(0, 0, tip_centroid_z));
+    body_tracker->SetPos(make_float3(0, 0, 0.5 + (cone_diameter / 2 / 4 * tip_height) + tip_centroid_z));
+    DEMSim.ChangeFamily(2, 1);
+
+    double sample_time = depth_resolution / cone_speed;
+    size_t num_samples = (size_t)std::llround(penetration_depth / depth_resolution);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t k = 0; k < num_samples; k++) {
+        DEMSim.DoDynamicsThenSync(sample_time);
+        tip_sensor.Sample((k + 1) * sample_time, false);
+        res.pressure.push_back(std::abs(tip_sensor.Get(0).force.z) / cone_surf_area);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    res.wall_time = std::chrono::duration<double>(end - start).count();
+    res.num_steps = (size_t)std::llround(num_samples * sample_time / step_size);
+    DEMSim.ShowTimingStats();
+    return res;
+}
+
+void ShowResult(const std::string& name, const BenchResult& res) {
+    std::cout << name << ": " << res.num_triangles << " triangles, " << res.wall_time << " s wall for "
+              << res.num_steps << " steps (" << 1e6 * res.wall_time / res.num_steps << " us per step), tip resistance "
+              << res.pressure.back() << " Pa at " << penetration_depth << " m" << std::endl;
+}
+
+int main() {
+    std::filesystem::path out_dir = std::filesystem::current_path();
+    out_dir += "/DemoOutput_ConeMeshBenchmark";
+    std::filesystem::create_directory(out_dir);
+
+    BenchResult stock = RunCase(false, out_dir);
+    BenchResult exact = RunCase(true, out_dir);
+
+    // Tip resistance of both cases at every sampled depth
+    char filename[200];
+    sprintf(filename, "%s/tip_resistance.csv", out_dir.c_str());
+    std::ofstream file(filename);
+    file << "depth,stock,generated\n";
+    for (size_t k = 0; k < stock.pressure.size(); k++) {
+        file << (k + 1) * depth_resolution << "," << stock.pressure[k] << "," << exact.pressure[k] << "\n";
+    }
+
+    ShowResult("Stock meshes", stock);
+    ShowResult("Generated meshes", exact);
+    std::cout << "Step time ratio (generated / stock): "
+              << (exact.wall_time / exact.num_steps) / (stock.wall_time / stock.num_steps) << std::endl;
+    return 0;
+}
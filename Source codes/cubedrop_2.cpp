@@ -17,6 +17,8 @@
 #include <chrono>
 #include <filesystem>
 
+#include "utils/PrimitiveMesh.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
@@ -41,13 +43,16 @@ int main() {
     DEMSim.InstructBoxDomainDimension({0, world_size}, {0, world_size}, {0, world_size});
     DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_terrain);
 
-    auto projectile = DEMSim.AddWavefrontMeshObject((GET_DATA_PATH() / "mesh/cube.obj").string(), mat_type_ball);
+    path out_dir = current_path();
+    out_dir += "/DemoOutput_BallDrop";
+    create_directory(out_dir);
+
+    // A unit steel cube, mass and MOI computed from its mesh
+    PrimitiveMesh cube_mesh = MakeBox(make_float3(1, 1, 1));
+    auto projectile = AddPrimitiveMesh(DEMSim, cube_mesh, (out_dir / "cube.obj").string(), mat_type_ball, 7.8e3);
     std::cout << "Total num of triangles: " << projectile->GetNumTriangles() << std::endl;
 
     projectile->SetInitPos(make_float3(world_size / 2, world_size / 2, world_size + 1));
-    float ball_mass = 7.8e3;
-    projectile->SetMass(ball_mass);
-    projectile->SetMOI(make_float3(ball_mass * 1 / 6, ball_mass * 1 / 6, ball_mass * 1 / 6));
     projectile->SetFamily(2);
     DEMSim.SetFamilyFixed(2);
 
@@ -84,10 +89,6 @@ int main() {
 
     DEMSim.Initialize();
 
-    path out_dir = current_path();
-    out_dir += "/DemoOutput_BallDrop";
-    create_directory(out_dir);
-
     float sim_time = 6.0;
     float settle_time = 2.0;
     unsigned int fps = 20;
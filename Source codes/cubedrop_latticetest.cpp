@@ -17,28 +17,19 @@
 #include <chrono>
 #include <filesystem>
 
+#include "utils/Lattice.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
-//lattice generation function check
-std::vector<float3> GenerateCustomLattice(int n, int y, float particleDiameter) {
-    std::vector<float3> positions;
-    bool isNLayer = true; //n particles in the 1st layer
-    float spacing = particleDiameter;
-
-    for (int layer = 0; layer < y; ++layer) {
-        int particlesInLayer = isNLayer ? n : n + 1;
-
-        float startX = -particlesInLayer * spacing / 2.0f; 
-        float startY = layer * spacing; 
-
-        for (int i = 0; i < particlesInLayer; ++i) {
-            positions.push_back({startX + i * spacing, startY, 0.0f}); 
-        }
-        isNLayer = !isNLayer; // Alternating between n and n+1 particles per layer
-    }
-    return positions;
-}
+// Rows along x, one diameter apart in y, in the z = 0 plane; odd rows are shifted back by half a diameter and hold one
+// more particle
+struct StaggeredRows {
+    static constexpr int dim = 3;
+    static constexpr int num_basis = 1;
+    static float3 Step() { return make_float3(1.f, 1.f, 0.f); }
+    static float3 Site(int i, int j, int k, int b) { return make_float3(i - 0.5f * (j & 1), j, 0.f); }
+};
 
 int main() {
     DEMSolver DEMSim;
@@ -72,12 +63,12 @@ int main() {
     int n = 30; //base number of particles in x and y directions
     int y  = 2; //number of layers
     
-    auto positions = GenerateCustomLattice(n, y, particleDiameter);
+    LatticeGenerator<StaggeredRows> lattice(particleDiameter, make_float3(-n * particleDiameter / 2.0f, 0, 0));
+    auto positions = lattice.Generate(make_float3(-(n / 2.0f + 0.75f) * particleDiameter, -0.5f * particleDiameter, 0),
+                                      make_float3((n / 2.0f - 0.25f) * particleDiameter, (y - 0.5f) * particleDiameter, 0));
 
     //assigning particles to positions
-    for(const auto&pos : positions) {
-        DEMSim.AddClumps(template_terrain, pos);
-    }
+    DEMSim.AddClumps(template_terrain, positions);
 
     DEMSim.SetInitTimeStep(step_size);
     DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
@@ -21,6 +21,8 @@
 #include <fstream>
 #include <vector>
 
+#include "utils/PrimitiveMesh.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 const std::string force_csv_header = "point_x,point_y,point_z,force_x,force_y,force_z";
@@ -72,13 +74,12 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
         float cube_size = 0.5 * world_size;
         float cube_pos = world_size + drop_height;
 
-        auto projectile = DEMSim.AddWavefrontMeshObject((GET_DATA_PATH() / "mesh/cube.obj").string(), mat_type_cube);
-        projectile->Scale(make_float3(cube_size, cube_size, cube_thickness));
+        float cube_density = 7.6e3;
+        PrimitiveMesh cube_mesh = MakeBox(make_float3(cube_size, cube_size, cube_thickness));
+        auto projectile =
+            AddPrimitiveMesh(DEMSim, cube_mesh, (master_dir / "cube.obj").string(), mat_type_cube, cube_density);
 
         projectile->SetInitPos(make_float3(0.0, 0.0, cube_pos));
-        float cube_density = 7.6e3;
-        projectile->SetMass(cube_density * cube_size * cube_size * cube_thickness);
-        projectile->SetMOI(make_float3(cube_density * 1 / 6, cube_density * 1 / 6, cube_density * 1 / 6));
         projectile->SetFamily(2);
         DEMSim.SetFamilyFixed(2);
 
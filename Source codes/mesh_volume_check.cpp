@@ -0,0 +1,83 @@
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils/Lattice.hpp"
+#include "utils/MeshVolume.hpp"
+#include "utils/PolydisperseSampler.hpp"
+
+using namespace deme;
+
+// Checks MeshVolume on closed OBJ meshes shipped with DEME (a faceted sphere and a cube), each scaled by 0.05:
+//  - a fine cubic lattice clipped with Clip() encloses the mesh's signed volume to within 1%, and Keep() on the
+//    unclipped lattice keeps exactly the same sites;
+//  - SamplePolydisperse fills the interior to the requested solid fraction of the signed volume, with every sphere
+//    fully inside the mesh.
+
+const float mesh_scale = 0.05;
+const std::vector<float> class_radii = {1.5e-3, 2e-3, 3e-3};
+const std::vector<float> class_weights = {0.5, 0.3, 0.2};
+// Spheres kept fully inside a curved wall pack loosely against it, so a container a few tens of grains across jams
+// well below the sampler's 0.38 (about 0.26 for the sphere)
+const float fill_fraction = 0.25;
+
+bool CheckMesh(const std::string& name) {
+    float r_max = class_radii.back();
+    MeshVolume volume(GetDEMEDataFile("mesh/" + name).string(), 4 * r_max, mesh_scale);
+    double mesh_vol = volume.GetVolume();
+    bool ok = true;
+
+    // Lattice volume of the interior, one site per cell of the lattice, none of them on the cube's faces
+    float spacing = 1e-3;
+    LatticeGenerator<SimpleCubic> lattice(spacing, volume.GetMin() + make_float3(spacing / 2));
+    std::vector<float3> clipped = lattice.Generate(volume.GetMin(), volume.GetMax(), volume.Clip());
+    std::vector<float3> kept = volume.Keep(lattice.Generate(volume.GetMin(), volume.GetMax()));
+    double lattice_vol = clipped.size() * std::pow((double)spacing, 3);
+    std::cout << name << ": signed volume " << mesh_vol << " m^3, lattice volume " << lattice_vol << " m^3"
+              << std::endl;
+    if (std::abs(lattice_vol - mesh_vol) > 0.01 * mesh_vol) {
+        std::cout << name << ": lattice volume is off by more than 1%" << std::endl;
+        ok = false;
+    }
+    if (kept.size() != clipped.size()) {
+        std::cout << name << ": Keep kept " << kept.size() << " sites, Clip " << clipped.size() << std::endl;
+        ok = false;
+    }
+
+    // Polydisperse fill
+    PolydisperseSampler sampler(class_radii, class_weights);
+    sampler.SetSeed(1);
+    std::vector<float3> xyz = volume.SamplePolydisperse(sampler, fill_fraction);
+    const std::vector<unsigned int>& ids = sampler.GetClassIds();
+    double solid_vol = 0.;
+    size_t num_outside = 0;
+    for (size_t i = 0; i < xyz.size(); i++) {
+        float r = class_radii[ids[i]];
+        solid_vol += 4. / 3. * PI * r * r * r;
+        num_outside += !volume.Inside(xyz[i], r);
+    }
+    std::cout << name << ": " << xyz.size() << " spheres, solid volume " << solid_vol << " m^3, solid fraction "
+              << solid_vol / mesh_vol << " (asked for " << fill_fraction << ")" << std::endl;
+    // The sampler comes in a little short, as the last spheres drawn rarely find room
+    if (solid_vol < 0.95 * fill_fraction * mesh_vol || solid_vol > 1.05 * fill_fraction * mesh_vol) {
+        std::cout << name << ": solid fraction is off by more than 5%" << std::endl;
+        ok = false;
+    }
+    if (num_outside > 0) {
+        std::cout << name << ": " << num_outside << " spheres poke out of the mesh" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+int main() {
+    bool ok = CheckMesh("sphere.obj");
+    ok = CheckMesh("cube.obj") && ok;
+    std::cout << (ok ? "Mesh volume check passed" : "Mesh volume check FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -21,6 +21,11 @@
 #include <map>
 #include <random>
 
+#include "utils/ClumpBuilder.hpp"
+#include "utils/DensePacker.hpp"
+#include "utils/ForceSensor.hpp"
+#include "utils/PrimitiveMesh.hpp"
+
 using namespace deme;
 
 const double math_PI = 3.14159;
@@ -56,62 +61,52 @@ int main() {
     walls->AddPlane(make_float3(0, 0, bottom), make_float3(0, 0, 1), mat_type_terrain);
 
     // Define the terrain particle templates
-    // Calculate its mass and MOI
+    // Its volume and MOI are integrated over the union of its spheres, and it is loaded in its principal frame
     float terrain_density = 2.6e3;
-    double clump_vol = 5.5886717;
-    float mass = terrain_density * clump_vol;
-    float3 MOI = make_float3(2.928, 2.6029, 3.9908) * terrain_density;
-    // Then load it to system
-    std::shared_ptr<DEMClumpTemplate> my_template =
-        DEMSim.LoadClumpType(mass, MOI, GetDEMEDataFile("clumps/3_clump.csv"), mat_type_terrain);
-    my_template->SetVolume(clump_vol);
+    ClumpBuilder clump_builder;
+    clump_builder.SetSpheres(ReadClumpCsv(GetDEMEDataFile("clumps/3_clump.csv")));
+    std::shared_ptr<DEMClumpTemplate> my_template = clump_builder.Load(DEMSim, terrain_density, mat_type_terrain);
+    clump_builder.ShowStats();
     // Decide the scalings of the templates we just created (so that they are... like particles, not rocks)
     double scale = 0.0044;
     my_template->Scale(scale);
 
-    // Sampler to sample
-    HCPSampler sampler(scale * 3.);
+    // Pack the clumps' bounding spheres into the bin directly, instead of letting an HCP lattice settle
     float fill_height = 0.5;
-    float3 fill_center = make_float3(0, 0, bottom + fill_height / 2);
-    const float fill_radius = soil_bin_diameter / 2. - scale * 3.;
-    auto input_xyz = sampler.SampleCylinderZ(fill_center, fill_radius, fill_height / 2 - scale * 2.);
+    float bounding_radius = clump_builder.GetPrincipalSpheres().BoundingRadius() * scale;
+    DensePacker packer({bounding_radius}, {1.f});
+    packer.SetCylinderZ(make_float3(0, 0, bottom), soil_bin_diameter / 2., fill_height);
+    auto input_xyz = packer.Pack();
+    std::cout << "Packed bed solid fraction (bounding spheres): " << packer.GetPackingFraction() << std::endl;
     DEMSim.AddClumps(my_template, input_xyz);
     std::cout << "Total num of particles: " << input_xyz.size() << std::endl;
 
-    // Load in the cone used for this penetration test
-    auto cone_tip = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/cone.obj"), mat_type_cone);
-    auto cone_body = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/cyl_r1_h2.obj"), mat_type_cone);
-    std::cout << "Total num of triangles: " << cone_tip->GetNumTriangles() + cone_body->GetNumTriangles() << std::endl;
-
-    // The initial cone mesh has base radius 1, and height 1. Let's stretch it a bit so it has a 60deg tip, instead of
-    // 90deg.
+    // Load in the cone used for this penetration test. The 60deg tip (apex at the origin) and the body are generated
+    // at their exact size, with facets within a tenth of a particle's bounding radius of the true surface, and their
+    // mass properties are integrated over the meshes, so there is no non-uniform Scale to correct for.
+    std::filesystem::path out_dir = std::filesystem::current_path();
+    out_dir += "/DemoOutput_ConePenetration";
+    std::filesystem::create_directory(out_dir);
     float tip_height = std::sqrt(3.);
-    cone_tip->Scale(make_float3(1, 1, tip_height));
-    // Then set mass properties
-    float cone_mass = 7.8e3 * tip_height / 3 * math_PI;
-    cone_tip->SetMass(cone_mass);
-    // You can checkout https://en.wikipedia.org/wiki/List_of_moments_of_inertia
-    cone_tip->SetMOI(make_float3(cone_mass * (3. / 20. + 3. / 80. * tip_height * tip_height),
-                                 cone_mass * (3. / 20. + 3. / 80. * tip_height * tip_height), 3 * cone_mass / 10));
-    // This cone mesh has its tip at the origin. And, float4 quaternion pattern is (x, y, z, w).
-    cone_tip->InformCentroidPrincipal(make_float3(0, 0, 3. / 4. * tip_height), make_float4(0, 0, 0, 1));
-    // Note the scale method will scale mass and MOI automatically. But this only goes for the case you scale xyz all
-    // together; otherwise, the MOI scaling will not be accurate and you should manually reset them.
-    cone_tip->Scale(cone_diameter / 2);
+    double cone_radius = cone_diameter / 2;
+    float cone_density = 7.8e3;
+    int cone_segments = SegmentsForDeviation(cone_radius, 0.1 * bounding_radius);
+    PrimitiveMesh tip_mesh = MakeConeFrustum(0., cone_radius, cone_radius * tip_height, cone_segments);
+    PrimitiveMesh body_mesh = MakeCappedCylinder(cone_radius, 1., cone_segments);
+    auto cone_tip =
+        AddPrimitiveMesh(DEMSim, tip_mesh, out_dir.string() + "/cone_tip.obj", mat_type_cone, cone_density);
+    auto cone_body =
+        AddPrimitiveMesh(DEMSim, body_mesh, out_dir.string() + "/cone_body.obj", mat_type_cone, cone_density);
+    std::cout << "Total num of triangles: " << tip_mesh.GetNumTriangles() + body_mesh.GetNumTriangles()
+              << ", max facet deviation: " << tip_mesh.max_deviation << std::endl;
     cone_tip->SetFamily(2);
-
-    // The define the body that is connected to the tip
-    float body_mass = 7.8e3 * math_PI;
-    cone_body->SetMass(body_mass);
-    cone_body->SetMOI(make_float3(body_mass * 7 / 12, body_mass * 7 / 12, body_mass / 2));
-    // This cyl mesh (h = 2m, r = 1m) has its center at the origin. So the following call actually has no effect...
-    cone_body->InformCentroidPrincipal(make_float3(0, 0, 0), make_float4(0, 0, 0, 1));
-    cone_body->Scale(make_float3(cone_diameter / 2, cone_diameter / 2, 0.5));
     cone_body->SetFamily(2);
 
     // Track the cone_tip
     auto tip_tracker = DEMSim.Track(cone_tip);
     auto body_tracker = DEMSim.Track(cone_body);
+    ForceSensor tip_sensor;
+    tip_sensor.Add("tip", tip_tracker);
 
     // Because the cone's motion is completely pre-determined, we can just prescribe family 1
     DEMSim.SetFamilyPrescribedLinVel(1, "0", "0", "-" + to_string_with_precision(cone_speed));
@@ -143,12 +138,8 @@ int main() {
 
     DEMSim.Initialize();
 
-    std::filesystem::path out_dir = std::filesystem::current_path();
-    out_dir += "/DemoOutput_ConePenetration";
-    std::filesystem::create_directory(out_dir);
-
-    // Settle
-    DEMSim.DoDynamicsThenSync(0.8);
+    // The packed bed only needs a short relaxation
+    DEMSim.DoDynamicsThenSync(0.1);
 
     // Compress until dense enough
     unsigned int currframe = 0;
@@ -234,10 +225,9 @@ int main() {
     std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
     for (float t = 0; t < sim_end; t += frame_time) {
         // float terrain_max_z = max_z_finder->GetValue();
-        float3 forces = tip_tracker->ContactAcc();
-        // Note cone_mass is not the true mass, b/c we scaled the the cone tip! So we use true mass by using
-        // cone_tip->mass.
-        forces *= cone_tip->mass;
+        // Summed from the tip's contacts, so it does not depend on the mass given to the tip
+        tip_sensor.Sample(t);
+        float3 forces = tip_sensor.Get(0).force;
         float pressure = std::abs(forces.z) / cone_surf_area;
         if (pressure > 1e-4 && !hit_terrain) {
             hit_terrain = true;
@@ -268,6 +258,7 @@ int main() {
     std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
     std::cout << time_sec.count() << " seconds (wall time) to finish the simulation" << std::endl;
+    tip_sensor.WriteCsv(out_dir.string() + "/tip_force.csv");
 
     std::cout << "ConePenetration demo exiting..." << std::endl;
     return 0;
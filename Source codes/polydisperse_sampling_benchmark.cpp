@@ -0,0 +1,147 @@
+#include <core/ApiVersion.h>
+#include <core/utils/ThreadManager.h>
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <filesystem>
+
+#include "utils/CounterRNG.hpp"
+#include "utils/PolydisperseSampler.hpp"
+
+using namespace deme;
+using namespace std::filesystem;
+
+// Compares the PDSampler initial bed (spaced for the largest particle) against a PolydisperseSampler bed of the same
+// size distribution: time to generate the bed, and simulated/wall time until the bed has settled. Both beds hold the
+// same solid volume; the polydisperse one is sampled into a shorter box at a higher solid fraction, which is resized
+// to the fraction the sampler actually reaches if it jams short of the target.
+
+const double terrain_rad_min = 0.006 / 2.;
+const double terrain_rad_step = 0.0001 / 2.;
+const unsigned int num_classes = 11;
+const double world_size = terrain_rad_min * 60.;
+const float settle_vel = 0.01;
+const float max_settle_time = 3.0;
+// Well below the ~0.38 at which random sequential placement jams
+const float poly_solid_fraction = 0.3;
+
+struct BenchResult {
+    size_t num_particles;
+    double sampling_time;
+    double settle_sim_time;
+    double settle_wall_time;
+    double solid_volume;
+};
+
+// With polydisperse = true, the bed is sized to hold solid_volume
+BenchResult RunCase(bool polydisperse, double solid_volume = 0.) {
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity("ERROR");
+    DEMSim.SetOutputFormat("CSV");
+
+    auto mat_type_terrain = DEMSim.LoadMaterial({{"E", 7e7}, {"nu", 0.24}, {"CoR", 0.9}, {"mu", 0.3}, {"Crr", 0.0}});
+
+    float step_size = 2e-6;
+    DEMSim.InstructBoxDomainDimension({-world_size / 2., world_size / 2.}, {-world_size / 2., world_size / 2.},
+                                      {0, 10 * world_size});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_terrain);
+
+    std::vector<std::shared_ptr<DEMClumpTemplate>> templates_terrain;
+    std::vector<float> class_radii;
+    double terrain_rad = terrain_rad_min;
+    for (unsigned int i = 0; i < num_classes; i++) {
+        templates_terrain.push_back(DEMSim.LoadSphereType(terrain_rad * terrain_rad * terrain_rad * 2.0e3 * 4 / 3 * PI,
+                                                          terrain_rad, mat_type_terrain));
+        class_radii.push_back(terrain_rad);
+        terrain_rad += terrain_rad_step;
+    }
+    double max_rad = class_radii.back();
+
+    float sample_halfwidth = world_size / 2 - 2 * max_rad;
+    float fullheight = world_size * 2.;
+
+    std::vector<float3> input_xyz;
+    std::vector<std::shared_ptr<DEMClumpTemplate>> template_to_use;
+    auto sample_start = std::chrono::high_resolution_clock::now();
+    if (polydisperse) {
+        PolydisperseSampler sampler(class_radii, std::vector<float>(num_classes, 1.f));
+        sampler.SetSeed(42);
+        float fraction = poly_solid_fraction;
+        // Accept the bed once it holds the PDSampler bed's solid volume to within 2%; the last few spheres drawn
+        // rarely find room, so the sampler tends to stop about 1-2% short
+        for (int attempt = 0; attempt < 3; attempt++) {
+            fullheight = solid_volume / (fraction * 4. * sample_halfwidth * sample_halfwidth);
+            auto sample_center = make_float3(0, 0, fullheight / 2 + 1 * max_rad);
+            auto sample_halfsize = make_float3(sample_halfwidth, sample_halfwidth, fullheight / 2.);
+            input_xyz = sampler.SampleBox(sample_center, sample_halfsize, fraction);
+            if (sampler.GetAchievedSolidFraction() >= 0.98 * fraction) {
+                break;
+            }
+            // Jammed short of the target: size the box for the fraction the sampler does reach and sample again
+            fraction = sampler.GetAchievedSolidFraction();
+        }
+        for (unsigned int id : sampler.GetClassIds()) {
+            template_to_use.push_back(templates_terrain[id]);
+        }
+        std::cout << "Achieved solid fraction: " << sampler.GetAchievedSolidFraction() << std::endl;
+    } else {
+        auto sample_center = make_float3(0, 0, fullheight / 2 + 1 * max_rad);
+        auto sample_halfsize = make_float3(sample_halfwidth, sample_halfwidth, fullheight / 2.);
+        PDSampler sampler(2.01 * max_rad);
+        input_xyz = sampler.SampleBox(sample_center, sample_halfsize);
+        CounterRNG rng(42);
+        for (unsigned int i = 0; i < input_xyz.size(); i++) {
+            template_to_use.push_back(templates_terrain[rng.Stream(i).UniformInt(templates_terrain.size())]);
+        }
+    }
+    auto sample_end = std::chrono::high_resolution_clock::now();
+    DEMSim.AddClumps(template_to_use, input_xyz);
+
+    DEMSim.SetInitTimeStep(step_size);
+    DEMSim.SetMaxVelocity(30.);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.Initialize();
+
+    auto max_v_finder = DEMSim.CreateInspector("clump_max_absv");
+    float frame_time = 0.01;
+    float t = 0;
+    auto settle_start = std::chrono::high_resolution_clock::now();
+    // Let the bed start falling before checking for rest
+    DEMSim.DoDynamicsThenSync(0.1);
+    t += 0.1;
+    while (t < max_settle_time && max_v_finder->GetValue() > settle_vel) {
+        DEMSim.DoDynamicsThenSync(frame_time);
+        t += frame_time;
+    }
+    auto settle_end = std::chrono::high_resolution_clock::now();
+
+    BenchResult res;
+    res.num_particles = input_xyz.size();
+    res.sampling_time = std::chrono::duration<double>(sample_end - sample_start).count();
+    res.settle_sim_time = t;
+    res.settle_wall_time = std::chrono::duration<double>(settle_end - settle_start).count();
+    res.solid_volume = 0.;
+    for (const auto& tmpl : template_to_use) {
+        res.solid_volume += 4. / 3. * PI * std::pow(tmpl->radii[0], 3);
+    }
+    return res;
+}
+
+void ShowResult(const std::string& name, const BenchResult& res) {
+    std::cout << name << ": " << res.num_particles << " particles (solid volume " << res.solid_volume
+              << " m^3), sampled in " << res.sampling_time << " s, settled (max v < " << settle_vel << ") after "
+              << res.settle_sim_time << " s simulated, " << res.settle_wall_time << " s wall" << std::endl;
+}
+
+int main() {
+    BenchResult pd = RunCase(false);
+    BenchResult poly = RunCase(true, pd.solid_volume);
+
+    ShowResult("PDSampler", pd);
+    ShowResult("PolydisperseSampler", poly);
+    return 0;
+}
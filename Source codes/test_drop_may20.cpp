@@ -19,6 +19,8 @@
 #include <string>
 #include <stdexcept>
 
+#include "utils/PrimitiveMesh.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 const std::string force_csv_header = "point_x,point_y,point_z,force_x,force_y,force_z";
@@ -73,15 +75,13 @@ void runSimulation(float E_bottom, float E_side, float drop_height, const path&
         float cube_thickness = 0.05 * world_size;
         float cube_size = 0.5 * world_size;
 
-        auto projectile = DEMSim.AddWavefrontMeshObject((GET_DATA_PATH() / "mesh/cube.obj").string(), mat_type_cube);
-        projectile->Scale(make_float3(cube_size, cube_size, cube_thickness));
+        float cube_density = 7.6e3;
+        PrimitiveMesh cube_mesh = MakeBox(make_float3(cube_size, cube_size, cube_thickness));
+        auto projectile =
+            AddPrimitiveMesh(DEMSim, cube_mesh, (master_dir / "cube.obj").string(), mat_type_cube, cube_density);
 
         float initial_drop_height = world_size * 2; // Initial high position to avoid overlap
         projectile->SetInitPos(make_float3(0.0, 0.0, initial_drop_height));
-        float cube_density = 7.6e3;
-        float cube_mass = cube_density * (cube_size * cube_size * cube_thickness);
-        projectile->SetMass(cube_mass);
-        projectile->SetMOI(make_float3(cube_mass * 1 / 6, cube_mass * 1 / 6, cube_mass * 1 / 6));
         projectile->SetFamily(2); // Initial fixed family
         DEMSim.SetFamilyFixed(2);
 
@@ -19,6 +19,8 @@
 #include <string>
 #include <stdexcept>
 
+#include "utils/PeriodicBox.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 const std::string force_csv_header = "point_x,point_y,point_z,force_x,force_y,force_z";
@@ -29,7 +31,8 @@ void writeFloat3VectorsToCSV(const std::string& header,
                              const std::string& filename,
                              size_t num_items);
 
-void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
+// Runs one case; returns the wall time per step of the drop, or 0 if the run failed
+double runSimulation(float E_bottom, float drop_height, const path& master_dir, bool use_periodic_sides = false) {
     try {
         std::cout << "Starting simulation with E_bottom: " << E_bottom << "drop_height: " << drop_height << std::endl;
         
@@ -51,16 +54,30 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
         // Step size
         float step_size = 1e-5;
         float world_size = 0.05;
+        // With use_periodic_sides, the box is periodic in x and y instead of having the four side planes, so no side
+        // wall stiffness is involved
+        PeriodicBox periodic(DEMSim, 5, 6);
 
         // Analytical boundary definition
-        auto walls = DEMSim.AddExternalObject();
         auto bottom_wall = DEMSim.AddExternalObject();
         // Define each plane of the box domain manually
         bottom_wall->AddPlane(make_float3(0, 0, 0), make_float3(0, 0, 1), mat_type_analyticalb); // Bottom plane
-        walls->AddPlane(make_float3(world_size / 2, 0, 0), make_float3(-1, 0, 0), mat_type_terrain); // Right plane
-        walls->AddPlane(make_float3(-world_size / 2, 0, 0), make_float3(1, 0, 0), mat_type_terrain); // Left plane
-        walls->AddPlane(make_float3(0, world_size / 2, 0), make_float3(0, -1, 0), mat_type_terrain); // Front plane
-        walls->AddPlane(make_float3(0, -world_size / 2, 0), make_float3(0, 1, 0), mat_type_terrain); // Back plane
+        if (use_periodic_sides) {
+            periodic.SetPeriodX(-world_size / 2, world_size / 2);
+            periodic.SetPeriodY(-world_size / 2, world_size / 2);
+            // The images stay off the bottom and the cube, which touch the particles themselves
+            bottom_wall->SetFamily(3);
+            DEMSim.SetFamilyFixed(3);
+            periodic.IgnoreFamily(3);
+            periodic.IgnoreFamily(1);
+            periodic.IgnoreFamily(2);
+        } else {
+            auto walls = DEMSim.AddExternalObject();
+            walls->AddPlane(make_float3(world_size / 2, 0, 0), make_float3(-1, 0, 0), mat_type_terrain); // Right plane
+            walls->AddPlane(make_float3(-world_size / 2, 0, 0), make_float3(1, 0, 0), mat_type_terrain); // Left plane
+            walls->AddPlane(make_float3(0, world_size / 2, 0), make_float3(0, -1, 0), mat_type_terrain); // Front plane
+            walls->AddPlane(make_float3(0, -world_size / 2, 0), make_float3(0, 1, 0), mat_type_terrain); // Back plane
+        }
 
         auto bottom_tracker = DEMSim.Track(bottom_wall);
 
@@ -90,8 +107,22 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
         HCPSampler sampler(terrain_rad * 2.2);
         float3 fill_center = make_float3(0, 0, fill_height/2 + 2 * terrain_rad);
         float3 fill_halfsize = make_float3(world_size/2, world_size/2, fill_height/2);
+        if (use_periodic_sides) {
+            // Keep the particles on the two sides of a seam from overlapping
+            fill_halfsize.x -= 1.1 * terrain_rad;
+            fill_halfsize.y -= 1.1 * terrain_rad;
+        }
         auto input_xyz = sampler.SampleBox(fill_center, fill_halfsize);
         auto particles = DEMSim.AddClumps(template_terrain, input_xyz);
+        if (use_periodic_sides) {
+            // Each periodic direction's images are about halo / period of the particles; spares wait above the drop
+            float halo = 2.5 * terrain_rad;
+            periodic.SetHalo(halo);
+            periodic.SetParking(make_float3(-world_size / 2, -world_size / 2, drop_height + 0.05), 2.2 * terrain_rad);
+            periodic.SetSyncInterval(10 * step_size, step_size);
+            periodic.AddParticles(particles, template_terrain, 2 * halo / world_size + 0.05);
+            periodic.Configure();
+        }
 
         std::cout << "Total num of particles: " << particles->GetNumClumps() << std::endl;
         std::cout << "Total num of spheres: " << particles->GetNumSpheres() << std::endl;
@@ -106,6 +137,9 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
         // Creating the output directory based on parameters within the master directory
         path out_dir = master_dir / ("BottomBoundary_E_" + std::to_string(static_cast<int>(E_bottom))) /
                        ("DropHeight_" + std::to_string(static_cast<int>(drop_height * 100)));
+        if (use_periodic_sides) {
+            out_dir /= "PeriodicSides";
+        }
         create_directories(out_dir);
 
         // Visualization frame time
@@ -131,7 +165,11 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
             writeFloat3VectorsToCSV(force_csv_header, {points, forces}, force_filename, num_force_pairs);
             curr_frame++;
             num_force_pairs = bottom_tracker->GetContactForces(points, forces);
-            DEMSim.DoDynamicsThenSync(frame_time);
+            if (use_periodic_sides) {
+                periodic.Advance(frame_time);
+            } else {
+                DEMSim.DoDynamicsThenSync(frame_time);
+            }
             DEMSim.ShowThreadCollaborationStats();
         }
 
@@ -165,17 +203,26 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
             writeFloat3VectorsToCSV(force_csv_header, {points, forces}, force_filename, num_force_pairs);
             curr_frame++;
             num_force_pairs = bottom_tracker->GetContactForces(points, forces);
-            DEMSim.DoDynamicsThenSync(frame_time);
+            if (use_periodic_sides) {
+                periodic.Advance(frame_time);
+            } else {
+                DEMSim.DoDynamicsThenSync(frame_time);
+            }
             DEMSim.ShowThreadCollaborationStats();
         }
 
         std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
         std::cout << time_sec.count() << " seconds (wall time) to finish the simulation" << std::endl;
+        double time_per_step = time_sec.count() / std::round(sim_time / step_size);
+        std::cout << 1e6 * time_per_step << " us (wall time) per step" << std::endl;
 
         // Post simulation housekeeping
         DEMSim.ShowTimingStats();
         DEMSim.ShowAnomalies();
+        if (use_periodic_sides) {
+            periodic.ShowStats();
+        }
         std::cout << "Simulation exiting" << std::endl;
 
         // Explicitly clear vectors to free memory
@@ -183,12 +230,14 @@ void runSimulation(float E_bottom, float drop_height, const path& master_dir) {
         points.clear();
         forces.shrink_to_fit();
         points.shrink_to_fit();
+        return time_per_step;
 
     } catch (const std::bad_alloc& e) {
         std::cerr << "Memory allocation failed: " << e.what() << std::endl;
     } catch (const std::exception& e) {
         std::cerr << "An error occurred: " << e.what() << std::endl;
     }
+    return 0.;
 }
 
 int main() {
@@ -201,6 +250,20 @@ int main() {
     path master_dir = current_path() / "SimulationResults_datamay22";
     create_directories(master_dir);
 
+    // Cost of periodic sides over side walls: run the first case both ways and compare the drop's wall time per step.
+    // The walled run makes one solver call per output frame. The periodic run makes one per step while any particle
+    // is within a halo of a seam, which in this bed is always, and at every image update (every 10 steps, or sooner
+    // when a particle nears a seam) it also reads back all positions and velocities. The extra cost is a host round
+    // trip per step, roughly independent of the bed size, so it weighs most on small beds like this one.
+    bool measure_periodic_cost = false;
+    if (measure_periodic_cost) {
+        double walled = runSimulation(bottom_boundary_E[0], drop_heights[0], master_dir, false);
+        double periodic = runSimulation(bottom_boundary_E[0], drop_heights[0], master_dir, true);
+        std::cout << "Wall time per step: " << 1e6 * walled << " us with side walls, " << 1e6 * periodic
+                  << " us with periodic sides (" << periodic / walled << " times)" << std::endl;
+        return 0;
+    }
+
     // Iterate over parameters and run simulations
     for (float E_bottom : bottom_boundary_E) {
             for (float drop_height : drop_heights) {
@@ -0,0 +1,67 @@
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "utils/Timeline.hpp"
+
+using namespace deme;
+
+// Checks that EventTimeline lands exactly on scheduled times when a stretch is not a whole number of steps: a During
+// window 2.5 steps long, followed by an event at its end and a bulk stretch of 997.5 steps to the end time. The
+// window must take 3 callbacks (2 steps and a half step), and the event and the end must fall on their times rather
+// than one step later.
+
+int main() {
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity("ERROR");
+
+    auto mat_type = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.5}, {"mu", 0.3}, {"Crr", 0.0}});
+    DEMSim.InstructBoxDomainDimension({-0.1, 0.1}, {-0.1, 0.1}, {0, 0.2});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type);
+    auto sphere_type = DEMSim.LoadSphereType(1e-3, 0.005, mat_type);
+    auto sphere = DEMSim.AddClumps(sphere_type, make_float3(0, 0, 0.1));
+    auto tracker = DEMSim.Track(sphere);
+
+    double step_size = 1e-4;
+    DEMSim.SetInitTimeStep(step_size);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.Initialize();
+
+    double window_start = 0.1, window_end = 0.1 + 2.5 * step_size, end_time = 0.2;
+    EventTimeline timeline(step_size);
+    timeline.SetVerbose(false);
+    int window_calls = 0;
+    double event_sim_time = -1.;
+    timeline.During(window_start, window_end, [&](DEMSolver&, double) {
+        tracker->AddAcc(make_float3(0, 0, 1.));
+        window_calls++;
+    });
+    timeline.At(window_end, "mark", [&](DEMSolver& sim) { event_sim_time = sim.GetSimTime(); });
+    timeline.AdvanceTo(DEMSim, end_time);
+
+    double tol = 1e-3 * step_size;
+    bool ok = true;
+    if (window_calls != 3) {
+        std::cout << "Window took " << window_calls << " steps, expected 3" << std::endl;
+        ok = false;
+    }
+    if (std::abs(event_sim_time - window_end) > tol) {
+        std::cout << "Event at the window end ran at t = " << event_sim_time << ", expected " << window_end
+                  << std::endl;
+        ok = false;
+    }
+    if (std::abs(DEMSim.GetSimTime() - end_time) > tol) {
+        std::cout << "Timeline ended at t = " << DEMSim.GetSimTime() << ", expected " << end_time << std::endl;
+        ok = false;
+    }
+    // The solver's own step size is restored after a short step
+    if (std::abs(DEMSim.GetTimeStepSize() - step_size) > tol) {
+        std::cout << "Step size left at " << DEMSim.GetTimeStepSize() << ", expected " << step_size << std::endl;
+        ok = false;
+    }
+    std::cout << (ok ? "Timeline check passed" : "Timeline check FAILED") << std::endl;
+    return ok ? 0 : 1;
+}
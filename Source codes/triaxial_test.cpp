@@ -0,0 +1,183 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Confined compression of a bonded sample, after the PFC triaxial_test.lua
+// setup. For each confining pressure, a cylinder of spheres is packed and
+// relaxed in a rigid mould and bonded with the parallel bond model
+// (Force models/ParallelBond.cu). The mould is then replaced by a flexible
+// sleeve (TriaxialTest), the sample is brought to an isotropic stress equal to
+// the confining pressure, and the top platen is driven down at a constant
+// strain rate until the deviator stress falls to 85% of its peak.
+//
+// PFC restores one saved, bonded sample for every confinement. Here each case
+// starts from a new solver with the same seeded packing instead.
+// =============================================================================
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/DensePacker.hpp"
+#include "utils/TriaxialTest.hpp"
+
+using namespace deme;
+
+// Sample and grains, scaled from the PFC test (radius 1, height 3, grains 0.05-0.1)
+const float sample_radius = 0.025;
+const float sample_height = 0.075;
+const float r_small = 1.25e-3, r_large = 2.5e-3;
+const float grain_density = 2.6e3;
+
+// Runs one confining pressure; returns the peak deviator stress
+double RunCase(double confinement, const std::filesystem::path& out_dir) {
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity(INFO);
+    DEMSim.SetOutputFormat(OUTPUT_FORMAT::CSV);
+    DEMSim.SetOutputContent(OUTPUT_CONTENT::ABSV);
+
+    // The bond as in bonded_ucs.cpp (pb_ten 2e5, pb_coh 2e6 as in PFC); walls get pb_rmul = 0 so they never bond
+    float pb_gap = 0.1 * r_small;
+    std::unordered_map<std::string, float> grain_props = {{"E", 1e8},
+                                                          {"nu", 0.3},
+                                                          {"CoR", 0.5},
+                                                          {"mu", 0.3},
+                                                          {"Crr", 0.0},
+                                                          {"pb_E", 1e8},
+                                                          {"pb_kratio", 1},
+                                                          {"pb_ten", 2e5},
+                                                          {"pb_coh", 2e6},
+                                                          {"pb_rmul", 1},
+                                                          {"pb_gap", pb_gap},
+                                                          {"pb_install", 0}};
+    auto mat_type_grain = DEMSim.LoadMaterial(grain_props);
+    grain_props["pb_install"] = 1;
+    auto mat_type_bonding = DEMSim.LoadMaterial(grain_props);
+    auto mat_type_wall = DEMSim.LoadMaterial({{"E", 1e9},
+                                              {"nu", 0.3},
+                                              {"CoR", 0.5},
+                                              {"mu", 0.0},
+                                              {"Crr", 0.0},
+                                              {"pb_E", 0},
+                                              {"pb_kratio", 1},
+                                              {"pb_ten", 0},
+                                              {"pb_coh", 0},
+                                              {"pb_rmul", 0},
+                                              {"pb_gap", 0},
+                                              {"pb_install", 0}});
+
+    std::filesystem::path model_file = std::filesystem::path(__FILE__).parent_path() / "Force models/ParallelBond.cu";
+    auto bond_model = DEMSim.ReadContactForceModel(model_file.string());
+    bond_model->SetMustHaveMatProp(
+        {"E", "nu", "CoR", "mu", "pb_E", "pb_kratio", "pb_ten", "pb_coh", "pb_rmul", "pb_gap", "pb_install"});
+    bond_model->SetMustPairwiseMatProp({"CoR", "mu"});
+    bond_model->SetPerContactWildcards({"delta_time", "delta_tan_x", "delta_tan_y", "delta_tan_z", "pb_state", "pb_fn",
+                                        "pb_fs_x", "pb_fs_y", "pb_fs_z"});
+
+    DEMSim.InstructBoxDomainDimension(0.2, 0.2, 0.2);
+    DEMSim.InstructBoxDomainBoundingBC("none", mat_type_wall);
+    double bottom = -sample_height / 2;
+
+    // Rigid mould for packing and bonding; the sleeve takes over afterwards
+    auto mould = DEMSim.AddExternalObject();
+    mould->AddCylinder(make_float3(0), make_float3(0, 0, 1), sample_radius, mat_type_wall, 0);
+    mould->SetFamily(10);
+    DEMSim.SetFamilyFixed(10);
+
+    // Platens and a rubber sleeve, 0.5 mm thick
+    TriaxialTest test(DEMSim, mat_type_wall);
+    test.SetCylinder(make_float3(0, 0, bottom), sample_radius, sample_height);
+    test.SetSleeve(5e-4, 1e7, 0.45, 1.1e3, 2 * r_large);
+    test.Build(out_dir.string());
+    DEMSim.DisableContactBetweenFamilies(10, test.GetSleeveFamily());
+
+    // Grains: two sizes, equal numbers, the same packing for every case
+    std::vector<float> radii = {r_small, r_large};
+    std::vector<std::shared_ptr<DEMClumpTemplate>> grain_types;
+    for (float r : radii) {
+        float mass = grain_density * 4. / 3. * PI * r * r * r;
+        grain_types.push_back(DEMSim.LoadSphereType(mass, r, mat_type_grain));
+    }
+    DensePacker packer(radii, {1.f, 1.f});
+    packer.SetCylinderZ(make_float3(0, 0, bottom), sample_radius, sample_height);
+    packer.SetSeed(1);
+    auto input_xyz = packer.Pack();
+    std::vector<std::shared_ptr<DEMClumpTemplate>> input_types;
+    for (unsigned int id : packer.GetClassIds()) {
+        input_types.push_back(grain_types[id]);
+    }
+    auto grains = DEMSim.AddClumps(input_types, input_xyz);
+    std::cout << "Total num of particles: " << grains->GetNumClumps() << std::endl;
+    DEMSim.SetFamilyExtraMargin(0, 2 * pb_gap);
+
+    float step_size = 1e-6;
+    DEMSim.SetInitTimeStep(step_size);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, 0));
+    DEMSim.SetMaxVelocity(5.);
+    DEMSim.Initialize();
+    test.Start();
+    test.GetSleeve()->SetDamping(50.);
+
+    // Relax and bond, stress free
+    DEMSim.DoDynamicsThenSync(0.01);
+    DEMSim.SetFamilyClumpMaterial(0, mat_type_bonding);
+    DEMSim.DoDynamicsThenSync(2 * step_size);
+    DEMSim.SetFamilyClumpMaterial(0, mat_type_grain);
+
+    // Swap the mould for the sleeve and bring the sample to the confining pressure, in five steps
+    DEMSim.DisableContactBetweenFamilies(0, 10);
+    test.SetControlInterval(1e-4);
+    test.RampIsotropic(confinement, confinement / 5, 0.005, 0.01);
+    test.ShowStats();
+
+    // Shear at 10% axial strain per second, at constant confinement
+    test.ResetStrain();
+    test.SetAxialStrainRate(0.1);
+    float frame_time = 5e-3;
+    unsigned int frame_count = 0;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    while (!test.PastPeak(0.85, 0.005) && test.GetAxialStrain() < 0.1) {
+        test.Advance(frame_time);
+        char filename[200];
+        sprintf(filename, "%s/DEMdemo_%g_output_%04d.csv", out_dir.c_str(), confinement, frame_count++);
+        DEMSim.WriteSphereFile(std::string(filename));
+        test.ShowStats();
+    }
+    std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> time_sec = std::chrono::duration_cast<std::chrono::duration<double>>(end - start);
+    std::cout << time_sec.count() << " seconds (wall time) to shear the sample" << std::endl;
+
+    char filename[200];
+    sprintf(filename, "%s/triaxial_%g.csv", out_dir.c_str(), confinement);
+    test.WriteCsv(std::string(filename));
+    DEMSim.ShowTimingStats();
+    return test.GetPeakDeviatorStress();
+}
+
+int main() {
+    std::filesystem::path out_dir = std::filesystem::current_path();
+    out_dir += "/DemoOutput_TriaxialTest";
+    std::filesystem::create_directory(out_dir);
+
+    std::vector<double> confinements = {1e4, 5e4, 1e5};
+    std::vector<double> peaks;
+    for (double p : confinements) {
+        peaks.push_back(RunCase(p, out_dir));
+    }
+    for (size_t i = 0; i < confinements.size(); i++) {
+        std::cout << "Confinement " << confinements[i] << " Pa: peak deviator stress " << peaks[i] << " Pa"
+                  << std::endl;
+    }
+    std::cout << "TriaxialTest demo exiting..." << std::endl;
+    return 0;
+}
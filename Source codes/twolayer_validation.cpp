@@ -19,6 +19,8 @@
 #include <time.h>
 #include <filesystem>
 
+#include "utils/LayerDeposition.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
@@ -29,9 +31,6 @@ int main() {
     DEMSim.SetContactOutputContent({"OWNER", "FORCE", "POINT", "COMPONENT", "NORMAL", "TORQUE"});
     DEMSim.EnsureKernelErrMsgLineNum();
 
-    // srand(time(NULL));
-    srand(4150);
-
     // Special material: has a cohesion param
     auto mat_type_1 =
         DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.8}, {"mu", 0.3}, {"Crr", 0.01}});
@@ -77,8 +76,26 @@ int main() {
     path out_dir = current_path() / "DEM_particlelattice_simulation";
     create_directory(out_dir); // Ensure this directory exists
 
+    // Each layer is settled until it comes to rest (at most settle_time_per_layer); only the newest layer is
+    // simulated, the ones below it are frozen
+    LayerDeposition deposition(DEMSim, 0, 9);
+    deposition.SetActiveLayers(0);
+    deposition.SetSettleCriterion(0.01, settle_time_per_layer, frame_time);
+    deposition.Configure();
+
     DEMSim.Initialize();
     
+    auto write_frame = [&]() {
+        char filename[200], meshfilename[200];
+        sprintf(filename, "%s/DEM_particlelattice_out_%04d.csv", out_dir.c_str(), globalFrame);
+        sprintf(meshfilename, "%s/DEM_particlelattice_%04d.vtk", out_dir.c_str(), globalFrame);
+
+        DEMSim.WriteSphereFile(std::string(filename));
+        DEMSim.WriteMeshFile(std::string(meshfilename));
+
+        globalFrame++; // Increment the global frame counter
+    };
+
     for (int layer = 0; layer < totalLayers; ++layer) {
         positions.clear();
         clump_types.clear();
@@ -94,22 +111,14 @@ int main() {
             clump_types.push_back(sph_type_1); // Assuming sph_type_1 is defined as before
         }
 
-        //add layer n to the simulation
-        auto particles = DEMSim.AddClumps(clump_types, positions);
-
-        // Simulate and output for the current layer
-        for (float t = 0; t < settle_time_per_layer; t += frame_time) {
-            char filename[200], meshfilename[200];
-            sprintf(filename, "%s/DEM_particlelattice_out_%04d.csv", out_dir.c_str(), globalFrame);
-            sprintf(meshfilename, "%s/DEM_particlelattice_%04d.vtk", out_dir.c_str(), globalFrame);
-
-            DEMSim.WriteSphereFile(std::string(filename));
-            DEMSim.WriteMeshFile(std::string(meshfilename));
-
-            DEMSim.DoDynamicsThenSync(frame_time); // Advance the simulation by frame_time
-
-            globalFrame++; // Increment the global frame counter
-        }
+        //add layer n to the simulation and settle it, with output every frame
+        deposition.Deposit(clump_types, positions, write_frame);
+        deposition.ShowStats();
     }
+
+    // The validated state is the whole bed at rest: wake the frozen layers and settle them together
+    deposition.UnfreezeAll();
+    deposition.Settle(write_frame);
+    deposition.ShowStats();
     return 0;    
 }
\ No newline at end of file
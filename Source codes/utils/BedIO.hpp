@@ -0,0 +1,274 @@
+// =============================================================================
+// Fast loading of saved particle beds.
+//
+// DEMSolver::ReadClumpXyzFromCsv and ReadClumpQuatFromCsv each parse the whole
+// clump file into maps keyed by template name, so reloading a bed parses it
+// twice and then looks templates up by formatted strings. ReadBedCsv parses
+// the file once: it is read in one go, split into per-thread chunks at line
+// breaks, and parsed into struct-of-arrays positions, quaternions and template
+// ids (indices into a table of template names, in order of first appearance).
+//
+// A bed can also be stored in a binary format (WriteBedBinary). LoadBed picks
+// the binary copy `<file>.bin' when it is newer than the CSV and writes it
+// after the first CSV parse, so repeated runs skip the text parsing.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_BED_IO_HPP
+#define DEME_DRIVERS_BED_IO_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace deme;
+
+struct BedData {
+    std::vector<float3> xyz;
+    // (x, y, z, w), as DEME stores quaternions
+    std::vector<float4> quat;
+    std::vector<unsigned int> type_ids;
+    std::vector<std::string> type_names;
+
+    size_t size() const { return xyz.size(); }
+
+    // Map every template name to a template, e.g. [&](const std::string& name) { return templates[std::stoi(name)]; },
+    // and return the template of each particle
+    template <typename F>
+    std::vector<std::shared_ptr<DEMClumpTemplate>> TemplatesByName(F&& lookup) const {
+        std::vector<std::shared_ptr<DEMClumpTemplate>> by_id;
+        for (const auto& name : type_names) {
+            by_id.push_back(lookup(name));
+        }
+        std::vector<std::shared_ptr<DEMClumpTemplate>> per_particle(type_ids.size());
+        for (size_t i = 0; i < type_ids.size(); i++) {
+            per_particle[i] = by_id[type_ids[i]];
+        }
+        return per_particle;
+    }
+};
+
+// Column names default to what DEMSolver::WriteClumpFile writes. Quaternion columns are optional (identity if absent).
+inline BedData ReadBedCsv(const std::string& filename,
+                          unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency()),
+                          const std::string& type_header = "clump_type",
+                          const std::vector<std::string>& xyz_headers = {"X", "Y", "Z"},
+                          const std::vector<std::string>& quat_headers = {"Qw", "Qx", "Qy", "Qz"}) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open bed file " + filename);
+    }
+    std::string buf(file.tellg(), '\0');
+    file.seekg(0);
+    file.read(&buf[0], buf.size());
+
+    // Header
+    size_t header_end = buf.find('\n');
+    if (header_end == std::string::npos) {
+        header_end = buf.size();
+    }
+    std::vector<std::string> header;
+    {
+        size_t b = 0;
+        while (b <= header_end) {
+            size_t e = std::min(buf.find(',', b), header_end);
+            std::string col = buf.substr(b, e - b);
+            col.erase(std::remove_if(col.begin(), col.end(), [](char c) { return c == '\r' || c == ' '; }), col.end());
+            header.push_back(col);
+            b = e + 1;
+        }
+    }
+    auto column = [&](const std::string& name) {
+        auto it = std::find(header.begin(), header.end(), name);
+        return (it == header.end()) ? -1 : (int)(it - header.begin());
+    };
+    int col_type = column(type_header);
+    int col_xyz[3], col_q[4];
+    for (int d = 0; d < 3; d++) {
+        col_xyz[d] = column(xyz_headers.at(d));
+    }
+    bool has_quat = true;
+    for (int d = 0; d < 4; d++) {
+        col_q[d] = column(quat_headers.at(d));
+        has_quat = has_quat && col_q[d] >= 0;
+    }
+    if (col_type < 0 || col_xyz[0] < 0 || col_xyz[1] < 0 || col_xyz[2] < 0) {
+        throw std::runtime_error("Bed file " + filename + " lacks the template name or position columns");
+    }
+    int num_cols = header.size();
+
+    // Chunks start right after a line break
+    num_threads = std::max(1u, num_threads);
+    std::vector<size_t> starts(num_threads + 1, buf.size());
+    starts[0] = std::min(header_end + 1, buf.size());
+    for (unsigned int t = 1; t < num_threads; t++) {
+        size_t guess = starts[0] + (buf.size() - starts[0]) * t / num_threads;
+        size_t nl = buf.find('\n', std::max(guess, starts[t - 1]));
+        starts[t] = (nl == std::string::npos) ? buf.size() : nl + 1;
+    }
+
+    struct Chunk {
+        std::vector<float3> xyz;
+        std::vector<float4> quat;
+        std::vector<unsigned int> local_ids;
+        std::vector<std::string> names;
+    };
+    std::vector<Chunk> chunks(num_threads);
+    auto parse = [&](unsigned int t) {
+        Chunk& ch = chunks[t];
+        std::unordered_map<std::string, unsigned int> name_ids;
+        std::vector<const char*> fields(num_cols);
+        std::vector<size_t> lens(num_cols);
+        const char* p = buf.data() + starts[t];
+        const char* end = buf.data() + starts[t + 1];
+        while (p < end) {
+            const char* eol = (const char*)std::memchr(p, '\n', end - p);
+            if (!eol) {
+                eol = end;
+            }
+            int n = 0;
+            const char* f = p;
+            while (n < num_cols) {
+                const char* comma = (const char*)std::memchr(f, ',', eol - f);
+                const char* fe = comma ? comma : eol;
+                fields[n] = f;
+                lens[n] = fe - f;
+                n++;
+                if (!comma) {
+                    break;
+                }
+                f = comma + 1;
+            }
+            if (n == num_cols) {
+                ch.xyz.push_back(make_float3(std::strtof(fields[col_xyz[0]], nullptr),
+                                             std::strtof(fields[col_xyz[1]], nullptr),
+                                             std::strtof(fields[col_xyz[2]], nullptr)));
+                if (has_quat) {
+                    ch.quat.push_back(make_float4(
+                        std::strtof(fields[col_q[1]], nullptr), std::strtof(fields[col_q[2]], nullptr),
+                        std::strtof(fields[col_q[3]], nullptr), std::strtof(fields[col_q[0]], nullptr)));
+                } else {
+                    ch.quat.push_back(make_float4(0, 0, 0, 1));
+                }
+                std::string name(fields[col_type], lens[col_type]);
+                name.erase(std::remove_if(name.begin(), name.end(), [](char c) { return c == '\r' || c == ' '; }),
+                           name.end());
+                auto it = name_ids.find(name);
+                if (it == name_ids.end()) {
+                    it = name_ids.emplace(name, ch.names.size()).first;
+                    ch.names.push_back(name);
+                }
+                ch.local_ids.push_back(it->second);
+            }
+            p = eol + 1;
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 1; t < num_threads; t++) {
+        threads.emplace_back(parse, t);
+    }
+    parse(0);
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    // Merge in chunk order, so rows keep the file order
+    BedData bed;
+    std::unordered_map<std::string, unsigned int> global_ids;
+    for (auto& ch : chunks) {
+        std::vector<unsigned int> remap(ch.names.size());
+        for (size_t k = 0; k < ch.names.size(); k++) {
+            auto it = global_ids.find(ch.names[k]);
+            if (it == global_ids.end()) {
+                it = global_ids.emplace(ch.names[k], bed.type_names.size()).first;
+                bed.type_names.push_back(ch.names[k]);
+            }
+            remap[k] = it->second;
+        }
+        bed.xyz.insert(bed.xyz.end(), ch.xyz.begin(), ch.xyz.end());
+        bed.quat.insert(bed.quat.end(), ch.quat.begin(), ch.quat.end());
+        for (unsigned int id : ch.local_ids) {
+            bed.type_ids.push_back(remap[id]);
+        }
+    }
+    return bed;
+}
+
+// Binary layout: "DEMEBED1", uint64 num_particles, uint64 num_names, each name as uint32 length + bytes, then
+// num_particles float3 positions, float4 quaternions and uint32 template ids
+inline void WriteBedBinary(const std::string& filename, const BedData& bed) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open " + filename + " for writing");
+    }
+    uint64_t n = bed.size(), num_names = bed.type_names.size();
+    file.write("DEMEBED1", 8);
+    file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    file.write(reinterpret_cast<const char*>(&num_names), sizeof(num_names));
+    for (const auto& name : bed.type_names) {
+        uint32_t len = name.size();
+        file.write(reinterpret_cast<const char*>(&len), sizeof(len));
+        file.write(name.data(), len);
+    }
+    file.write(reinterpret_cast<const char*>(bed.xyz.data()), n * sizeof(float3));
+    file.write(reinterpret_cast<const char*>(bed.quat.data()), n * sizeof(float4));
+    file.write(reinterpret_cast<const char*>(bed.type_ids.data()), n * sizeof(unsigned int));
+}
+
+inline BedData ReadBedBinary(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open bed file " + filename);
+    }
+    char magic[8];
+    file.read(magic, 8);
+    if (!file || std::strncmp(magic, "DEMEBED1", 8) != 0) {
+        throw std::runtime_error(filename + " is not a binary bed file");
+    }
+    BedData bed;
+    uint64_t n = 0, num_names = 0;
+    file.read(reinterpret_cast<char*>(&n), sizeof(n));
+    file.read(reinterpret_cast<char*>(&num_names), sizeof(num_names));
+    for (uint64_t k = 0; k < num_names; k++) {
+        uint32_t len = 0;
+        file.read(reinterpret_cast<char*>(&len), sizeof(len));
+        std::string name(len, '\0');
+        file.read(&name[0], len);
+        bed.type_names.push_back(name);
+    }
+    bed.xyz.resize(n);
+    bed.quat.resize(n);
+    bed.type_ids.resize(n);
+    file.read(reinterpret_cast<char*>(bed.xyz.data()), n * sizeof(float3));
+    file.read(reinterpret_cast<char*>(bed.quat.data()), n * sizeof(float4));
+    file.read(reinterpret_cast<char*>(bed.type_ids.data()), n * sizeof(unsigned int));
+    if (!file) {
+        throw std::runtime_error("Bed file " + filename + " is truncated");
+    }
+    return bed;
+}
+
+// Load a bed saved as CSV, through its binary copy <filename>.bin when that is up to date; the copy is (re)written
+// otherwise
+inline BedData LoadBed(const std::string& filename) {
+    namespace fs = std::filesystem;
+    std::string bin_name = filename + ".bin";
+    if (fs::exists(bin_name) && fs::last_write_time(bin_name) >= fs::last_write_time(filename)) {
+        return ReadBedBinary(bin_name);
+    }
+    BedData bed = ReadBedCsv(filename);
+    WriteBedBinary(bin_name, bed);
+    return bed;
+}
+
+#endif
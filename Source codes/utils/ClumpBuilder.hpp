@@ -0,0 +1,678 @@
+// =============================================================================
+// Multi-sphere clump templates from particle shape descriptors.
+//
+// A target shape (ellipsoid or aspect ratio, superquadric, closed mesh, or any
+// inside predicate) is voxelized and its Euclidean distance transform gives
+// the largest inscribed sphere at every voxel. Spheres are then picked greedily
+// among the maximal inscribed spheres (those not contained in a neighbor's) by
+// how much of the still uncovered volume they add, so a given coverage of the
+// shape is reached with few spheres. Each picked radius is then grown to touch
+// the true surface, and no sphere sticks out of the shape.
+//
+// Mass properties of a clump are integrated over the union of its spheres, so
+// overlaps are counted once: for each column of a fine xy grid the sphere
+// chords are merged and the moments along z are integrated exactly. The
+// inertia tensor is diagonalized (Jacobi), and Load hands LoadClumpType the
+// spheres in the principal frame with the exact volume, mass and MOI.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_CLUMP_BUILDER_HPP
+#define DEME_DRIVERS_CLUMP_BUILDER_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MeshVolume.hpp"
+
+using namespace deme;
+
+struct ClumpSpheres {
+    std::vector<float> radii;
+    std::vector<float3> pos;
+
+    size_t size() const { return radii.size(); }
+
+    // Radius of the smallest origin-centered sphere enclosing the clump
+    float BoundingRadius() const {
+        float r = 0.f;
+        for (size_t i = 0; i < radii.size(); i++) {
+            r = std::max(r, length(pos[i]) + radii[i]);
+        }
+        return r;
+    }
+};
+
+// Read a clump file in DEME's format (columns x, y, z, r in any order, with a header line)
+inline ClumpSpheres ReadClumpCsv(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file) {
+        throw std::runtime_error("Cannot open clump file " + filename);
+    }
+    std::string line, cell;
+    std::getline(file, line);
+    int col[4] = {-1, -1, -1, -1};
+    const std::string names[4] = {"x", "y", "z", "r"};
+    std::stringstream header(line);
+    for (int c = 0; std::getline(header, cell, ','); c++) {
+        cell.erase(std::remove_if(cell.begin(), cell.end(), ::isspace), cell.end());
+        for (int k = 0; k < 4; k++) {
+            if (cell == names[k]) {
+                col[k] = c;
+            }
+        }
+    }
+    if (*std::min_element(col, col + 4) < 0) {
+        throw std::runtime_error("Clump file " + filename + " needs x, y, z and r columns");
+    }
+    ClumpSpheres spheres;
+    while (std::getline(file, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::vector<float> values;
+        std::stringstream row(line);
+        while (std::getline(row, cell, ',')) {
+            values.push_back(std::stof(cell));
+        }
+        spheres.pos.push_back(make_float3(values.at(col[0]), values.at(col[1]), values.at(col[2])));
+        spheres.radii.push_back(values.at(col[3]));
+    }
+    return spheres;
+}
+
+inline void WriteClumpCsv(const std::string& filename, const ClumpSpheres& spheres) {
+    std::ofstream file(filename);
+    file.precision(9);
+    file << "x,y,z,r\n";
+    for (size_t i = 0; i < spheres.size(); i++) {
+        file << spheres.pos[i].x << "," << spheres.pos[i].y << "," << spheres.pos[i].z << "," << spheres.radii[i]
+             << "\n";
+    }
+}
+
+struct ClumpMassProperties {
+    double volume = 0.;
+    float3 centroid;
+    // Principal moments of inertia per unit density, about the centroid
+    float3 MOI;
+    // Principal axes (a right-handed frame) in the clump's input frame
+    float3 axes[3];
+    // Rotation taking the principal frame to the input frame, (x, y, z, w)
+    float4 principal_q;
+};
+
+namespace clump_builder_detail {
+
+// Eigen-decomposition of a symmetric 3x3 matrix by cyclic Jacobi rotations; the columns of V are the eigenvectors
+inline void Jacobi3(double A[3][3], double eig[3], double V[3][3]) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            V[i][j] = (i == j);
+        }
+    }
+    for (int sweep = 0; sweep < 50; sweep++) {
+        double off = A[0][1] * A[0][1] + A[0][2] * A[0][2] + A[1][2] * A[1][2];
+        double diag = A[0][0] * A[0][0] + A[1][1] * A[1][1] + A[2][2] * A[2][2];
+        if (off <= 1e-24 * diag) {
+            break;
+        }
+        for (int p = 0; p < 2; p++) {
+            for (int q = p + 1; q < 3; q++) {
+                if (A[p][q] == 0.) {
+                    continue;
+                }
+                double theta = (A[q][q] - A[p][p]) / (2. * A[p][q]);
+                double t = ((theta >= 0.) ? 1. : -1.) / (std::abs(theta) + std::sqrt(theta * theta + 1.));
+                double c = 1. / std::sqrt(t * t + 1.), s = t * c;
+                for (int k = 0; k < 3; k++) {
+                    double akp = A[k][p], akq = A[k][q];
+                    A[k][p] = c * akp - s * akq;
+                    A[k][q] = s * akp + c * akq;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double apk = A[p][k], aqk = A[q][k];
+                    A[p][k] = c * apk - s * aqk;
+                    A[q][k] = s * apk + c * aqk;
+                }
+                for (int k = 0; k < 3; k++) {
+                    double vkp = V[k][p], vkq = V[k][q];
+                    V[k][p] = c * vkp - s * vkq;
+                    V[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        eig[i] = A[i][i];
+    }
+}
+
+// Quaternion (x, y, z, w) of a rotation matrix
+inline float4 MatrixToQuat(const double R[3][3]) {
+    double tr = R[0][0] + R[1][1] + R[2][2];
+    double x, y, z, w;
+    if (tr > 0.) {
+        double s = 2. * std::sqrt(tr + 1.);
+        w = 0.25 * s;
+        x = (R[2][1] - R[1][2]) / s;
+        y = (R[0][2] - R[2][0]) / s;
+        z = (R[1][0] - R[0][1]) / s;
+    } else if (R[0][0] > R[1][1] && R[0][0] > R[2][2]) {
+        double s = 2. * std::sqrt(1. + R[0][0] - R[1][1] - R[2][2]);
+        w = (R[2][1] - R[1][2]) / s;
+        x = 0.25 * s;
+        y = (R[0][1] + R[1][0]) / s;
+        z = (R[0][2] + R[2][0]) / s;
+    } else if (R[1][1] > R[2][2]) {
+        double s = 2. * std::sqrt(1. + R[1][1] - R[0][0] - R[2][2]);
+        w = (R[0][2] - R[2][0]) / s;
+        x = (R[0][1] + R[1][0]) / s;
+        y = 0.25 * s;
+        z = (R[1][2] + R[2][1]) / s;
+    } else {
+        double s = 2. * std::sqrt(1. + R[2][2] - R[0][0] - R[1][1]);
+        w = (R[1][0] - R[0][1]) / s;
+        x = (R[0][2] + R[2][0]) / s;
+        y = (R[1][2] + R[2][1]) / s;
+        z = 0.25 * s;
+    }
+    return make_float4(x, y, z, w);
+}
+
+template <typename F>
+void ParallelFor(size_t n, unsigned int num_threads, F&& func) {
+    std::vector<std::thread> threads;
+    size_t chunk = (n + num_threads - 1) / num_threads;
+    for (size_t begin = 0; begin < n; begin += chunk) {
+        size_t end = std::min(begin + chunk, n);
+        threads.emplace_back([&, begin, end]() {
+            for (size_t i = begin; i < end; i++) {
+                func(i);
+            }
+        });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+}
+
+// Squared 1D distance transform of f (Felzenszwalb and Huttenlocher), in place, with scratch space
+inline void DistanceTransform1D(std::vector<double>& f, std::vector<double>& d, std::vector<int>& v,
+                                std::vector<double>& z) {
+    int n = f.size();
+    const double inf = std::numeric_limits<double>::infinity();
+    d.resize(n);
+    v.resize(n);
+    z.resize(n + 1);
+    int k = 0;
+    v[0] = 0;
+    z[0] = -inf;
+    z[1] = inf;
+    for (int q = 1; q < n; q++) {
+        if (f[q] == inf) {
+            continue;
+        }
+        if (f[v[k]] == inf) {
+            v[k] = q;
+            continue;
+        }
+        double s = ((f[q] + (double)q * q) - (f[v[k]] + (double)v[k] * v[k])) / (2. * q - 2. * v[k]);
+        while (s <= z[k]) {
+            k--;
+            s = ((f[q] + (double)q * q) - (f[v[k]] + (double)v[k] * v[k])) / (2. * q - 2. * v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = inf;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++) {
+        while (z[k + 1] < q) {
+            k++;
+        }
+        d[q] = (f[v[k]] == inf) ? inf : (double)(q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+    f = d;
+}
+
+}  // namespace clump_builder_detail
+
+// Volume, centroid and principal inertia from the moments V, Sx, Sy, Sz, Sxx, Syy, Szz, Sxy, Sxz, Syz of a body
+inline ClumpMassProperties MassPropertiesFromMoments(const std::array<double, 10>& m) {
+    using namespace clump_builder_detail;
+    ClumpMassProperties props;
+    double V = m[0];
+    double cx = m[1] / V, cy = m[2] / V, cz = m[3] / V;
+    // Second moments about the centroid
+    double xx = m[4] - V * cx * cx, yy = m[5] - V * cy * cy, zz = m[6] - V * cz * cz;
+    double xy = m[7] - V * cx * cy, xz = m[8] - V * cx * cz, yz = m[9] - V * cy * cz;
+    double I[3][3] = {{yy + zz, -xy, -xz}, {-xy, xx + zz, -yz}, {-xz, -yz, xx + yy}};
+    double eig[3], R[3][3];
+    Jacobi3(I, eig, R);
+    // Keep the principal frame right-handed
+    double det = R[0][0] * (R[1][1] * R[2][2] - R[1][2] * R[2][1]) - R[0][1] * (R[1][0] * R[2][2] - R[1][2] * R[2][0]) +
+                 R[0][2] * (R[1][0] * R[2][1] - R[1][1] * R[2][0]);
+    if (det < 0.) {
+        for (int k = 0; k < 3; k++) {
+            R[k][2] = -R[k][2];
+        }
+    }
+    props.volume = V;
+    props.centroid = make_float3(cx, cy, cz);
+    props.MOI = make_float3(eig[0], eig[1], eig[2]);
+    for (int a = 0; a < 3; a++) {
+        props.axes[a] = make_float3(R[0][a], R[1][a], R[2][a]);
+    }
+    props.principal_q = MatrixToQuat(R);
+    return props;
+}
+
+// Volume, centroid and principal inertia of the union of the spheres. resolution is the number of xy columns along
+// the longer side of the clump's bounding box.
+inline ClumpMassProperties ComputeClumpMassProperties(
+    const ClumpSpheres& spheres,
+    unsigned int resolution = 400,
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency())) {
+    using namespace clump_builder_detail;
+    if (spheres.size() == 0) {
+        throw std::runtime_error("ComputeClumpMassProperties needs at least one sphere");
+    }
+    float3 lo = spheres.pos[0], hi = spheres.pos[0];
+    for (size_t i = 0; i < spheres.size(); i++) {
+        float r = spheres.radii[i];
+        const float3& p = spheres.pos[i];
+        lo = make_float3(std::min(lo.x, p.x - r), std::min(lo.y, p.y - r), std::min(lo.z, p.z - r));
+        hi = make_float3(std::max(hi.x, p.x + r), std::max(hi.y, p.y + r), std::max(hi.z, p.z + r));
+    }
+    double h = std::max(hi.x - lo.x, hi.y - lo.y) / resolution;
+    int nx = (int)std::ceil((hi.x - lo.x) / h), ny = (int)std::ceil((hi.y - lo.y) / h);
+
+    // Per row of columns: V, Sx, Sy, Sz, Sxx, Syy, Szz, Sxy, Sxz, Syz
+    std::vector<std::array<double, 10>> rows(ny);
+    ParallelFor(ny, num_threads, [&](size_t iy) {
+        std::array<double, 10> m{};
+        std::vector<std::pair<double, double>> chords;
+        double y = lo.y + (iy + 0.5) * h;
+        for (int ix = 0; ix < nx; ix++) {
+            double x = lo.x + (ix + 0.5) * h;
+            chords.clear();
+            for (size_t i = 0; i < spheres.size(); i++) {
+                const float3& p = spheres.pos[i];
+                double r = spheres.radii[i];
+                double q = r * r - (x - p.x) * (x - p.x) - (y - p.y) * (y - p.y);
+                if (q > 0.) {
+                    double half = std::sqrt(q);
+                    chords.push_back({p.z - half, p.z + half});
+                }
+            }
+            if (chords.empty()) {
+                continue;
+            }
+            std::sort(chords.begin(), chords.end());
+            // Merge overlapping chords and integrate 1, z, z^2 along the union
+            double L = 0., Z1 = 0., Z2 = 0.;
+            double a = chords[0].first, b = chords[0].second;
+            for (size_t c = 1; c <= chords.size(); c++) {
+                if (c < chords.size() && chords[c].first <= b) {
+                    b = std::max(b, chords[c].second);
+                    continue;
+                }
+                L += b - a;
+                Z1 += (b * b - a * a) / 2.;
+                Z2 += (b * b * b - a * a * a) / 3.;
+                if (c < chords.size()) {
+                    a = chords[c].first;
+                    b = chords[c].second;
+                }
+            }
+            m[0] += L;
+            m[1] += x * L;
+            m[2] += y * L;
+            m[3] += Z1;
+            m[4] += x * x * L;
+            m[5] += y * y * L;
+            m[6] += Z2;
+            m[7] += x * y * L;
+            m[8] += x * Z1;
+            m[9] += y * Z1;
+        }
+        rows[iy] = m;
+    });
+    std::array<double, 10> m{};
+    for (const auto& r : rows) {
+        for (int k = 0; k < 10; k++) {
+            m[k] += r[k] * h * h;
+        }
+    }
+
+    return MassPropertiesFromMoments(m);
+}
+
+// The spheres expressed in the principal frame of props (centroid at the origin, principal axes along x, y, z), the
+// frame LoadClumpType expects
+inline ClumpSpheres ToPrincipalFrame(const ClumpSpheres& spheres, const ClumpMassProperties& props) {
+    ClumpSpheres out = spheres;
+    for (auto& p : out.pos) {
+        float3 d = p - props.centroid;
+        p = make_float3(dot(d, props.axes[0]), dot(d, props.axes[1]), dot(d, props.axes[2]));
+    }
+    return out;
+}
+
+class ClumpBuilder {
+  public:
+    // resolution is the number of voxels along the longest side of the target shape used for fitting spheres
+    ClumpBuilder(unsigned int resolution = 48) : resolution(resolution) {}
+
+    void SetNumThreads(unsigned int n) { num_threads = std::max(1u, n); }
+    // Number of xy columns along the longer side used to integrate mass properties
+    void SetIntegrationResolution(unsigned int n) { integration_resolution = n; }
+
+    // Any shape given by an inside test over the box [lo, hi]
+    void SetShape(std::function<bool(const float3&)> inside, float3 lo, float3 hi) {
+        shape = std::move(inside);
+        shape_lo = lo;
+        shape_hi = hi;
+    }
+
+    // |x/a|^(2/e2) + |y/b|^(2/e2))^(e2/e1) + |z/c|^(2/e1) <= 1; e1 = e2 = 1 is an ellipsoid, small e's tend to a box
+    void SetSuperquadric(float3 semi_axes, float e1, float e2) {
+        float3 s = semi_axes;
+        SetShape(
+            [=](const float3& p) {
+                double xy = std::pow(std::abs(p.x / s.x), 2. / e2) + std::pow(std::abs(p.y / s.y), 2. / e2);
+                return std::pow(xy, (double)e2 / e1) + std::pow(std::abs(p.z / s.z), 2. / e1) <= 1.;
+            },
+            make_float3(-s.x, -s.y, -s.z), s);
+    }
+
+    void SetEllipsoid(float3 semi_axes) { SetSuperquadric(semi_axes, 1.f, 1.f); }
+
+    // Ellipsoid of unit smallest semi-axis with the given long/short and intermediate/short ratios (long axis along x)
+    void SetAspectRatio(float long_to_short, float mid_to_short = 1.f) {
+        SetEllipsoid(make_float3(long_to_short, mid_to_short, 1.f));
+    }
+
+    // A closed mesh; it must outlive the builder's Fit call
+    void SetMesh(const MeshVolume& mesh) {
+        SetShape([&mesh](const float3& p) { return mesh.Inside(p); }, mesh.GetMin(), mesh.GetMax());
+    }
+
+    // Use these spheres as they are (e.g. from ReadClumpCsv) instead of fitting a shape
+    void SetSpheres(const ClumpSpheres& given) {
+        spheres = given;
+        coverage = -1.f;
+        props_valid = false;
+    }
+
+    // Greedily add inscribed spheres until max_spheres are placed or target_coverage of the shape volume is covered.
+    // A sphere that would add less than 0.1% of the volume is not worth its contact detection cost and is not added.
+    const ClumpSpheres& Fit(unsigned int max_spheres, float target_coverage = 0.97f) {
+        using namespace clump_builder_detail;
+        if (!shape) {
+            throw std::runtime_error("ClumpBuilder::Fit needs a target shape");
+        }
+        Voxelize();
+        spheres = ClumpSpheres();
+        props_valid = false;
+
+        // Centers of maximal inscribed spheres are the candidates
+        struct Candidate {
+            size_t gain;
+            size_t voxel;
+            bool operator<(const Candidate& o) const { return gain < o.gain || (gain == o.gain && voxel > o.voxel); }
+        };
+        std::vector<uint8_t> covered(inside.size(), 0);
+        std::priority_queue<Candidate> queue;
+        size_t min_gain = std::max<size_t>(1, num_inside / 1000);
+        for (size_t v = 0; v < inside.size(); v++) {
+            if (inside[v] && IsMaximal(v)) {
+                // Start from an upper bound of the gain; the loop below evaluates it when the candidate comes up
+                double r = std::sqrt(dist2[v]) - 0.5 + 0.8660254;
+                queue.push({(size_t)std::ceil(4. / 3. * PI * r * r * r), v});
+            }
+        }
+
+        size_t num_covered = 0;
+        while (spheres.size() < max_spheres && !queue.empty() &&
+               (double)num_covered < target_coverage * (double)num_inside) {
+            Candidate c = queue.top();
+            queue.pop();
+            // Gains only shrink as spheres are added; re-evaluate lazily and take c if it still beats the next one
+            size_t gain = Gain(c.voxel, covered);
+            if (gain < min_gain) {
+                continue;
+            }
+            if (!queue.empty() && gain < queue.top().gain) {
+                queue.push({gain, c.voxel});
+                continue;
+            }
+            float r = RefineRadius(VoxelCenter(c.voxel), InscribedRadius(c.voxel));
+            num_covered += Cover(c.voxel, r / voxel, covered);
+            spheres.pos.push_back(VoxelCenter(c.voxel));
+            spheres.radii.push_back(r);
+        }
+        coverage = (float)((double)num_covered / (double)num_inside);
+        return spheres;
+    }
+
+    // Fraction of the target shape's voxels covered by the fitted spheres (-1 if the spheres were given)
+    float GetCoverage() const { return coverage; }
+    // Voxelized volume of the target shape
+    double GetShapeVolume() const { return (double)num_inside * voxel * voxel * voxel; }
+    const ClumpSpheres& GetSpheres() const { return spheres; }
+
+    const ClumpMassProperties& GetMassProperties() {
+        if (!props_valid) {
+            props = ComputeClumpMassProperties(spheres, integration_resolution, num_threads);
+            props_valid = true;
+        }
+        return props;
+    }
+
+    // Spheres moved to the principal frame, as loaded by Load
+    ClumpSpheres GetPrincipalSpheres() { return ToPrincipalFrame(spheres, GetMassProperties()); }
+
+    // Load the clump (in its principal frame) with the mass, MOI and volume of the sphere union at this density
+    std::shared_ptr<DEMClumpTemplate> Load(DEMSolver& sim, float density, std::shared_ptr<DEMMaterial> mat) {
+        const ClumpMassProperties& p = GetMassProperties();
+        ClumpSpheres principal = GetPrincipalSpheres();
+        auto clump = sim.LoadClumpType(density * p.volume, p.MOI * density, principal.radii, principal.pos, mat);
+        clump->SetVolume(p.volume);
+        return clump;
+    }
+
+    void ShowStats() {
+        const ClumpMassProperties& p = GetMassProperties();
+        std::cout << "Clump template: " << spheres.size() << " spheres, volume " << p.volume << ", MOI/density ("
+                  << p.MOI.x << ", " << p.MOI.y << ", " << p.MOI.z << ")" << std::endl;
+        if (coverage >= 0.f) {
+            std::cout << "Covers " << coverage * 100. << "% of the target shape (voxel volume " << GetShapeVolume()
+                      << ")" << std::endl;
+        }
+    }
+
+  private:
+    unsigned int resolution;
+    unsigned int integration_resolution = 400;
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::function<bool(const float3&)> shape;
+    float3 shape_lo, shape_hi;
+
+    // Voxel grid over the shape's box with one layer of padding, so the shape never touches the grid border
+    float3 origin;
+    float voxel;
+    int n[3];
+    std::vector<uint8_t> inside;
+    // Squared distance (in voxels) to the nearest outside voxel center
+    std::vector<double> dist2;
+    size_t num_inside = 0;
+
+    ClumpSpheres spheres;
+    float coverage = -1.f;
+    ClumpMassProperties props;
+    bool props_valid = false;
+
+    size_t Index(int i, int j, int k) const { return ((size_t)k * n[1] + j) * n[0] + i; }
+    void Coords(size_t v, int& i, int& j, int& k) const {
+        i = v % n[0];
+        j = (v / n[0]) % n[1];
+        k = v / ((size_t)n[0] * n[1]);
+    }
+    float3 VoxelCenter(size_t v) const {
+        int i, j, k;
+        Coords(v, i, j, k);
+        return origin + make_float3(i + 0.5f, j + 0.5f, k + 0.5f) * voxel;
+    }
+    // Largest sphere at this voxel's center that stays clear of all outside voxel centers
+    float InscribedRadius(size_t v) const { return (float)((std::sqrt(dist2[v]) - 0.5) * voxel); }
+
+    // Grow r (by up to one voxel) as long as points spread over the sphere stay inside the shape
+    float RefineRadius(const float3& center, float r) const {
+        const int num_points = 400;
+        auto fits = [&](float radius) {
+            for (int i = 0; i < num_points; i++) {
+                // Fibonacci sphere
+                float z = 1.f - (2.f * i + 1.f) / num_points;
+                float rho = std::sqrt(std::max(0.f, 1.f - z * z));
+                float phi = 2.39996323f * i;
+                if (!shape(center + make_float3(rho * std::cos(phi), rho * std::sin(phi), z) * radius)) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        float lo = r, hi = r + voxel;
+        for (int it = 0; it < 12; it++) {
+            float mid = 0.5f * (lo + hi);
+            (fits(mid) ? lo : hi) = mid;
+        }
+        return lo;
+    }
+
+    void Voxelize() {
+        using namespace clump_builder_detail;
+        float3 size = shape_hi - shape_lo;
+        voxel = std::max({size.x, size.y, size.z}) / resolution;
+        // An odd number of voxels centered on the box, so symmetric shapes get a voxel center on their center
+        n[0] = 2 * (int)std::ceil(0.5f * size.x / voxel) + 3;
+        n[1] = 2 * (int)std::ceil(0.5f * size.y / voxel) + 3;
+        n[2] = 2 * (int)std::ceil(0.5f * size.z / voxel) + 3;
+        origin = (shape_lo + shape_hi) * 0.5f - make_float3(n[0], n[1], n[2]) * (0.5f * voxel);
+        size_t total = (size_t)n[0] * n[1] * n[2];
+        inside.assign(total, 0);
+        ParallelFor(total, num_threads, [&](size_t v) {
+            int i, j, k;
+            Coords(v, i, j, k);
+            bool border = i == 0 || j == 0 || k == 0 || i == n[0] - 1 || j == n[1] - 1 || k == n[2] - 1;
+            inside[v] = !border && shape(VoxelCenter(v));
+        });
+        num_inside = std::count(inside.begin(), inside.end(), 1);
+        if (num_inside == 0) {
+            throw std::runtime_error("ClumpBuilder: the target shape contains no voxel; increase the resolution");
+        }
+
+        // Separable squared Euclidean distance transform, one axis at a time, lines in parallel
+        const double inf = std::numeric_limits<double>::infinity();
+        dist2.resize(total);
+        for (size_t v = 0; v < total; v++) {
+            dist2[v] = inside[v] ? inf : 0.;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+            ParallelFor((size_t)n[a1] * n[a2], num_threads, [&](size_t line) {
+                std::vector<double> f(n[axis]), d, z;
+                std::vector<int> idx;
+                int c[3];
+                c[a1] = line % n[a1];
+                c[a2] = line / n[a1];
+                for (int t = 0; t < n[axis]; t++) {
+                    c[axis] = t;
+                    f[t] = dist2[Index(c[0], c[1], c[2])];
+                }
+                DistanceTransform1D(f, d, idx, z);
+                for (int t = 0; t < n[axis]; t++) {
+                    c[axis] = t;
+                    dist2[Index(c[0], c[1], c[2])] = f[t];
+                }
+            });
+        }
+    }
+
+    // The inscribed sphere at v is not contained in that of any of its 26 neighbors
+    bool IsMaximal(size_t v) const {
+        int i, j, k;
+        Coords(v, i, j, k);
+        double r = std::sqrt(dist2[v]);
+        for (int dk = -1; dk <= 1; dk++) {
+            for (int dj = -1; dj <= 1; dj++) {
+                for (int di = -1; di <= 1; di++) {
+                    double d = std::sqrt((double)(di * di + dj * dj + dk * dk));
+                    if (d > 0. && std::sqrt(dist2[Index(i + di, j + dj, k + dk)]) >= r + d) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Visit the inside voxels within r (in voxels) of v
+    template <typename F>
+    void ForEachInSphere(size_t v, double r, F&& func) const {
+        int i, j, k;
+        Coords(v, i, j, k);
+        int reach = (int)std::ceil(r);
+        for (int dk = -reach; dk <= reach; dk++) {
+            for (int dj = -reach; dj <= reach; dj++) {
+                for (int di = -reach; di <= reach; di++) {
+                    if (di * di + dj * dj + dk * dk > r * r) {
+                        continue;
+                    }
+                    int a = i + di, b = j + dj, c = k + dk;
+                    if (a < 0 || b < 0 || c < 0 || a >= n[0] || b >= n[1] || c >= n[2]) {
+                        continue;
+                    }
+                    size_t w = Index(a, b, c);
+                    if (inside[w]) {
+                        func(w);
+                    }
+                }
+            }
+        }
+    }
+
+    size_t Gain(size_t v, const std::vector<uint8_t>& covered) const {
+        size_t g = 0;
+        ForEachInSphere(v, std::sqrt(dist2[v]) - 0.5, [&](size_t w) { g += !covered[w]; });
+        return g;
+    }
+
+    size_t Cover(size_t v, double r, std::vector<uint8_t>& covered) const {
+        size_t g = 0;
+        ForEachInSphere(v, r, [&](size_t w) {
+            g += !covered[w];
+            covered[w] = 1;
+        });
+        return g;
+    }
+};
+
+#endif
@@ -0,0 +1,141 @@
+// =============================================================================
+// Counter-based random numbers (Philox4x32-10, Salmon et al. 2011).
+//
+// A random value is a pure function of (global seed, case id, entity id,
+// purpose, draw index), so there is no generator state to share between
+// threads or to carry from one sweep case to the next. Any sampler can draw
+// the numbers of particle i from any thread and get the same values, and a
+// single case of a parametric sweep can be replayed alone by passing its case
+// id. Distributions are implemented here rather than taken from <random>,
+// whose algorithms differ between standard libraries.
+//
+// The global seed can be overridden with the DEME_DRIVERS_SEED environment
+// variable, see GetGlobalSeed.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_COUNTER_RNG_HPP
+#define DEME_DRIVERS_COUNTER_RNG_HPP
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// Global seed from the DEME_DRIVERS_SEED environment variable, or default_seed if it is not set
+inline uint64_t GetGlobalSeed(uint64_t default_seed = 4150) {
+    const char* env = std::getenv("DEME_DRIVERS_SEED");
+    return env ? std::strtoull(env, nullptr, 10) : default_seed;
+}
+
+// One Philox4x32 block with 10 rounds
+inline void Philox4x32(const uint32_t ctr_in[4], const uint32_t key_in[2], uint32_t out[4]) {
+    const uint32_t M0 = 0xD2511F53u, M1 = 0xCD9E8D57u;
+    const uint32_t W0 = 0x9E3779B9u, W1 = 0xBB67AE85u;
+    uint32_t c0 = ctr_in[0], c1 = ctr_in[1], c2 = ctr_in[2], c3 = ctr_in[3];
+    uint32_t k0 = key_in[0], k1 = key_in[1];
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)M0 * c0;
+        uint64_t p1 = (uint64_t)M1 * c2;
+        uint32_t hi0 = p0 >> 32, lo0 = (uint32_t)p0;
+        uint32_t hi1 = p1 >> 32, lo1 = (uint32_t)p1;
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += W0;
+        k1 += W1;
+    }
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+// The numbers of one entity (particle, cell, site...) for one purpose. Satisfies UniformRandomBitGenerator.
+class RandomStream {
+  public:
+    using result_type = uint32_t;
+
+    RandomStream(const uint32_t key[2], uint64_t entity, uint32_t purpose) {
+        this->key[0] = key[0];
+        this->key[1] = key[1];
+        ctr[0] = (uint32_t)entity;
+        ctr[1] = (uint32_t)(entity >> 32);
+        ctr[2] = purpose;
+        ctr[3] = 0;
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint32_t>::max(); }
+
+    result_type operator()() {
+        if (used == 4) {
+            Philox4x32(ctr, key, block);
+            ctr[3]++;
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    // Uniform in [0, 1)
+    float Uniform() { return ((*this)() >> 8) * (1.f / 16777216.f); }
+    double UniformDouble() {
+        uint64_t hi = (*this)() >> 5, lo = (*this)() >> 6;
+        return (hi * 67108864. + lo) * (1. / 9007199254740992.);
+    }
+    float Uniform(float a, float b) { return a + (b - a) * Uniform(); }
+
+    // Uniform integer in [0, n)
+    uint32_t UniformInt(uint32_t n) { return (uint32_t)(((uint64_t)(*this)() * n) >> 32); }
+
+    // Standard normal (Box-Muller)
+    double Normal() {
+        double u1 = 1. - UniformDouble();
+        double u2 = UniformDouble();
+        return std::sqrt(-2. * std::log(u1)) * std::cos(2. * 3.14159265358979323846 * u2);
+    }
+    double Normal(double mean, double stddev) { return mean + stddev * Normal(); }
+
+    // Index drawn with probability proportional to weights
+    unsigned int Discrete(const std::vector<float>& weights) {
+        double total = 0.;
+        for (float w : weights) {
+            total += w;
+        }
+        double u = UniformDouble() * total;
+        for (unsigned int i = 0; i < weights.size(); i++) {
+            u -= weights[i];
+            if (u < 0.) {
+                return i;
+            }
+        }
+        return weights.size() - 1;
+    }
+
+  private:
+    uint32_t key[2];
+    uint32_t ctr[4];
+    uint32_t block[4];
+    unsigned int used = 4;
+};
+
+class CounterRNG {
+  public:
+    // case_id tells the cases of a sweep apart; the same (seed, case_id) always gives the same numbers
+    CounterRNG(uint64_t seed, uint64_t case_id = 0) {
+        // Mix both into the 64-bit Philox key
+        uint64_t k = seed * 0x9E3779B97F4A7C15ull ^ (case_id + 0x632BE59BD9B4E019ull) * 0xC2B2AE3D27D4EB4Full;
+        k ^= k >> 31;
+        key[0] = (uint32_t)k;
+        key[1] = (uint32_t)(k >> 32);
+    }
+
+    // Independent stream for an entity; purpose separates different uses for the same entity (radius, position...)
+    RandomStream Stream(uint64_t entity, uint32_t purpose = 0) const { return RandomStream(key, entity, purpose); }
+
+  private:
+    uint32_t key[2];
+};
+
+#endif
@@ -0,0 +1,195 @@
+// =============================================================================
+// Contact force and torque sensors on tracked owners, with no mass involved.
+//
+// ContactAcc() * mass only recovers the contact force if the mass given to the
+// owner is the one the solver integrates with. For a fixed wall, that mass is
+// made up just for this purpose. ContactAngAccLocal() * I is per axis and in
+// the local frame, so it is only right about principal axes. A ForceSensor
+// sums the per-contact forces and torques of each owner instead
+// (GetContactForcesAndGlobalTorque). The result is the net contact force and
+// torque in the global frame, whatever the owner's mass, and also works for
+// analytic walls and BC planes.
+//
+// The load on an owner made of several analytic planes (the walls of a box) can
+// be split by plane: each contact goes to the plane its point is closest to.
+// Sample reads all sensors in one pass and appends a row to a time series. It
+// reuses the same buffers every call. WriteCsv writes the series with a "time"
+// column first, the layout TimeSeriesTable reads.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_FORCE_SENSOR_HPP
+#define DEME_DRIVERS_FORCE_SENSOR_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "MeshNodeBuffer.hpp"
+
+using namespace deme;
+
+// Net contact load on an owner (or one of its planes), global frame; torque about the owner's CoM
+struct ContactLoad {
+    float3 force = make_float3(0);
+    float3 torque = make_float3(0);
+    size_t num_contacts = 0;
+};
+
+class ForceSensor {
+  public:
+    ForceSensor() {}
+
+    // Add a tracked owner under a name (used in the CSV header); returns its index. Sensors and planes are all added
+    // before the first logged Sample.
+    size_t Add(const std::string& name, std::shared_ptr<DEMTracker> tracker) {
+        CheckNotLogging();
+        sensors.push_back(Sensor{name, tracker, {}, {}, {}});
+        return sensors.size() - 1;
+    }
+
+    // Split the load on sensor i by plane. Point and normal are in the owner's frame, as given to AddPlane on an
+    // external object; a BC plane sits at its own origin. Returns the plane's index within the sensor.
+    size_t AddPlane(size_t i, const std::string& name, const float3& point, const float3& normal) {
+        CheckNotLogging();
+        Sensor& s = sensors.at(i);
+        s.planes.push_back(Plane{name, point, normalize(normal)});
+        s.plane_loads.resize(s.planes.size());
+        return s.planes.size() - 1;
+    }
+
+    // Read every sensor once and, if log is set, append a row at time t to the series
+    void Sample(double t, bool log = true) {
+        for (Sensor& s : sensors) {
+            size_t n = s.tracker->GetContactForcesAndGlobalTorque(points, forces, torques);
+            s.load = ContactLoad();
+            for (size_t k = 0; k < n; k++) {
+                s.load.force = s.load.force + forces[k];
+                s.load.torque = s.load.torque + torques[k];
+            }
+            s.load.num_contacts = n;
+            if (!s.planes.empty()) {
+                SplitByPlane(s, n);
+            }
+        }
+        if (!log) {
+            return;
+        }
+        times.push_back(t);
+        for (const Sensor& s : sensors) {
+            AppendRow(s.load);
+            for (const ContactLoad& p : s.plane_loads) {
+                AppendRow(p);
+            }
+        }
+    }
+
+    // The loads from the last Sample
+    const ContactLoad& Get(size_t i) const { return sensors.at(i).load; }
+    const ContactLoad& Get(const std::string& name) const { return sensors[Find(name)].load; }
+    const ContactLoad& GetPlane(size_t i, size_t plane) const { return sensors.at(i).plane_loads.at(plane); }
+
+    size_t GetNumSamples() const { return times.size(); }
+    void ClearSeries() {
+        times.clear();
+        series.clear();
+    }
+
+    // One row per Sample: time, then fx, fy, fz, tx, ty, tz of each sensor and of each of its planes
+    void WriteCsv(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open force sensor output " + filename);
+        }
+        file << "time";
+        auto header = [&](const std::string& prefix) {
+            for (const char* c : {"fx", "fy", "fz", "tx", "ty", "tz"}) {
+                file << "," << prefix << "_" << c;
+            }
+        };
+        for (const Sensor& s : sensors) {
+            header(s.name);
+            for (const Plane& p : s.planes) {
+                header(s.name + "_" + p.name);
+            }
+        }
+        file << "\n";
+        size_t row_size = times.empty() ? 0 : series.size() / times.size();
+        for (size_t r = 0; r < times.size(); r++) {
+            file << times[r];
+            for (size_t c = 0; c < row_size; c++) {
+                file << "," << series[r * row_size + c];
+            }
+            file << "\n";
+        }
+    }
+
+  private:
+    struct Plane {
+        std::string name;
+        float3 point, normal;
+    };
+    struct Sensor {
+        std::string name;
+        std::shared_ptr<DEMTracker> tracker;
+        std::vector<Plane> planes;
+        ContactLoad load;
+        std::vector<ContactLoad> plane_loads;
+    };
+
+    std::vector<Sensor> sensors;
+    // Reused by every Sample
+    std::vector<float3> points, forces, torques, local_points;
+    std::vector<double> times;
+    // Row-major, six values per sensor and per plane
+    std::vector<float> series;
+
+    size_t Find(const std::string& name) const {
+        for (size_t i = 0; i < sensors.size(); i++) {
+            if (sensors[i].name == name) {
+                return i;
+            }
+        }
+        throw std::runtime_error("No force sensor named " + name);
+    }
+
+    void CheckNotLogging() const {
+        if (!times.empty()) {
+            throw std::runtime_error("Force sensors cannot be added once the series has rows");
+        }
+    }
+
+    void SplitByPlane(Sensor& s, size_t n) {
+        std::fill(s.plane_loads.begin(), s.plane_loads.end(), ContactLoad());
+        local_points.resize(n);
+        FrameToLocal(points.data(), local_points.data(), n, s.tracker->Pos(), s.tracker->OriQ());
+        for (size_t k = 0; k < n; k++) {
+            size_t best = 0;
+            float best_dist = std::numeric_limits<float>::max();
+            for (size_t p = 0; p < s.planes.size(); p++) {
+                float d = std::abs(dot(local_points[k] - s.planes[p].point, s.planes[p].normal));
+                if (d < best_dist) {
+                    best_dist = d;
+                    best = p;
+                }
+            }
+            ContactLoad& l = s.plane_loads[best];
+            l.force = l.force + forces[k];
+            l.torque = l.torque + torques[k];
+            l.num_contacts++;
+        }
+    }
+
+    void AppendRow(const ContactLoad& l) {
+        series.insert(series.end(), {l.force.x, l.force.y, l.force.z, l.torque.x, l.torque.y, l.torque.z});
+    }
+};
+
+#endif
@@ -0,0 +1,404 @@
+// =============================================================================
+// Particle beds from measured grain-size distribution (sieve) curves.
+//
+// A GrainSizeCurve holds the cumulative mass fraction passing each sieve and
+// interpolates it log-linearly in diameter, as sieve curves are drawn. It is
+// cut into classes of equal mass (RadiusQuantizer, on fine slices of the
+// curve); the radius of a class is chosen so that both its mass and its
+// particle count match the curve over its band, i.e.
+// r^3 = (band mass) / (integral of dm / r^3 over the band). The fewest classes
+// that reproduce the curve within a given error (largest difference in mass
+// passing, over sieves and class sizes) become the sphere templates.
+//
+// GradedBed then fills a box or vertical cylinder with (1 - porosity) of its
+// volume in solids: loose targets are sampled through the whole container with
+// PolydisperseSampler, denser ones are drop-and-roll packed from the floor with
+// DensePacker. Everything is deterministic for a (seed, case id) pair and takes
+// seconds, so a bed can be rebuilt for every case of a sweep over the curve.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_GRADED_BED_HPP
+#define DEME_DRIVERS_GRADED_BED_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DensePacker.hpp"
+#include "PolydisperseSampler.hpp"
+#include "RadiusClasses.hpp"
+
+using namespace deme;
+
+class GrainSizeCurve {
+  public:
+    // Sieve diameters and the mass fraction passing each (in [0, 1] or in percent). The curve is taken between its
+    // first and last points: whatever passes the finest sieve is lumped into it.
+    GrainSizeCurve(std::vector<float> diameters, std::vector<float> passing) {
+        if (diameters.size() < 2 || diameters.size() != passing.size()) {
+            throw std::runtime_error("GrainSizeCurve needs at least two (diameter, passing) points");
+        }
+        std::vector<size_t> order(diameters.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return diameters[a] < diameters[b]; });
+        for (size_t i : order) {
+            d.push_back(diameters[i]);
+            p.push_back(passing[i]);
+        }
+        if (d.front() <= 0.f) {
+            throw std::runtime_error("GrainSizeCurve diameters must be positive");
+        }
+        float p0 = p.front(), p1 = p.back();
+        if (!(p1 > p0)) {
+            throw std::runtime_error("GrainSizeCurve passing fractions must increase with diameter");
+        }
+        for (size_t i = 0; i < p.size(); i++) {
+            // Monotone, normalized to [0, 1]
+            p[i] = std::max(i > 0 ? p[i - 1] : 0.f, (p[i] - p0) / (p1 - p0));
+        }
+        p.back() = 1.f;
+    }
+
+    // Two numeric columns (diameter, passing); a header line and further columns are ignored. diameter_scale
+    // converts the file's unit (e.g. 1e-3 for mm).
+    static GrainSizeCurve FromCsv(const std::string& filename, float diameter_scale = 1.f) {
+        std::ifstream file(filename);
+        if (!file) {
+            throw std::runtime_error("Cannot open grain-size curve " + filename);
+        }
+        std::vector<float> diameters, passing;
+        std::string line, cell;
+        while (std::getline(file, line)) {
+            std::stringstream row(line);
+            std::vector<float> values;
+            while (std::getline(row, cell, ',') && values.size() < 2) {
+                try {
+                    values.push_back(std::stof(cell));
+                } catch (const std::exception&) {
+                    break;
+                }
+            }
+            if (values.size() == 2) {
+                diameters.push_back(values[0] * diameter_scale);
+                passing.push_back(values[1]);
+            }
+        }
+        return GrainSizeCurve(diameters, passing);
+    }
+
+    // Mass-passing curve of a radius sample (each entry one particle)
+    static GrainSizeCurve FromRadii(std::vector<float> radii, unsigned int num_points = 50) {
+        if (radii.size() < 2) {
+            throw std::runtime_error("GrainSizeCurve::FromRadii needs at least two radii");
+        }
+        std::sort(radii.begin(), radii.end());
+        std::vector<double> cum(radii.size());
+        double total = 0.;
+        for (size_t i = 0; i < radii.size(); i++) {
+            total += (double)radii[i] * radii[i] * radii[i];
+            cum[i] = total;
+        }
+        std::vector<float> diameters, passing;
+        for (unsigned int k = 0; k <= num_points; k++) {
+            size_t i = std::min(radii.size() - 1, (size_t)((double)k / num_points * (radii.size() - 1)));
+            if (diameters.empty() || 2.f * radii[i] > diameters.back()) {
+                diameters.push_back(2.f * radii[i]);
+                passing.push_back(cum[i] / total);
+            }
+        }
+        passing.front() = 0.f;
+        return GrainSizeCurve(diameters, passing);
+    }
+
+    float GetMinDiameter() const { return d.front(); }
+    float GetMaxDiameter() const { return d.back(); }
+    const std::vector<float>& GetDiameters() const { return d; }
+
+    // Mass fraction finer than diameter
+    float PassingAt(float diameter) const {
+        if (diameter <= d.front()) {
+            return 0.f;
+        }
+        if (diameter >= d.back()) {
+            return 1.f;
+        }
+        size_t i = std::upper_bound(d.begin(), d.end(), diameter) - d.begin() - 1;
+        float t = std::log(diameter / d[i]) / std::log(d[i + 1] / d[i]);
+        return p[i] + t * (p[i + 1] - p[i]);
+    }
+
+    // Diameter with the given mass fraction finer than it, e.g. DiameterAt(0.5) is D50
+    float DiameterAt(float fraction) const {
+        fraction = std::min(1.f, std::max(0.f, fraction));
+        size_t i = std::lower_bound(p.begin(), p.end(), fraction) - p.begin();
+        if (i == 0) {
+            return d.front();
+        }
+        if (p[i] == p[i - 1]) {
+            return d[i];
+        }
+        float t = (fraction - p[i - 1]) / (p[i] - p[i - 1]);
+        return d[i - 1] * std::pow(d[i] / d[i - 1], t);
+    }
+
+  private:
+    std::vector<float> d;
+    std::vector<float> p;
+};
+
+struct GradedClasses {
+    std::vector<float> radii;
+    std::vector<float> number_weights;
+    std::vector<float> mass_fractions;
+    // Largest difference in mass passing between the classes and the curve
+    float error = 0.f;
+
+    size_t size() const { return radii.size(); }
+};
+
+// Largest difference in mass passing between classes (radii ascending) and the curve, over the sieves and both sides
+// of every class step
+inline float GradationError(const GrainSizeCurve& curve,
+                            const std::vector<float>& radii,
+                            const std::vector<float>& mass_fractions) {
+    auto passing = [&](float diameter, bool inclusive) {
+        double m = 0.;
+        for (size_t k = 0; k < radii.size(); k++) {
+            if (2.f * radii[k] < diameter || (inclusive && 2.f * radii[k] == diameter)) {
+                m += mass_fractions[k];
+            }
+        }
+        return (float)m;
+    };
+    float err = 0.f;
+    for (float dia : curve.GetDiameters()) {
+        err = std::max(err, std::abs(curve.PassingAt(dia) - passing(dia, true)));
+    }
+    for (float r : radii) {
+        float f = curve.PassingAt(2.f * r);
+        err = std::max({err, std::abs(f - passing(2.f * r, false)), std::abs(f - passing(2.f * r, true))});
+    }
+    return err;
+}
+
+// Cut the curve into num_classes equal-mass bands. The curve is sliced into equal-mass slices, each standing at its
+// mass midpoint, and the slices are cut by RadiusQuantizer. Bands that come out within merge_tol (relative) of the
+// previous class radius, as on a steep or single-size curve, are merged into it.
+inline GradedClasses QuantizeCurve(const GrainSizeCurve& curve, unsigned int num_classes, float merge_tol = 0.01f) {
+    const size_t slices = (size_t)std::max(1u, num_classes) * 64;
+    std::vector<float> slice_radii(slices);
+    std::vector<double> slice_masses(slices, 1. / slices);
+    for (size_t i = 0; i < slices; i++) {
+        slice_radii[i] = 0.5f * curve.DiameterAt((i + 0.5) / slices);
+    }
+    RadiusQuantizer quantizer(num_classes);
+    quantizer.Fit(slice_radii, slice_masses);
+
+    GradedClasses classes;
+    for (unsigned int k = 0; k < quantizer.GetNumClasses(); k++) {
+        float r = quantizer.GetClassRadii()[k];
+        double mass = quantizer.GetClassMasses()[k], count = quantizer.GetClassCounts()[k];
+        if (!classes.radii.empty() && r <= classes.radii.back() * (1.f + merge_tol)) {
+            // Merge: keep mass and count, radius from the combined ratio
+            double m = classes.mass_fractions.back() + mass;
+            double n = classes.number_weights.back() + count;
+            classes.radii.back() = (float)std::cbrt(m / n);
+            classes.mass_fractions.back() = m;
+            classes.number_weights.back() = n;
+        } else {
+            classes.radii.push_back(r);
+            classes.mass_fractions.push_back(mass);
+            classes.number_weights.push_back(count);
+        }
+    }
+    classes.error = GradationError(curve, classes.radii, classes.mass_fractions);
+    return classes;
+}
+
+// Fewest equal-mass classes whose gradation error is within max_error
+inline GradedClasses QuantizeCurveToTolerance(const GrainSizeCurve& curve,
+                                              float max_error,
+                                              unsigned int max_classes = 100) {
+    GradedClasses best;
+    for (unsigned int k = 1; k <= max_classes; k++) {
+        GradedClasses c = QuantizeCurve(curve, k);
+        if (k == 1 || c.error < best.error) {
+            best = c;
+        }
+        if (c.error <= max_error) {
+            return c;
+        }
+    }
+    return best;
+}
+
+class GradedBed {
+  public:
+    // Templates are the fewest classes reproducing the curve within max_error (mass passing)
+    GradedBed(const GrainSizeCurve& curve, float max_error = 0.05f)
+        : curve(curve), classes(QuantizeCurveToTolerance(curve, max_error)) {}
+
+    void SetSeed(uint64_t seed, uint64_t case_id = 0) {
+        this->seed = seed;
+        this->case_id = case_id;
+    }
+    void SetNumThreads(unsigned int n) { num_threads = std::max(1u, n); }
+    // Solid fractions up to this are sampled loose through the whole container, denser ones packed from the floor
+    void SetLooseLimit(float solid_fraction) { loose_limit = solid_fraction; }
+
+    // Box container [lo, hi]; lo.z is the floor
+    void SetBox(float3 lo, float3 hi) {
+        cylinder = false;
+        box_lo = lo;
+        box_hi = hi;
+        container_volume = (double)(hi.x - lo.x) * (hi.y - lo.y) * (hi.z - lo.z);
+    }
+
+    // Vertical cylinder standing on base_center
+    void SetCylinderZ(float3 base_center, float radius, float height) {
+        cylinder = true;
+        cyl_center = base_center;
+        cyl_radius = radius;
+        box_lo = base_center - make_float3(radius, radius, 0);
+        box_hi = base_center + make_float3(radius, radius, height);
+        container_volume = PI * radius * radius * height;
+    }
+
+    // Place (1 - porosity) of the container volume in solids. Returns positions; GetClassIds() gives the class of each.
+    std::vector<float3> Build(float porosity) {
+        if (container_volume <= 0.) {
+            throw std::runtime_error("GradedBed needs a container, call SetBox or SetCylinderZ first");
+        }
+        float solid_fraction = 1.f - porosity;
+        std::vector<float3> xyz;
+        if (solid_fraction <= loose_limit) {
+            PolydisperseSampler sampler(classes.radii, classes.number_weights);
+            sampler.SetSeed(seed, case_id);
+            sampler.SetNumThreads(num_threads);
+            if (cylinder) {
+                float3 c = cyl_center;
+                float R = cyl_radius;
+                sampler.SetRegion([=](const float3& p, float r) {
+                    float dx = p.x - c.x, dy = p.y - c.y;
+                    return dx * dx + dy * dy <= (R - r) * (R - r);
+                });
+            }
+            float3 halfsize = (box_hi - box_lo) * 0.5f;
+            double box_volume = 8. * halfsize.x * halfsize.y * halfsize.z;
+            xyz = sampler.SampleBox((box_lo + box_hi) * 0.5f, halfsize, solid_fraction * container_volume / box_volume);
+            ids = sampler.GetClassIds();
+            bed_height = box_hi.z - box_lo.z;
+        } else {
+            DensePacker packer(classes.radii, classes.number_weights);
+            packer.SetSeed(seed, case_id);
+            packer.SetNumThreads(num_threads);
+            if (cylinder) {
+                packer.SetCylinderZ(cyl_center, cyl_radius, box_hi.z - box_lo.z);
+            } else {
+                packer.SetBox(box_lo, box_hi);
+            }
+            // Expected number of spheres holding the target solid volume
+            double mean_volume = 0., total_weight = 0.;
+            for (size_t k = 0; k < classes.size(); k++) {
+                mean_volume += classes.number_weights[k] * 4. / 3. * PI * std::pow(classes.radii[k], 3);
+                total_weight += classes.number_weights[k];
+            }
+            mean_volume /= total_weight;
+            xyz = packer.Pack((size_t)std::ceil(solid_fraction * container_volume / mean_volume));
+            ids = packer.GetClassIds();
+            bed_height = packer.GetBedTop() - box_lo.z;
+        }
+
+        placed_mass.assign(classes.size(), 0.);
+        placed_volume = 0.;
+        for (unsigned int id : ids) {
+            double v = 4. / 3. * PI * std::pow(classes.radii[id], 3);
+            placed_mass[id] += v;
+            placed_volume += v;
+        }
+        if (placed_volume < 0.99 * solid_fraction * container_volume) {
+            std::cout << "GradedBed: the container only took a solid fraction of " << placed_volume / container_volume
+                      << " (asked for " << solid_fraction << ")" << std::endl;
+        }
+        return xyz;
+    }
+
+    const std::vector<unsigned int>& GetClassIds() const { return ids; }
+    const GradedClasses& GetClasses() const { return classes; }
+    const std::vector<float>& GetClassRadii() const { return classes.radii; }
+    // Solid fraction of the container as built
+    double GetSolidFraction() const { return placed_volume / container_volume; }
+    // Height of the built bed above the container floor
+    float GetBedHeight() const { return bed_height; }
+
+    // Gradation error of the particles actually placed
+    float GetPlacedError() const {
+        std::vector<float> fractions(classes.size());
+        for (size_t k = 0; k < classes.size(); k++) {
+            fractions[k] = (placed_volume > 0.) ? placed_mass[k] / placed_volume : 0.f;
+        }
+        return GradationError(curve, classes.radii, fractions);
+    }
+
+    // One sphere template per class
+    std::vector<std::shared_ptr<DEMClumpTemplate>> LoadTemplates(DEMSolver& sim,
+                                                                 float density,
+                                                                 std::shared_ptr<DEMMaterial> mat) const {
+        std::vector<std::shared_ptr<DEMClumpTemplate>> templates;
+        for (float r : classes.radii) {
+            templates.push_back(sim.LoadSphereType(density * 4. / 3. * PI * r * r * r, r, mat));
+        }
+        return templates;
+    }
+
+    // The template of every built particle
+    std::vector<std::shared_ptr<DEMClumpTemplate>> TemplatesOf(
+        const std::vector<std::shared_ptr<DEMClumpTemplate>>& templates) const {
+        std::vector<std::shared_ptr<DEMClumpTemplate>> per_particle(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) {
+            per_particle[i] = templates.at(ids[i]);
+        }
+        return per_particle;
+    }
+
+    void ShowStats() const {
+        std::cout << "Graded bed: " << ids.size() << " particles in " << classes.size() << " size classes (D10 "
+                  << curve.DiameterAt(0.1f) << ", D50 " << curve.DiameterAt(0.5f) << ", D90 " << curve.DiameterAt(0.9f)
+                  << ")" << std::endl;
+        std::cout << "Solid fraction " << GetSolidFraction() << ", bed height " << bed_height
+                  << ", gradation error of the classes " << classes.error << ", of the placed particles "
+                  << GetPlacedError() << std::endl;
+    }
+
+  private:
+    GrainSizeCurve curve;
+    GradedClasses classes;
+    uint64_t seed = 0;
+    uint64_t case_id = 0;
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    float loose_limit = 0.35f;
+
+    bool cylinder = false;
+    float3 box_lo, box_hi;
+    float3 cyl_center;
+    float cyl_radius = 0.f;
+    double container_volume = 0.;
+
+    std::vector<unsigned int> ids;
+    std::vector<double> placed_mass;
+    double placed_volume = 0.;
+    float bed_height = 0.f;
+};
+
+#endif
@@ -0,0 +1,268 @@
+// =============================================================================
+// Regular lattices for initial particle positions.
+//
+// A lattice type describes its sites in units of the nearest-neighbor distance:
+// Triangular2D and Square2D (in the x-z plane, y = 0, as our 2D drivers use),
+// SimpleCubic, HCP, FCC and BCC. LatticeGenerator<Type> scales it by a spacing,
+// shifts it to an origin, keeps the sites inside a box and any clip predicate
+// (half-spaces, cylinders, or a mesh test), and optionally jitters them.
+//
+// Sites are written straight into a caller-provided buffer. Layers are split
+// among threads: a first pass counts the sites each thread keeps, a second
+// writes them at their prefix-sum offsets, so the order is the same for any
+// number of threads. Jitter is drawn from a counter-based stream keyed by the
+// site index, also independent of the thread count.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_LATTICE_HPP
+#define DEME_DRIVERS_LATTICE_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "CounterRNG.hpp"
+
+using namespace deme;
+
+// Each lattice type provides: dim, num_basis, Step() (extent of one index increment along x, y, z) and
+// Site(i, j, k, b) (position of basis site b of cell (i, j, k)), in units of the nearest-neighbor distance.
+
+struct Triangular2D {
+    static constexpr int dim = 2;
+    static constexpr int num_basis = 1;
+    static float3 Step() { return make_float3(1.f, 0.f, 0.8660254f); }
+    static float3 Site(int i, int /*j*/, int k, int /*b*/) {
+        return make_float3(i + 0.5f * (k & 1), 0.f, 0.8660254f * k);
+    }
+};
+
+struct Square2D {
+    static constexpr int dim = 2;
+    static constexpr int num_basis = 1;
+    static float3 Step() { return make_float3(1.f, 0.f, 1.f); }
+    static float3 Site(int i, int /*j*/, int k, int /*b*/) { return make_float3(i, 0.f, k); }
+};
+
+struct SimpleCubic {
+    static constexpr int dim = 3;
+    static constexpr int num_basis = 1;
+    static float3 Step() { return make_float3(1.f, 1.f, 1.f); }
+    static float3 Site(int i, int j, int k, int /*b*/) { return make_float3(i, j, k); }
+};
+
+// Same stacking as DEME's HCPSampler
+struct HCP {
+    static constexpr int dim = 3;
+    static constexpr int num_basis = 1;
+    static float3 Step() { return make_float3(1.f, 0.8660254f, 0.8164966f); }
+    static float3 Site(int i, int j, int k, int /*b*/) {
+        return make_float3(i + 0.5f * ((j + k) & 1), 0.8660254f * (j + (k & 1) / 3.f), 0.8164966f * k);
+    }
+};
+
+struct FCC {
+    static constexpr int dim = 3;
+    static constexpr int num_basis = 4;
+    // Cubic cell edge is sqrt(2) times the nearest-neighbor distance
+    static float3 Step() { return make_float3(1.4142136f, 1.4142136f, 1.4142136f); }
+    static float3 Site(int i, int j, int k, int b) {
+        const float a = 1.4142136f;
+        float3 p = make_float3(i, j, k) * a;
+        switch (b) {
+            case 1:
+                return p + make_float3(0.5f * a, 0.5f * a, 0.f);
+            case 2:
+                return p + make_float3(0.5f * a, 0.f, 0.5f * a);
+            case 3:
+                return p + make_float3(0.f, 0.5f * a, 0.5f * a);
+            default:
+                return p;
+        }
+    }
+};
+
+struct BCC {
+    static constexpr int dim = 3;
+    static constexpr int num_basis = 2;
+    // Cubic cell edge is 2/sqrt(3) times the nearest-neighbor distance
+    static float3 Step() { return make_float3(1.1547005f, 1.1547005f, 1.1547005f); }
+    static float3 Site(int i, int j, int k, int b) {
+        const float a = 1.1547005f;
+        return make_float3(i + 0.5f * b, j + 0.5f * b, k + 0.5f * b) * a;
+    }
+};
+
+// Clip predicates; combine them with ClipAnd
+inline auto ClipHalfSpace(float3 point, float3 normal, float margin = 0.f) {
+    normal = normalize(normal);
+    return [=](const float3& p) { return dot(p - point, normal) >= margin; };
+}
+
+inline auto ClipCylinderZ(float3 center, float radius) {
+    return [=](const float3& p) {
+        float dx = p.x - center.x, dy = p.y - center.y;
+        return dx * dx + dy * dy <= radius * radius;
+    };
+}
+
+inline auto ClipNone() {
+    return [](const float3&) { return true; };
+}
+
+template <typename A, typename B>
+auto ClipAnd(A a, B b) {
+    return [=](const float3& p) { return a(p) && b(p); };
+}
+
+template <typename LatticeT>
+class LatticeGenerator {
+  public:
+    LatticeGenerator(float spacing, float3 origin = make_float3(0)) : spacing(spacing), origin(origin) {}
+
+    void SetNumThreads(unsigned int n) { num_threads = std::max(1u, n); }
+    // Uniform random displacement of up to amplitude along each axis (in y too only for 3D lattices)
+    void SetJitter(float amplitude, uint64_t seed = 0) {
+        jitter = amplitude;
+        jitter_seed = seed;
+    }
+
+    // Number of sites in [lo, hi] that pass keep
+    template <typename Pred>
+    size_t Count(float3 lo, float3 hi, Pred keep) const {
+        std::vector<size_t> counts = CountPerThread(lo, hi, keep);
+        size_t n = 0;
+        for (size_t c : counts) {
+            n += c;
+        }
+        return n;
+    }
+
+    size_t Count(float3 lo, float3 hi) const { return Count(lo, hi, ClipNone()); }
+
+    // Write the sites in [lo, hi] that pass keep into out, which holds capacity entries. Returns the number written;
+    // throws (before writing anything) if they do not fit.
+    template <typename Pred>
+    size_t Fill(float3 lo, float3 hi, float3* out, size_t capacity, Pred keep) const {
+        std::vector<size_t> offsets = CountPerThread(lo, hi, keep);
+        size_t n = 0;
+        for (size_t& c : offsets) {
+            size_t count = c;
+            c = n;
+            n += count;
+        }
+        if (n > capacity) {
+            throw std::runtime_error("Lattice has " + std::to_string(n) + " sites, buffer only holds " +
+                                     std::to_string(capacity));
+        }
+        RunSlices(lo, hi, [&](unsigned int t, int k0, int k1, const Range& r) {
+            float3* dst = out + offsets[t];
+            Visit(lo, hi, k0, k1, r, keep, [&](const float3& p) { *dst++ = p; });
+        });
+        return n;
+    }
+
+    size_t Fill(float3 lo, float3 hi, float3* out, size_t capacity) const {
+        return Fill(lo, hi, out, capacity, ClipNone());
+    }
+
+    template <typename Pred>
+    std::vector<float3> Generate(float3 lo, float3 hi, Pred keep) const {
+        std::vector<float3> xyz(Count(lo, hi, keep));
+        Fill(lo, hi, xyz.data(), xyz.size(), keep);
+        return xyz;
+    }
+
+    std::vector<float3> Generate(float3 lo, float3 hi) const { return Generate(lo, hi, ClipNone()); }
+
+  private:
+    struct Range {
+        int i0, i1, j0, j1;
+    };
+
+    float spacing;
+    float3 origin;
+    float jitter = 0.f;
+    uint64_t jitter_seed = 0;
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Index range covering [lo, hi] along one axis, one cell of slack on each side for offset rows and basis sites
+    void IndexRange(float lo, float hi, float o, float step, int& first, int& last) const {
+        if (step <= 0.f) {
+            first = last = 0;
+            return;
+        }
+        first = (int)std::floor((lo - o) / (step * spacing)) - 1;
+        last = (int)std::ceil((hi - o) / (step * spacing)) + 1;
+    }
+
+    float3 Jitter(int i, int j, int k, int b) const {
+        RandomStream rng = CounterRNG(jitter_seed).Stream(((uint64_t)(uint32_t)i << 32) | (uint32_t)j,
+                                                          (uint32_t)k * LatticeT::num_basis + b);
+        float dx = jitter * (2.f * rng.Uniform() - 1.f);
+        float dy = (LatticeT::dim == 3) ? jitter * (2.f * rng.Uniform() - 1.f) : 0.f;
+        float dz = jitter * (2.f * rng.Uniform() - 1.f);
+        return make_float3(dx, dy, dz);
+    }
+
+    template <typename Pred, typename Sink>
+    void Visit(float3 lo, float3 hi, int k0, int k1, const Range& r, const Pred& keep, Sink&& sink) const {
+        for (int k = k0; k < k1; k++) {
+            for (int j = r.j0; j <= r.j1; j++) {
+                for (int i = r.i0; i <= r.i1; i++) {
+                    for (int b = 0; b < LatticeT::num_basis; b++) {
+                        float3 p = origin + LatticeT::Site(i, j, k, b) * spacing;
+                        if (jitter > 0.f) {
+                            p += Jitter(i, j, k, b);
+                        }
+                        bool in_y = (LatticeT::dim == 2) || (p.y >= lo.y && p.y <= hi.y);
+                        if (p.x >= lo.x && p.x <= hi.x && in_y && p.z >= lo.z && p.z <= hi.z && keep(p)) {
+                            sink(p);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Split the layers (k) evenly among threads and run func(thread, k_begin, k_end, range) on each
+    template <typename F>
+    void RunSlices(float3 lo, float3 hi, F&& func) const {
+        float3 step = LatticeT::Step();
+        Range r;
+        int k_first, k_last;
+        IndexRange(lo.x, hi.x, origin.x, step.x, r.i0, r.i1);
+        IndexRange(lo.y, hi.y, origin.y, step.y, r.j0, r.j1);
+        IndexRange(lo.z, hi.z, origin.z, step.z, k_first, k_last);
+        int num_layers = k_last - k_first + 1;
+        unsigned int nt = std::min<unsigned int>(num_threads, std::max(1, num_layers));
+        std::vector<std::thread> threads;
+        for (unsigned int t = 0; t < nt; t++) {
+            int k0 = k_first + (int)((int64_t)num_layers * t / nt);
+            int k1 = k_first + (int)((int64_t)num_layers * (t + 1) / nt);
+            threads.emplace_back([&, t, k0, k1]() { func(t, k0, k1, r); });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    template <typename Pred>
+    std::vector<size_t> CountPerThread(float3 lo, float3 hi, const Pred& keep) const {
+        std::vector<size_t> counts(num_threads, 0);
+        RunSlices(lo, hi, [&](unsigned int t, int k0, int k1, const Range& r) {
+            size_t n = 0;
+            Visit(lo, hi, k0, k1, r, keep, [&](const float3&) { n++; });
+            counts[t] = n;
+        });
+        return counts;
+    }
+};
+
+#endif
@@ -0,0 +1,189 @@
+// =============================================================================
+// Layer-by-layer deposition with frozen lower layers.
+//
+// Adding a layer and re-simulating the whole bed for a fixed settle time makes
+// the cost grow quadratically with the number of layers. Here each new layer
+// is settled only until its particles (and those of the k layers below it)
+// come to rest, and layers further down are moved into a fixed family: they
+// still act as a boundary for the layers above but are no longer integrated,
+// and contacts among them are disabled.
+//
+// Frozen layers are woken again when a watched impactor (the drop cube, say)
+// comes within reach of their top, or all at once with UnfreezeAll.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_LAYER_DEPOSITION_HPP
+#define DEME_DRIVERS_LAYER_DEPOSITION_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace deme;
+
+class LayerDeposition {
+  public:
+    // active_family is the family of dynamic particles; frozen_family must not be used by anything else
+    LayerDeposition(DEMSolver& sim, unsigned int active_family, unsigned int frozen_family)
+        : DEMSim(sim), active_family(active_family), frozen_family(frozen_family) {}
+
+    // Number of most recent layers that stay dynamic (besides the one being deposited)
+    void SetActiveLayers(unsigned int k) { active_layers = k; }
+
+    // A layer counts as settled once the fastest active particle is slower than max_vel; checks happen every
+    // check_interval, and settling gives up after max_time
+    void SetSettleCriterion(float max_vel, double max_time, double check_interval) {
+        settle_vel = max_vel;
+        max_settle_time = max_time;
+        this->check_interval = check_interval;
+    }
+
+    // Must be called before DEMSim.Initialize()
+    void Configure() {
+        DEMSim.SetFamilyFixed(frozen_family);
+        DEMSim.DisableContactBetweenFamilies(frozen_family, frozen_family);
+    }
+
+    // Add a layer (after Initialize) and settle it. per_check runs before every check interval, e.g. to write output.
+    // Returns the simulated settling time.
+    double Deposit(const std::vector<std::shared_ptr<DEMClumpTemplate>>& templates, const std::vector<float3>& xyz,
+                   const std::function<void()>& per_check = nullptr) {
+        auto batch = DEMSim.AddClumps(templates, xyz);
+        batch->SetFamily(active_family);
+        Layer layer;
+        layer.tracker = DEMSim.Track(batch);
+        layer.num = xyz.size();
+        DEMSim.UpdateClumps();
+        layers.push_back(layer);
+        num_total += layer.num;
+
+        // Freeze before settling, so only the new layer and the active_layers below it are integrated
+        FreezeBelowActive();
+        return Settle(per_check);
+    }
+
+    // Settle whatever is active now (e.g. the whole bed after UnfreezeAll), with the same criterion as Deposit.
+    // Returns the simulated settling time.
+    double Settle(const std::function<void()>& per_check = nullptr) {
+        double t = 0.;
+        do {
+            if (per_check) {
+                per_check();
+            }
+            DEMSim.DoDynamicsThenSync(check_interval);
+            t += check_interval;
+            active_owner_time += (double)NumActive() * check_interval;
+            all_owner_time += (double)num_total * check_interval;
+        } while (t < max_settle_time && MaxActiveVel() > settle_vel);
+        return t;
+    }
+
+    // Wake frozen layers whose top is within reach of this object's CoM whenever Update is called
+    void WatchImpactor(std::shared_ptr<DEMTracker> tracker, float reach) { impactors.push_back({tracker, reach}); }
+
+    // Call right after a sync during the phase the impactors move in
+    void Update() {
+        for (const auto& imp : impactors) {
+            float reach_z = imp.tracker->Pos().z - imp.reach;
+            for (auto& layer : layers) {
+                if (layer.frozen && layer.top_z >= reach_z) {
+                    Unfreeze(layer);
+                }
+            }
+        }
+    }
+
+    void UnfreezeAll() {
+        for (auto& layer : layers) {
+            if (layer.frozen) {
+                Unfreeze(layer);
+            }
+        }
+    }
+
+    size_t GetNumFrozen() const { return num_total - NumActive(); }
+
+    void ShowStats() const {
+        std::cout << "Layers deposited: " << layers.size() << ", frozen particles: " << GetNumFrozen() << " of "
+                  << num_total << std::endl;
+        std::cout << "Integrated particle-time relative to simulating every layer: "
+                  << ((all_owner_time > 0.) ? active_owner_time / all_owner_time : 1.) << std::endl;
+    }
+
+  private:
+    struct Layer {
+        std::shared_ptr<DEMTracker> tracker;
+        size_t num = 0;
+        bool frozen = false;
+        float top_z = 0.;
+    };
+    struct Impactor {
+        std::shared_ptr<DEMTracker> tracker;
+        float reach;
+    };
+
+    DEMSolver& DEMSim;
+    unsigned int active_family;
+    unsigned int frozen_family;
+    unsigned int active_layers = 2;
+    float settle_vel = 0.01;
+    double max_settle_time = 2.;
+    double check_interval = 0.05;
+
+    std::vector<Layer> layers;
+    std::vector<Impactor> impactors;
+    size_t num_total = 0;
+    double active_owner_time = 0.;
+    double all_owner_time = 0.;
+
+    size_t NumActive() const {
+        size_t n = 0;
+        for (const auto& layer : layers) {
+            n += layer.frozen ? 0 : layer.num;
+        }
+        return n;
+    }
+
+    float MaxActiveVel() const {
+        float v = 0.;
+        for (const auto& layer : layers) {
+            if (!layer.frozen) {
+                for (const auto& vel : layer.tracker->Velocities()) {
+                    v = std::max(v, length(vel));
+                }
+            }
+        }
+        return v;
+    }
+
+    void FreezeBelowActive() {
+        // The newest layer plus active_layers below it stay dynamic
+        if (layers.size() <= active_layers + 1) {
+            return;
+        }
+        for (size_t i = 0; i + active_layers + 1 < layers.size(); i++) {
+            Layer& layer = layers[i];
+            if (!layer.frozen) {
+                layer.top_z = -std::numeric_limits<float>::max();
+                for (const auto& p : layer.tracker->Positions()) {
+                    layer.top_z = std::max(layer.top_z, p.z);
+                }
+                layer.tracker->SetFamily(frozen_family);
+                layer.frozen = true;
+            }
+        }
+    }
+
+    void Unfreeze(Layer& layer) {
+        layer.tracker->SetFamily(active_family);
+        layer.frozen = false;
+    }
+};
+
+#endif
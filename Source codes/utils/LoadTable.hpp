@@ -0,0 +1,224 @@
+// =============================================================================
+// Tabulated time series for prescribed loads and motions.
+//
+// A table holds one time column and any number of value channels, read from a
+// CSV file with a header line (e.g. "time,acc_z") or from the binary format
+// written by WriteBinary. Channels are sampled with linear or natural cubic
+// spline interpolation and held constant outside the tabulated range.
+//
+// Unlike a prescription string, a table is plain data: a measured load history
+// of any length can be swapped in without re-JIT-ing the solver's kernels. The
+// driver applies the sampled value through a tracker (AddAcc, SetVel, ...)
+// each step.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_LOAD_TABLE_HPP
+#define DEME_DRIVERS_LOAD_TABLE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class TABLE_INTERP { LINEAR, CUBIC };
+
+class TimeSeriesTable {
+  public:
+    TimeSeriesTable() {}
+
+    // Read a CSV table; the first column is time, the header names the channels
+    void LoadCsv(const std::string& filename) {
+        std::ifstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open load table " + filename);
+        }
+        Clear();
+        std::string line;
+        std::getline(file, line);
+        std::vector<std::string> header = SplitLine(line);
+        if (header.size() < 2) {
+            throw std::runtime_error("Load table " + filename + " needs a time column and at least one channel");
+        }
+        names.assign(header.begin() + 1, header.end());
+        values.resize(names.size());
+        while (std::getline(file, line)) {
+            std::vector<std::string> cols = SplitLine(line);
+            if (cols.size() != header.size()) {
+                continue;
+            }
+            times.push_back(std::stod(cols[0]));
+            for (size_t c = 0; c < names.size(); c++) {
+                values[c].push_back(std::stod(cols[c + 1]));
+            }
+        }
+        Finalize();
+    }
+
+    // Binary layout: uint64 num_rows, uint64 num_channels, then num_rows * (1 + num_channels) doubles, row-major.
+    // Channel names are not stored; they become "ch0", "ch1", ...
+    void LoadBinary(const std::string& filename) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open load table " + filename);
+        }
+        Clear();
+        uint64_t num_rows = 0, num_channels = 0;
+        file.read(reinterpret_cast<char*>(&num_rows), sizeof(num_rows));
+        file.read(reinterpret_cast<char*>(&num_channels), sizeof(num_channels));
+        std::vector<double> raw(num_rows * (num_channels + 1));
+        file.read(reinterpret_cast<char*>(raw.data()), raw.size() * sizeof(double));
+        if (!file) {
+            throw std::runtime_error("Load table " + filename + " is truncated");
+        }
+        values.resize(num_channels);
+        for (uint64_t c = 0; c < num_channels; c++) {
+            names.push_back("ch" + std::to_string(c));
+        }
+        for (uint64_t r = 0; r < num_rows; r++) {
+            times.push_back(raw[r * (num_channels + 1)]);
+            for (uint64_t c = 0; c < num_channels; c++) {
+                values[c].push_back(raw[r * (num_channels + 1) + 1 + c]);
+            }
+        }
+        Finalize();
+    }
+
+    void WriteBinary(const std::string& filename) const {
+        std::ofstream file(filename, std::ios::binary);
+        uint64_t num_rows = times.size(), num_channels = values.size();
+        file.write(reinterpret_cast<const char*>(&num_rows), sizeof(num_rows));
+        file.write(reinterpret_cast<const char*>(&num_channels), sizeof(num_channels));
+        for (size_t r = 0; r < times.size(); r++) {
+            file.write(reinterpret_cast<const char*>(&times[r]), sizeof(double));
+            for (size_t c = 0; c < values.size(); c++) {
+                file.write(reinterpret_cast<const char*>(&values[c][r]), sizeof(double));
+            }
+        }
+    }
+
+    // Build a single-channel table by sampling a function at num_samples (at least 2) points over [t0, t1]
+    void Tabulate(const std::string& name, double t0, double t1, size_t num_samples,
+                  const std::function<double(double)>& func) {
+        if (num_samples < 2) {
+            throw std::runtime_error("Load table needs at least 2 samples to tabulate " + name);
+        }
+        Clear();
+        names.push_back(name);
+        values.resize(1);
+        for (size_t i = 0; i < num_samples; i++) {
+            double t = t0 + (t1 - t0) * i / (num_samples - 1);
+            times.push_back(t);
+            values[0].push_back(func(t));
+        }
+        Finalize();
+    }
+
+    void SetInterpolation(TABLE_INTERP interp) { this->interp = interp; }
+
+    size_t GetChannel(const std::string& name) const {
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it == names.end()) {
+            throw std::runtime_error("Load table has no channel named " + name);
+        }
+        return it - names.begin();
+    }
+
+    double GetStartTime() const { return times.front(); }
+    double GetEndTime() const { return times.back(); }
+    size_t GetNumChannels() const { return values.size(); }
+
+    // Value of a channel at time t. Consecutive calls with increasing t are O(1).
+    double Sample(double t, size_t channel = 0) const {
+        if (t <= times.front()) {
+            return values[channel].front();
+        }
+        if (t >= times.back()) {
+            return values[channel].back();
+        }
+        size_t i = Locate(t);
+        double h = times[i + 1] - times[i];
+        double a = (times[i + 1] - t) / h;
+        double b = (t - times[i]) / h;
+        const std::vector<double>& y = values[channel];
+        double val = a * y[i] + b * y[i + 1];
+        if (interp == TABLE_INTERP::CUBIC) {
+            const std::vector<double>& y2 = second_derivs[channel];
+            val += ((a * a * a - a) * y2[i] + (b * b * b - b) * y2[i + 1]) * h * h / 6.;
+        }
+        return val;
+    }
+
+  private:
+    std::vector<double> times;
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> values;
+    std::vector<std::vector<double>> second_derivs;
+    TABLE_INTERP interp = TABLE_INTERP::LINEAR;
+    mutable size_t cursor = 0;
+
+    void Clear() {
+        times.clear();
+        names.clear();
+        values.clear();
+        second_derivs.clear();
+        cursor = 0;
+    }
+
+    static std::vector<std::string> SplitLine(const std::string& line) {
+        std::vector<std::string> cols;
+        std::stringstream ss(line);
+        std::string col;
+        while (std::getline(ss, col, ',')) {
+            cols.push_back(col);
+        }
+        return cols;
+    }
+
+    size_t Locate(double t) const {
+        if (cursor + 1 < times.size() && times[cursor] <= t && t < times[cursor + 1]) {
+            return cursor;
+        }
+        if (cursor + 2 < times.size() && times[cursor + 1] <= t && t < times[cursor + 2]) {
+            return ++cursor;
+        }
+        cursor = std::upper_bound(times.begin(), times.end(), t) - times.begin() - 1;
+        return cursor;
+    }
+
+    void Finalize() {
+        if (times.size() < 2) {
+            throw std::runtime_error("Load table needs at least 2 rows");
+        }
+        for (size_t i = 1; i < times.size(); i++) {
+            if (times[i] <= times[i - 1]) {
+                throw std::runtime_error("Load table time column must be strictly increasing");
+            }
+        }
+        // Natural cubic spline second derivatives, tridiagonal solve per channel
+        size_t n = times.size();
+        second_derivs.assign(values.size(), std::vector<double>(n, 0.));
+        std::vector<double> u(n, 0.);
+        for (size_t c = 0; c < values.size(); c++) {
+            std::vector<double>& y2 = second_derivs[c];
+            const std::vector<double>& y = values[c];
+            for (size_t i = 1; i + 1 < n; i++) {
+                double sig = (times[i] - times[i - 1]) / (times[i + 1] - times[i - 1]);
+                double p = sig * y2[i - 1] + 2.;
+                y2[i] = (sig - 1.) / p;
+                u[i] = (y[i + 1] - y[i]) / (times[i + 1] - times[i]) - (y[i] - y[i - 1]) / (times[i] - times[i - 1]);
+                u[i] = (6. * u[i] / (times[i + 1] - times[i - 1]) - sig * u[i - 1]) / p;
+            }
+            y2[n - 1] = 0.;
+            for (size_t k = n - 1; k-- > 0;) {
+                y2[k] = y2[k] * y2[k + 1] + u[k];
+            }
+        }
+    }
+};
+
+#endif
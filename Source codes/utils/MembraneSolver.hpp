@@ -0,0 +1,287 @@
+// =============================================================================
+// Explicit membrane finite elements for a flexible mesh, run inside the DEM
+// step loop.
+//
+// Every triangle of the tracked mesh is a constant-strain membrane element of
+// the given thickness (St. Venant-Kirchhoff, plane stress). The element
+// measures Green-Lagrange strain, so large rotations of the sheet give no
+// stress. The mass is lumped to the nodes. The nodes move by semi-implicit
+// Euler with mass-proportional damping.
+//
+// The contact forces the tracker reports are spread to the three nodes of the
+// nearest triangle with barycentric weights. A uniform pressure can be added
+// on the faces, e.g. the confining pressure on a triaxial sleeve. Advance
+// covers the DEM time since the last call in sub-steps no longer than the
+// membrane's own stable step, then writes the nodes back through UpdateMesh.
+//
+// Everything is in the mesh frame. The mesh is expected to be fixed or
+// prescribed; its rigid motion is not fed back into the membrane. Fixed nodes
+// keep their position until SetNodePosition moves them (e.g. with a platen).
+// =============================================================================
+
+#ifndef DEME_DRIVERS_MEMBRANE_SOLVER_HPP
+#define DEME_DRIVERS_MEMBRANE_SOLVER_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "MeshBVH.hpp"
+#include "MeshNodeBuffer.hpp"
+
+using namespace deme;
+
+class MembraneSolver {
+  public:
+    // The tracker of a mesh, after Initialize; Young's modulus, Poisson's ratio and density of the membrane
+    MembraneSolver(std::shared_ptr<DEMTracker> tracker, float thickness, float E, float nu, float density)
+        : nodes(tracker), tracker(tracker), thickness(thickness), E(E), nu(nu), density(density) {
+        if (thickness <= 0.f || E <= 0.f || density <= 0.f || nu < 0.f || nu >= 0.5f) {
+            throw std::runtime_error("Invalid membrane properties");
+        }
+        faces = tracker->GetMesh()->m_face_v_indices;
+        size_t n = nodes.size();
+        x.assign(nodes.Local(), nodes.Local() + n);
+        rest = x;
+        v.assign(n, make_float3(0));
+        f_ext.assign(n, make_float3(0));
+        f.assign(n, make_float3(0));
+        mass.assign(n, 0.f);
+        fixed.assign(n, 0);
+
+        // Reference shape of each element in its own plane, and the lumped masses
+        float wave_speed = std::sqrt(E / (density * (1.f - nu * nu)));
+        stable_step = std::numeric_limits<float>::max();
+        elems.resize(faces.size());
+        for (size_t e = 0; e < faces.size(); e++) {
+            const int3& t = faces[e];
+            float3 e1 = x[t.y] - x[t.x], e2 = x[t.z] - x[t.x];
+            float3 nrm = cross(e1, e2);
+            float area = 0.5f * length(nrm);
+            if (area <= 0.f) {
+                throw std::runtime_error("MembraneSolver found a degenerate triangle");
+            }
+            // In-plane axes: a along e1, b in the plane perpendicular to it
+            float3 a = normalize(e1), b = normalize(cross(nrm, e1));
+            float m00 = dot(e1, a), m01 = dot(e2, a), m10 = dot(e1, b), m11 = dot(e2, b);
+            float det = m00 * m11 - m01 * m10;
+            Elem& el = elems[e];
+            el.inv[0][0] = m11 / det;
+            el.inv[0][1] = -m01 / det;
+            el.inv[1][0] = -m10 / det;
+            el.inv[1][1] = m00 / det;
+            el.area = area;
+            for (int k : {t.x, t.y, t.z}) {
+                mass[k] += density * thickness * area / 3.f;
+            }
+            // The smallest height of the triangle bounds the element's stable step
+            float longest = std::max({length(e1), length(e2), length(x[t.z] - x[t.y])});
+            stable_step = std::min(stable_step, 2.f * area / longest / wave_speed);
+        }
+        bvh.Build(x, faces);
+    }
+
+    // Mass-proportional damping coefficient, 1/s
+    void SetDamping(float c) { damping = c; }
+    // Fraction of the stable step actually used by a sub-step
+    void SetSafetyFactor(float s) { safety = s; }
+    // Pressure on the faces; positive pushes against the face normals (inward on an outward-oriented mesh)
+    void SetPressure(float p) { pressure = p; }
+
+    void FixNode(size_t i) { fixed.at(i) = 1; }
+    // Fix every node whose rest position (mesh frame) satisfies pred; returns how many were fixed
+    size_t FixNodesWhere(const std::function<bool(const float3&)>& pred) {
+        size_t count = 0;
+        for (size_t i = 0; i < x.size(); i++) {
+            if (!fixed[i] && pred(rest[i])) {
+                fixed[i] = 1;
+                count++;
+            }
+        }
+        return count;
+    }
+    // Move a fixed node (mesh frame); the move reaches the solver with the next Advance
+    void SetNodePosition(size_t i, const float3& p) {
+        if (!fixed.at(i)) {
+            throw std::runtime_error("MembraneSolver::SetNodePosition needs a fixed node");
+        }
+        x[i] = p;
+        v[i] = make_float3(0);
+    }
+
+    // Loads for the next Advance, from tracker->GetContactForces (global frame, acting on the mesh). Returns the
+    // number of forces that found a triangle within max_dist of their contact point.
+    size_t ApplyContactForces(const std::vector<float3>& points,
+                              const std::vector<float3>& forces,
+                              size_t num_forces,
+                              float max_dist) {
+        std::fill(f_ext.begin(), f_ext.end(), make_float3(0));
+        if (num_forces == 0) {
+            return 0;
+        }
+        float3 pos = tracker->Pos();
+        float4 oriQ = tracker->OriQ();
+        local_points.resize(num_forces);
+        local_forces.resize(num_forces);
+        FrameToLocal(points.data(), local_points.data(), num_forces, pos, oriQ);
+        FrameToLocal(forces.data(), local_forces.data(), num_forces, make_float3(0), oriQ);
+        bvh.Refit(x);
+        size_t applied = 0;
+        for (size_t i = 0; i < num_forces; i++) {
+            float dist;
+            int tri = bvh.Nearest(local_points[i], dist, max_dist);
+            if (tri < 0) {
+                continue;
+            }
+            const int3& t = faces[tri];
+            float w[3];
+            Barycentric(local_points[i], x[t.x], x[t.y], x[t.z], w);
+            f_ext[t.x] = f_ext[t.x] + local_forces[i] * w[0];
+            f_ext[t.y] = f_ext[t.y] + local_forces[i] * w[1];
+            f_ext[t.z] = f_ext[t.z] + local_forces[i] * w[2];
+            applied++;
+        }
+        return applied;
+    }
+
+    // Advance the membrane by dt (the DEM time since the last call) and send the nodes to the solver
+    void Advance(float dt) {
+        num_substeps = std::max(1u, (unsigned int)std::ceil(dt / (safety * stable_step)));
+        float h = dt / num_substeps;
+        for (unsigned int s = 0; s < num_substeps; s++) {
+            ComputeInternalForces();
+            for (size_t i = 0; i < x.size(); i++) {
+                if (fixed[i]) {
+                    continue;
+                }
+                float3 acc = (f[i] + f_ext[i]) * (1.f / mass[i]) - v[i] * damping;
+                v[i] = v[i] + acc * h;
+                x[i] = x[i] + v[i] * h;
+            }
+        }
+        std::copy(x.begin(), x.end(), nodes.Local());
+        nodes.Flush();
+        time += dt;
+    }
+
+    float GetStableStep() const { return stable_step; }
+    unsigned int GetNumSubsteps() const { return num_substeps; }
+    // Current node positions, mesh frame
+    const std::vector<float3>& GetNodes() const { return x; }
+
+    // Strain energy of the membrane
+    double GetStrainEnergy() const {
+        double energy = 0.;
+        for (size_t e = 0; e < faces.size(); e++) {
+            float G[2][2];
+            Strain(e, nullptr, G);
+            float lam = E * nu / (1.f - nu * nu), mu = E / (2.f * (1.f + nu));
+            float tr = G[0][0] + G[1][1];
+            float GG = G[0][0] * G[0][0] + 2.f * G[0][1] * G[1][0] + G[1][1] * G[1][1];
+            energy += elems[e].area * thickness * (0.5 * lam * tr * tr + mu * GG);
+        }
+        return energy;
+    }
+
+    void ShowStats() const {
+        float max_disp = 0.f;
+        for (size_t i = 0; i < x.size(); i++) {
+            max_disp = std::max(max_disp, length(x[i] - rest[i]));
+        }
+        std::cout << "Membrane at t = " << time << ": " << num_substeps << " sub-steps of at most " << stable_step
+                  << " s, max node displacement " << max_disp << ", strain energy " << GetStrainEnergy() << std::endl;
+    }
+
+  private:
+    struct Elem {
+        // Inverse of the reference edge matrix in the element plane
+        float inv[2][2];
+        float area;
+    };
+
+    MeshNodeBuffer nodes;
+    std::shared_ptr<DEMTracker> tracker;
+    std::vector<int3> faces;
+    std::vector<Elem> elems;
+    MeshBVH bvh;
+    // Rest and current positions, velocities, internal and external forces per node
+    std::vector<float3> rest, x, v, f, f_ext;
+    std::vector<float> mass;
+    std::vector<char> fixed;
+    std::vector<float3> local_points, local_forces;
+    float thickness, E, nu, density;
+    float damping = 0.f, safety = 0.5f, pressure = 0.f;
+    float stable_step;
+    unsigned int num_substeps = 0;
+    double time = 0.;
+
+    // Deformation gradient (3x2, columns F[0], F[1]) and Green-Lagrange strain of element e
+    void Strain(size_t e, float3* F, float G[2][2]) const {
+        const int3& t = faces[e];
+        const Elem& el = elems[e];
+        float3 d1 = x[t.y] - x[t.x], d2 = x[t.z] - x[t.x];
+        float3 c0 = d1 * el.inv[0][0] + d2 * el.inv[1][0];
+        float3 c1 = d1 * el.inv[0][1] + d2 * el.inv[1][1];
+        G[0][0] = 0.5f * (dot(c0, c0) - 1.f);
+        G[1][1] = 0.5f * (dot(c1, c1) - 1.f);
+        G[0][1] = G[1][0] = 0.5f * dot(c0, c1);
+        if (F) {
+            F[0] = c0;
+            F[1] = c1;
+        }
+    }
+
+    void ComputeInternalForces() {
+        std::fill(f.begin(), f.end(), make_float3(0));
+        float lam = E * nu / (1.f - nu * nu), mu = E / (2.f * (1.f + nu));
+        for (size_t e = 0; e < faces.size(); e++) {
+            const int3& t = faces[e];
+            const Elem& el = elems[e];
+            float3 F[2];
+            float G[2][2];
+            Strain(e, F, G);
+            // Second Piola-Kirchhoff stress, then the first: P = F S
+            float tr = G[0][0] + G[1][1];
+            float S00 = lam * tr + 2.f * mu * G[0][0], S11 = lam * tr + 2.f * mu * G[1][1], S01 = 2.f * mu * G[0][1];
+            float3 P0 = F[0] * S00 + F[1] * S01, P1 = F[0] * S01 + F[1] * S11;
+            // Nodal forces -V P Dm^-T on the second and third nodes, and their negative sum on the first
+            float V = el.area * thickness;
+            float3 f1 = (P0 * el.inv[0][0] + P1 * el.inv[0][1]) * (-V);
+            float3 f2 = (P0 * el.inv[1][0] + P1 * el.inv[1][1]) * (-V);
+            f[t.y] = f[t.y] + f1;
+            f[t.z] = f[t.z] + f2;
+            f[t.x] = f[t.x] - f1 - f2;
+            if (pressure != 0.f) {
+                float3 fp = cross(x[t.y] - x[t.x], x[t.z] - x[t.x]) * (-pressure / 6.f);
+                f[t.x] = f[t.x] + fp;
+                f[t.y] = f[t.y] + fp;
+                f[t.z] = f[t.z] + fp;
+            }
+        }
+    }
+
+    // Barycentric weights of the point of triangle (a, b, c) closest to p's projection, clamped into the triangle
+    static void Barycentric(const float3& p, const float3& a, const float3& b, const float3& c, float w[3]) {
+        float3 ab = b - a, ac = c - a, ap = p - a;
+        float d00 = dot(ab, ab), d01 = dot(ab, ac), d11 = dot(ac, ac);
+        float d20 = dot(ap, ab), d21 = dot(ap, ac);
+        float denom = d00 * d11 - d01 * d01;
+        w[1] = std::max(0.f, (d11 * d20 - d01 * d21) / denom);
+        w[2] = std::max(0.f, (d00 * d21 - d01 * d20) / denom);
+        w[0] = std::max(0.f, 1.f - w[1] - w[2]);
+        float sum = w[0] + w[1] + w[2];
+        for (int k = 0; k < 3; k++) {
+            w[k] /= sum;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,288 @@
+// =============================================================================
+// Bounding volume hierarchy over the triangles of a mesh, for finding the
+// triangles near a sphere without testing or binning all of them.
+//
+// The tree is built once, in the mesh's own frame, by splitting the triangle
+// centroids at the median of their widest axis until a leaf holds a few
+// triangles. When the mesh deforms (the node positions handed to UpdateMesh),
+// Refit recomputes the boxes bottom-up and keeps the topology, which stays
+// good as long as the deformation is moderate. A rigid mesh never needs a
+// refit: world-frame queries are moved into the mesh frame with ToLocal and
+// the tracker's position and orientation.
+//
+// Queries: the triangles whose boxes come within a radius of a point
+// (sphere-vs-mesh candidates), whether any triangle does, and the closest
+// triangle and its distance.
+//
+// This is a host-side tool for inspecting meshes, e.g. counting the
+// particle-triangle candidates a mesh generates at a pose while tuning its
+// resolution. DEME's kinematic thread keeps its own bin-based broadphase and
+// never sees this tree, so building one does not change the solver's step time.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_MESH_BVH_HPP
+#define DEME_DRIVERS_MESH_BVH_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace deme;
+
+// Squared distance from p to triangle (a, b, c) (Ericson, Real-Time Collision Detection 5.1.5)
+inline float PointTriangleDist2(const float3& p, const float3& a, const float3& b, const float3& c) {
+    float3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = dot(ab, ap), d2 = dot(ac, ap);
+    if (d1 <= 0.f && d2 <= 0.f) {
+        return dot(ap, ap);
+    }
+    float3 bp = p - b;
+    float d3 = dot(ab, bp), d4 = dot(ac, bp);
+    if (d3 >= 0.f && d4 <= d3) {
+        return dot(bp, bp);
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+        float3 d = ap - ab * (d1 / (d1 - d3));
+        return dot(d, d);
+    }
+    float3 cp = p - c;
+    float d5 = dot(ab, cp), d6 = dot(ac, cp);
+    if (d6 >= 0.f && d5 <= d6) {
+        return dot(cp, cp);
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+        float3 d = ap - ac * (d2 / (d2 - d6));
+        return dot(d, d);
+    }
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.f && (d4 - d3) >= 0.f && (d5 - d6) >= 0.f) {
+        float3 d = bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+        return dot(d, d);
+    }
+    float denom = 1.f / (va + vb + vc);
+    float3 d = ap - ab * (vb * denom) - ac * (vc * denom);
+    return dot(d, d);
+}
+
+class MeshBVH {
+  public:
+    MeshBVH() = default;
+    MeshBVH(const std::vector<float3>& vertices, const std::vector<int3>& faces, unsigned int leaf_size = 4) {
+        Build(vertices, faces, leaf_size);
+    }
+
+    void Build(const std::vector<float3>& vertices, const std::vector<int3>& faces, unsigned int leaf_size = 4) {
+        if (faces.empty()) {
+            throw std::runtime_error("MeshBVH needs at least one triangle");
+        }
+        verts = vertices;
+        tris = faces;
+        leaf = std::max(1u, leaf_size);
+        order.resize(tris.size());
+        std::vector<float3> centroids(tris.size());
+        for (unsigned int f = 0; f < tris.size(); f++) {
+            order[f] = f;
+            const int3& t = tris[f];
+            centroids[f] = (verts[t.x] + verts[t.y] + verts[t.z]) * (1.f / 3.f);
+        }
+        nodes.clear();
+        nodes.reserve(2 * tris.size() / leaf + 1);
+        Split(0, (unsigned int)tris.size(), centroids);
+        Refit(verts);
+    }
+
+    // New node positions (same count and order, mesh frame), e.g. what was passed to UpdateMesh
+    void Refit(const std::vector<float3>& vertices) {
+        if (vertices.size() != verts.size()) {
+            throw std::runtime_error("MeshBVH::Refit got a different number of vertices");
+        }
+        verts = vertices;
+        // Children always come after their parent
+        for (size_t n = nodes.size(); n-- > 0;) {
+            Node& node = nodes[n];
+            if (node.count > 0) {
+                node.lo = make_float3(std::numeric_limits<float>::max());
+                node.hi = make_float3(-std::numeric_limits<float>::max());
+                for (unsigned int i = node.first; i < node.first + node.count; i++) {
+                    const int3& t = tris[order[i]];
+                    for (int v : {t.x, t.y, t.z}) {
+                        node.lo = Min(node.lo, verts[v]);
+                        node.hi = Max(node.hi, verts[v]);
+                    }
+                }
+            } else {
+                const Node &a = nodes[n + 1], &b = nodes[node.first];
+                node.lo = Min(a.lo, b.lo);
+                node.hi = Max(a.hi, b.hi);
+            }
+        }
+    }
+
+    size_t GetNumTriangles() const { return tris.size(); }
+    size_t GetNumNodes() const { return nodes.size(); }
+    const std::vector<float3>& GetVertices() const { return verts; }
+    const std::vector<int3>& GetFaces() const { return tris; }
+
+    // Call func(triangle) for each triangle whose bounding box comes within radius of p
+    template <typename F>
+    void ForEachNear(const float3& p, float radius, F&& func) const {
+        float r2 = radius * radius;
+        unsigned int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            unsigned int n = stack[--top];
+            const Node& node = nodes[n];
+            if (BoxDist2(node, p) > r2) {
+                continue;
+            }
+            if (node.count > 0) {
+                for (unsigned int i = node.first; i < node.first + node.count; i++) {
+                    func(order[i]);
+                }
+            } else {
+                stack[top++] = node.first;
+                stack[top++] = n + 1;
+            }
+        }
+    }
+
+    // Candidate triangles for a sphere at p, in the mesh frame
+    void Candidates(const float3& p, float radius, std::vector<unsigned int>& out) const {
+        out.clear();
+        ForEachNear(p, radius, [&](unsigned int f) { out.push_back(f); });
+    }
+
+    // Whether any triangle is closer to p than radius
+    bool AnyWithin(const float3& p, float radius) const {
+        float r2 = radius * radius;
+        bool hit = false;
+        ForEachNear(p, radius, [&](unsigned int f) { hit = hit || TriangleDist2(f, p) < r2; });
+        return hit;
+    }
+
+    // Distance from p to the closest triangle, or max_dist if none is closer
+    float Distance(const float3& p, float max_dist = std::numeric_limits<float>::max()) const {
+        float dist;
+        Nearest(p, dist, max_dist);
+        return dist;
+    }
+
+    // The triangle closest to p and its distance, or -1 and max_dist if none is closer than max_dist
+    int Nearest(const float3& p, float& dist, float max_dist = std::numeric_limits<float>::max()) const {
+        float best = (max_dist < std::sqrt(std::numeric_limits<float>::max())) ? max_dist * max_dist
+                                                                                : std::numeric_limits<float>::max();
+        int nearest = -1;
+        unsigned int stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            unsigned int n = stack[--top];
+            const Node& node = nodes[n];
+            if (BoxDist2(node, p) >= best) {
+                continue;
+            }
+            if (node.count > 0) {
+                for (unsigned int i = node.first; i < node.first + node.count; i++) {
+                    float d2 = TriangleDist2(order[i], p);
+                    if (d2 < best) {
+                        best = d2;
+                        nearest = (int)order[i];
+                    }
+                }
+            } else {
+                // Visit the nearer child first so the farther one is more likely pruned
+                unsigned int a = n + 1, b = node.first;
+                if (BoxDist2(nodes[a], p) < BoxDist2(nodes[b], p)) {
+                    std::swap(a, b);
+                }
+                stack[top++] = a;
+                stack[top++] = b;
+            }
+        }
+        dist = (nearest < 0) ? max_dist : std::sqrt(best);
+        return nearest;
+    }
+
+    float TriangleDist2(unsigned int f, const float3& p) const {
+        const int3& t = tris[f];
+        return PointTriangleDist2(p, verts[t.x], verts[t.y], verts[t.z]);
+    }
+
+    // World point into the frame of a mesh at pos with orientation oriQ (x, y, z, w), as a tracker reports them
+    static float3 ToLocal(const float3& p, const float3& pos, const float4& oriQ) {
+        float3 d = p - pos;
+        // Rotate by the conjugate quaternion
+        float3 u = make_float3(-oriQ.x, -oriQ.y, -oriQ.z);
+        float3 t = cross(u, d) * 2.f;
+        return d + t * oriQ.w + cross(u, t);
+    }
+
+  private:
+    // Leaves have count > 0 and hold order[first, first + count); an inner node's children are the next node and
+    // node first
+    struct Node {
+        float3 lo, hi;
+        unsigned int first, count;
+    };
+
+    std::vector<float3> verts;
+    std::vector<int3> tris;
+    std::vector<unsigned int> order;
+    std::vector<Node> nodes;
+    unsigned int leaf = 4;
+
+    static float3 Min(const float3& a, const float3& b) {
+        return make_float3(std::min(a.x, b.x), std::min(a.y, b.y), std::min(a.z, b.z));
+    }
+    static float3 Max(const float3& a, const float3& b) {
+        return make_float3(std::max(a.x, b.x), std::max(a.y, b.y), std::max(a.z, b.z));
+    }
+
+    static float BoxDist2(const Node& node, const float3& p) {
+        float dx = std::max({node.lo.x - p.x, 0.f, p.x - node.hi.x});
+        float dy = std::max({node.lo.y - p.y, 0.f, p.y - node.hi.y});
+        float dz = std::max({node.lo.z - p.z, 0.f, p.z - node.hi.z});
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Median split on the widest axis of the centroids; the depth stays near log2(n / leaf), well within the
+    // traversal stacks
+    unsigned int Split(unsigned int begin, unsigned int end, const std::vector<float3>& centroids) {
+        unsigned int n = (unsigned int)nodes.size();
+        nodes.push_back(Node{make_float3(0), make_float3(0), begin, end - begin});
+        if (end - begin <= leaf) {
+            return n;
+        }
+        float3 lo = centroids[order[begin]], hi = lo;
+        for (unsigned int i = begin; i < end; i++) {
+            lo = Min(lo, centroids[order[i]]);
+            hi = Max(hi, centroids[order[i]]);
+        }
+        float3 ext = hi - lo;
+        int axis = (ext.x >= ext.y && ext.x >= ext.z) ? 0 : (ext.y >= ext.z ? 1 : 2);
+        auto key = [&](unsigned int f) {
+            const float3& c = centroids[f];
+            return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+        };
+        unsigned int mid = begin + (end - begin) / 2;
+        // Ties broken by index so the tree does not depend on the sort implementation
+        auto less = [&](unsigned int a, unsigned int b) { return key(a) < key(b) || (key(a) == key(b) && a < b); };
+        std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, less);
+        Split(begin, mid, centroids);
+        unsigned int right = Split(mid, end, centroids);
+        nodes[n].first = right;
+        nodes[n].count = 0;
+        return n;
+    }
+};
+
+#endif
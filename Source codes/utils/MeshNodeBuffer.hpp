@@ -0,0 +1,128 @@
+// =============================================================================
+// A persistent, writable host copy of a flexible mesh's node coordinates.
+//
+// The nodes are read once, in the mesh frame (relative to the CoM), when the
+// buffer is made. From then on the host copy is the reference: the caller
+// deforms the nodes in place through Local(), or from global coordinates with
+// SetFromGlobal, and Flush hands the array to UpdateMesh. A flush where no node
+// changed since the last one is skipped. No vector is allocated per update, and
+// the nodes are never read back from the solver (no GetMeshNodesGlobal).
+//
+// FrameToLocal and FrameToGlobal convert whole arrays between the global and
+// mesh frames. They build the rotation matrix from the tracker's quaternion
+// once, then run a plain loop the compiler can vectorize, instead of calling
+// applyFrameTransformGlobalToLocal node by node.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_MESH_NODE_BUFFER_HPP
+#define DEME_DRIVERS_MESH_NODE_BUFFER_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace deme;
+
+// Rotation matrix (row-major) of a unit quaternion (x, y, z, w)
+inline void QuatToMatrix(const float4& q, float R[3][3]) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    R[0][0] = 1.f - 2.f * (yy + zz);
+    R[0][1] = 2.f * (xy - wz);
+    R[0][2] = 2.f * (xz + wy);
+    R[1][0] = 2.f * (xy + wz);
+    R[1][1] = 1.f - 2.f * (xx + zz);
+    R[1][2] = 2.f * (yz - wx);
+    R[2][0] = 2.f * (xz - wy);
+    R[2][1] = 2.f * (yz + wx);
+    R[2][2] = 1.f - 2.f * (xx + yy);
+}
+
+// out[i] = R^T (in[i] - pos); in and out may be the same array
+inline void FrameToLocal(const float3* in, float3* out, size_t n, const float3& pos, const float4& oriQ) {
+    float R[3][3];
+    QuatToMatrix(oriQ, R);
+    for (size_t i = 0; i < n; i++) {
+        float dx = in[i].x - pos.x, dy = in[i].y - pos.y, dz = in[i].z - pos.z;
+        out[i] = make_float3(R[0][0] * dx + R[1][0] * dy + R[2][0] * dz, R[0][1] * dx + R[1][1] * dy + R[2][1] * dz,
+                             R[0][2] * dx + R[1][2] * dy + R[2][2] * dz);
+    }
+}
+
+// out[i] = R in[i] + pos; in and out may be the same array
+inline void FrameToGlobal(const float3* in, float3* out, size_t n, const float3& pos, const float4& oriQ) {
+    float R[3][3];
+    QuatToMatrix(oriQ, R);
+    for (size_t i = 0; i < n; i++) {
+        float x = in[i].x, y = in[i].y, z = in[i].z;
+        out[i] = make_float3(R[0][0] * x + R[0][1] * y + R[0][2] * z + pos.x,
+                             R[1][0] * x + R[1][1] * y + R[1][2] * z + pos.y,
+                             R[2][0] * x + R[2][1] * y + R[2][2] * z + pos.z);
+    }
+}
+
+class MeshNodeBuffer {
+  public:
+    // The tracker of a mesh, after Initialize
+    explicit MeshNodeBuffer(std::shared_ptr<DEMTracker> tracker) : tracker(tracker) {
+        local = tracker->GetMesh()->GetCoordsVertices();
+        sent = local;
+    }
+
+    size_t size() const { return local.size(); }
+
+    // Node coordinates in the mesh frame, to be written in place; call Flush when done
+    float3* Local() { return local.data(); }
+    const float3* Local() const { return local.data(); }
+    float3& operator[](size_t i) { return local[i]; }
+    const float3& operator[](size_t i) const { return local[i]; }
+
+    // Global coordinates of all nodes at the mesh's current pose, computed on the host
+    void GetGlobal(std::vector<float3>& out) const {
+        out.resize(local.size());
+        FrameToGlobal(local.data(), out.data(), local.size(), tracker->Pos(), tracker->OriQ());
+    }
+
+    // Set count nodes starting at first from global coordinates (e.g. an external solver's output)
+    void SetFromGlobal(const float3* global, size_t first, size_t count) {
+        if (first + count > local.size()) {
+            throw std::runtime_error("MeshNodeBuffer::SetFromGlobal writes past the last node");
+        }
+        FrameToLocal(global, local.data() + first, count, tracker->Pos(), tracker->OriQ());
+    }
+
+    // Send the nodes to the solver if any changed since the last flush. Returns the number of changed nodes.
+    size_t Flush() {
+        size_t changed = 0;
+        for (size_t i = 0; i < local.size(); i++) {
+            const float3 &a = local[i], &b = sent[i];
+            changed += (a.x != b.x) | (a.y != b.y) | (a.z != b.z);
+        }
+        if (changed > 0) {
+            tracker->UpdateMesh(local);
+            sent = local;
+            num_flushed++;
+        } else {
+            num_skipped++;
+        }
+        return changed;
+    }
+
+    // Flushes that reached the solver and those skipped because nothing moved
+    size_t GetNumFlushed() const { return num_flushed; }
+    size_t GetNumSkipped() const { return num_skipped; }
+
+  private:
+    std::shared_ptr<DEMTracker> tracker;
+    std::vector<float3> local;
+    // What the solver has now
+    std::vector<float3> sent;
+    size_t num_flushed = 0, num_skipped = 0;
+};
+
+#endif
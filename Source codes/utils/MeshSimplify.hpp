@@ -0,0 +1,620 @@
+// =============================================================================
+// Decimation of imported contact meshes down to the resolution the particles
+// can feel.
+//
+// CAD exports are usually far finer than the particles. MeshSimplifier
+// collapses edges shorter than a target length (normally the smallest particle
+// radius) in order of their quadric error (Garland-Heckbert). A collapse is
+// only done while the surface stays within a tolerance of the original planes.
+//
+// Sharp features are kept. A feature edge is one whose dihedral angle exceeds
+// the feature angle, or an open boundary. Feature edges are only collapsed
+// along themselves, and corners where they meet never move. A smooth collapse
+// places the merged vertex at the quadric optimum under the constraint that the
+// enclosed volume does not change. Collapses that would fold a triangle or make
+// the mesh non-manifold are skipped.
+//
+// The result depends only on the input and the settings: there are no threads,
+// and ties are broken by vertex index. SimplifyFile keeps it in a cache
+// directory under a hash of the input file and the settings, so later runs
+// just load it. Mass properties are recomputed from the simplified mesh.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_MESH_SIMPLIFY_HPP
+#define DEME_DRIVERS_MESH_SIMPLIFY_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "ClumpBuilder.hpp"
+
+using namespace deme;
+
+// Volume, centroid and principal inertia (per unit density) of a closed, outward-oriented triangle mesh
+inline ClumpMassProperties ComputeMeshMassProperties(const std::vector<float3>& vertices,
+                                                     const std::vector<int3>& faces) {
+    // V, Sx, Sy, Sz, Sxx, Syy, Szz, Sxy, Sxz, Syz from signed tetrahedra (0, a, b, c)
+    std::array<double, 10> m{};
+    for (const auto& f : faces) {
+        const float3 t[3] = {vertices[f.x], vertices[f.y], vertices[f.z]};
+        double v[3][3];
+        for (int k = 0; k < 3; k++) {
+            v[k][0] = t[k].x;
+            v[k][1] = t[k].y;
+            v[k][2] = t[k].z;
+        }
+        double det = v[0][0] * (v[1][1] * v[2][2] - v[1][2] * v[2][1]) -
+                     v[0][1] * (v[1][0] * v[2][2] - v[1][2] * v[2][0]) +
+                     v[0][2] * (v[1][0] * v[2][1] - v[1][1] * v[2][0]);
+        double s[3];
+        for (int i = 0; i < 3; i++) {
+            s[i] = v[0][i] + v[1][i] + v[2][i];
+        }
+        // Integral of x_i x_j over the tetrahedron is det / 120 * (sum of v_i v_j + s_i s_j)
+        auto second = [&](int i, int j) {
+            return det / 120. * (v[0][i] * v[0][j] + v[1][i] * v[1][j] + v[2][i] * v[2][j] + s[i] * s[j]);
+        };
+        m[0] += det / 6.;
+        m[1] += det / 24. * s[0];
+        m[2] += det / 24. * s[1];
+        m[3] += det / 24. * s[2];
+        m[4] += second(0, 0);
+        m[5] += second(1, 1);
+        m[6] += second(2, 2);
+        m[7] += second(0, 1);
+        m[8] += second(0, 2);
+        m[9] += second(1, 2);
+    }
+    if (m[0] <= 0.) {
+        throw std::runtime_error("Mesh is not closed or not oriented outward; cannot compute its mass properties");
+    }
+    return MassPropertiesFromMoments(m);
+}
+
+class MeshSimplifier {
+  public:
+    // Edges shorter than target_edge are collapsed while the surface moves by less than max_error
+    MeshSimplifier(double target_edge, double max_error) : target_edge(target_edge), max_error(max_error) {}
+
+    // Dihedral angle above which an edge is a sharp feature, default 30 degrees
+    void SetFeatureAngle(double degrees) { feature_cos = std::cos(degrees * PI / 180.); }
+
+    void Simplify(std::vector<float3>& vertices, std::vector<int3>& faces) {
+        Load(vertices, faces);
+        tri_before = faces.size();
+        volume_before = Volume();
+        Run();
+        Store(vertices, faces);
+        tri_after = faces.size();
+        volume_after = Volume();
+        props = ComputeMeshMassProperties(vertices, faces);
+    }
+
+    // Simplify an OBJ file, or load the cached result of an earlier run with the same file and settings. Returns
+    // the path of the simplified OBJ, for AddWavefrontMeshObject.
+    std::string SimplifyFile(const std::string& filename, const std::string& cache_dir) {
+        std::ifstream in(filename, std::ios::binary);
+        if (!in) {
+            throw std::runtime_error("Failed to open mesh " + filename);
+        }
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        double settings[3] = {target_edge, max_error, feature_cos};
+        bytes.append(reinterpret_cast<const char*>(settings), sizeof(settings));
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)Fnv1a(bytes));
+        std::filesystem::create_directories(cache_dir);
+        std::string cached =
+            cache_dir + "/" + std::filesystem::path(filename).stem().string() + "_" + std::string(hash) + ".obj";
+
+        std::vector<float3> vertices;
+        std::vector<int3> faces;
+        ReadObj(filename, vertices, faces);
+        if (std::filesystem::exists(cached)) {
+            Load(vertices, faces);
+            tri_before = faces.size();
+            volume_before = Volume();
+            ReadObj(cached, vertices, faces);
+            Load(vertices, faces);
+            tri_after = faces.size();
+            volume_after = Volume();
+            props = ComputeMeshMassProperties(vertices, faces);
+            from_cache = true;
+            return cached;
+        }
+        Simplify(vertices, faces);
+        WriteObj(cached, vertices, faces);
+        from_cache = false;
+        return cached;
+    }
+
+    size_t GetNumTrianglesBefore() const { return tri_before; }
+    size_t GetNumTrianglesAfter() const { return tri_after; }
+    double GetVolumeBefore() const { return volume_before; }
+    double GetVolumeAfter() const { return volume_after; }
+    // Of the simplified mesh, per unit density
+    const ClumpMassProperties& GetMassProperties() const { return props; }
+
+    void ShowStats() const {
+        std::cout << "Mesh simplified" << (from_cache ? " (cached)" : "") << ": " << tri_before << " -> " << tri_after
+                  << " triangles, about " << (double)tri_before / std::max<size_t>(1, tri_after)
+                  << "x fewer sphere-triangle tests near the surface" << std::endl;
+        std::cout << "Volume " << volume_before << " -> " << volume_after << ", centroid (" << props.centroid.x
+                  << ", " << props.centroid.y << ", " << props.centroid.z << "), MOI/density (" << props.MOI.x << ", "
+                  << props.MOI.y << ", " << props.MOI.z << ")" << std::endl;
+    }
+
+  private:
+    using Vec = std::array<double, 3>;
+
+    // Sum of squared distances to a set of planes: p^T A p - 2 b.p + c, A stored as xx, xy, xz, yy, yz, zz
+    struct Quadric {
+        double A[6] = {0., 0., 0., 0., 0., 0.};
+        double b[3] = {0., 0., 0.};
+        double c = 0.;
+
+        void AddPlane(const Vec& n, double d) {
+            A[0] += n[0] * n[0];
+            A[1] += n[0] * n[1];
+            A[2] += n[0] * n[2];
+            A[3] += n[1] * n[1];
+            A[4] += n[1] * n[2];
+            A[5] += n[2] * n[2];
+            for (int i = 0; i < 3; i++) {
+                b[i] -= d * n[i];
+            }
+            c += d * d;
+        }
+        Quadric& operator+=(const Quadric& o) {
+            for (int i = 0; i < 6; i++) {
+                A[i] += o.A[i];
+            }
+            for (int i = 0; i < 3; i++) {
+                b[i] += o.b[i];
+            }
+            c += o.c;
+            return *this;
+        }
+        double Eval(const Vec& p) const {
+            double Ap[3] = {A[0] * p[0] + A[1] * p[1] + A[2] * p[2], A[1] * p[0] + A[3] * p[1] + A[4] * p[2],
+                            A[2] * p[0] + A[4] * p[1] + A[5] * p[2]};
+            return p[0] * Ap[0] + p[1] * Ap[1] + p[2] * Ap[2] - 2. * (b[0] * p[0] + b[1] * p[1] + b[2] * p[2]) + c;
+        }
+    };
+
+    struct Candidate {
+        double cost;
+        unsigned int u, v;
+        unsigned int ver_u, ver_v;
+        Vec p;
+        bool operator<(const Candidate& o) const {
+            // Lowest cost on top of the queue; ties by vertex index
+            if (cost != o.cost) {
+                return cost > o.cost;
+            }
+            return (u != o.u) ? u > o.u : v > o.v;
+        }
+    };
+
+    double target_edge;
+    double max_error;
+    double feature_cos = std::cos(30. * PI / 180.);
+
+    std::vector<Vec> pos;
+    std::vector<std::array<unsigned int, 3>> tri;
+    std::vector<uint8_t> tri_alive, vert_alive;
+    std::vector<std::vector<unsigned int>> vert_tris;
+    std::vector<Quadric> quadric;
+    std::vector<unsigned int> version;
+    std::unordered_set<uint64_t> feature_edges;
+
+    size_t tri_before = 0, tri_after = 0;
+    double volume_before = 0., volume_after = 0.;
+    ClumpMassProperties props;
+    bool from_cache = false;
+
+    static Vec Sub(const Vec& a, const Vec& b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+    static Vec Cross(const Vec& a, const Vec& b) {
+        return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+    }
+    static double Dot(const Vec& a, const Vec& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+    static uint64_t EdgeKey(unsigned int a, unsigned int b) {
+        return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    }
+
+    static uint64_t Fnv1a(const std::string& bytes) {
+        uint64_t h = 14695981039346656037ull;
+        for (unsigned char c : bytes) {
+            h = (h ^ c) * 1099511628211ull;
+        }
+        return h;
+    }
+
+    static void ReadObj(const std::string& filename, std::vector<float3>& vertices, std::vector<int3>& faces) {
+        DEMMeshConnected mesh;
+        if (!mesh.LoadWavefrontMesh(filename, false)) {
+            throw std::runtime_error("Failed to load mesh " + filename);
+        }
+        vertices = mesh.GetCoordsVertices();
+        faces = mesh.m_face_v_indices;
+    }
+
+    static void WriteObj(const std::string& filename, const std::vector<float3>& vertices,
+                         const std::vector<int3>& faces) {
+        std::ofstream file(filename);
+        if (!file) {
+            throw std::runtime_error("Cannot write mesh file " + filename);
+        }
+        file.precision(9);
+        for (const auto& v : vertices) {
+            file << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        }
+        for (const auto& f : faces) {
+            file << "f " << f.x + 1 << " " << f.y + 1 << " " << f.z + 1 << "\n";
+        }
+    }
+
+    Vec Normal(const std::array<unsigned int, 3>& t) const {
+        return Cross(Sub(pos[t[1]], pos[t[0]]), Sub(pos[t[2]], pos[t[0]]));
+    }
+
+    double Volume() const {
+        double vol = 0.;
+        for (size_t f = 0; f < tri.size(); f++) {
+            if (tri_alive[f]) {
+                vol += Dot(pos[tri[f][0]], Cross(pos[tri[f][1]], pos[tri[f][2]])) / 6.;
+            }
+        }
+        return vol;
+    }
+
+    // Weld vertices at identical positions (OBJ exports often split them per face) and drop degenerate faces
+    void Load(const std::vector<float3>& vertices, const std::vector<int3>& faces) {
+        std::map<std::array<float, 3>, unsigned int> welded;
+        std::vector<unsigned int> remap(vertices.size());
+        pos.clear();
+        for (size_t i = 0; i < vertices.size(); i++) {
+            std::array<float, 3> key = {vertices[i].x, vertices[i].y, vertices[i].z};
+            auto it = welded.emplace(key, (unsigned int)pos.size());
+            if (it.second) {
+                pos.push_back({vertices[i].x, vertices[i].y, vertices[i].z});
+            }
+            remap[i] = it.first->second;
+        }
+        tri.clear();
+        for (const auto& f : faces) {
+            std::array<unsigned int, 3> t = {remap[f.x], remap[f.y], remap[f.z]};
+            if (t[0] != t[1] && t[1] != t[2] && t[0] != t[2]) {
+                tri.push_back(t);
+            }
+        }
+        tri_alive.assign(tri.size(), 1);
+        vert_alive.assign(pos.size(), 1);
+        vert_tris.assign(pos.size(), {});
+        for (unsigned int f = 0; f < tri.size(); f++) {
+            for (unsigned int v : tri[f]) {
+                vert_tris[v].push_back(f);
+            }
+        }
+    }
+
+    void Store(std::vector<float3>& vertices, std::vector<int3>& faces) const {
+        std::vector<int> index(pos.size(), -1);
+        vertices.clear();
+        for (size_t v = 0; v < pos.size(); v++) {
+            if (vert_alive[v] && !vert_tris[v].empty()) {
+                index[v] = (int)vertices.size();
+                vertices.push_back(make_float3(pos[v][0], pos[v][1], pos[v][2]));
+            }
+        }
+        faces.clear();
+        for (size_t f = 0; f < tri.size(); f++) {
+            if (tri_alive[f]) {
+                faces.push_back(make_int3(index[tri[f][0]], index[tri[f][1]], index[tri[f][2]]));
+            }
+        }
+    }
+
+    std::vector<unsigned int> Neighbors(unsigned int v) const {
+        std::vector<unsigned int> n;
+        for (unsigned int f : vert_tris[v]) {
+            for (unsigned int w : tri[f]) {
+                if (w != v) {
+                    n.push_back(w);
+                }
+            }
+        }
+        std::sort(n.begin(), n.end());
+        n.erase(std::unique(n.begin(), n.end()), n.end());
+        return n;
+    }
+
+    unsigned int FeatureDegree(unsigned int v) const {
+        unsigned int n = 0;
+        for (unsigned int w : Neighbors(v)) {
+            n += feature_edges.count(EdgeKey(v, w));
+        }
+        return n;
+    }
+
+    void Run() {
+        // Plane quadrics and feature edges of the input
+        quadric.assign(pos.size(), Quadric());
+        std::map<uint64_t, std::vector<unsigned int>> edge_tris;
+        for (unsigned int f = 0; f < tri.size(); f++) {
+            Vec n = Normal(tri[f]);
+            double len = std::sqrt(Dot(n, n));
+            if (len > 0.) {
+                n = {n[0] / len, n[1] / len, n[2] / len};
+                double d = -Dot(n, pos[tri[f][0]]);
+                for (unsigned int v : tri[f]) {
+                    quadric[v].AddPlane(n, d);
+                }
+            }
+            for (int k = 0; k < 3; k++) {
+                edge_tris[EdgeKey(tri[f][k], tri[f][(k + 1) % 3])].push_back(f);
+            }
+        }
+        feature_edges.clear();
+        for (const auto& e : edge_tris) {
+            bool feature = e.second.size() != 2;
+            if (!feature) {
+                Vec n0 = Normal(tri[e.second[0]]), n1 = Normal(tri[e.second[1]]);
+                double l = std::sqrt(Dot(n0, n0) * Dot(n1, n1));
+                feature = l > 0. && Dot(n0, n1) < feature_cos * l;
+            }
+            if (feature) {
+                feature_edges.insert(e.first);
+            }
+        }
+        version.assign(pos.size(), 0);
+
+        std::priority_queue<Candidate> queue;
+        for (const auto& e : edge_tris) {
+            Push(queue, (unsigned int)(e.first >> 32), (unsigned int)(e.first & 0xffffffffu));
+        }
+        while (!queue.empty()) {
+            Candidate c = queue.top();
+            queue.pop();
+            if (!vert_alive[c.u] || !vert_alive[c.v] || version[c.u] != c.ver_u || version[c.v] != c.ver_v) {
+                continue;
+            }
+            // Neighbors may have moved since it was queued; requeue if the collapse got more expensive
+            Candidate now;
+            if (!Evaluate(c.u, c.v, now)) {
+                continue;
+            }
+            if (now.cost > c.cost * (1. + 1e-9) + 1e-300) {
+                queue.push(now);
+                continue;
+            }
+            if (!CanCollapse(now.u, now.v, now.p)) {
+                continue;
+            }
+            Collapse(now.u, now.v, now.p);
+            for (unsigned int w : Neighbors(now.u)) {
+                Push(queue, now.u, w);
+            }
+        }
+    }
+
+    void Push(std::priority_queue<Candidate>& queue, unsigned int u, unsigned int v) {
+        Candidate c;
+        if (Evaluate(u, v, c)) {
+            queue.push(c);
+        }
+    }
+
+    // Where the collapse of edge (u, v) puts the merged vertex and what it costs; false if it may not be collapsed
+    bool Evaluate(unsigned int u, unsigned int v, Candidate& c) const {
+        Vec d = Sub(pos[u], pos[v]);
+        if (Dot(d, d) >= target_edge * target_edge) {
+            return false;
+        }
+        if (u > v) {
+            std::swap(u, v);
+        }
+        Quadric q = quadric[u];
+        q += quadric[v];
+
+        // Smooth vertices may go anywhere; a crease vertex only along its crease; corners stay put
+        unsigned int fu = FeatureDegree(u), fv = FeatureDegree(v);
+        bool corner_u = fu == 1 || fu > 2, corner_v = fv == 1 || fv > 2;
+        std::vector<Vec> choices;
+        if (fu == 0 && fv == 0) {
+            choices.push_back(VolumePreservingOptimum(u, v, q));
+        } else if (fu == 0) {
+            choices.push_back(pos[v]);
+        } else if (fv == 0) {
+            choices.push_back(pos[u]);
+        } else {
+            if (!feature_edges.count(EdgeKey(u, v)) || (corner_u && corner_v)) {
+                return false;
+            }
+            if (!corner_v) {
+                choices.push_back(pos[u]);
+            }
+            if (!corner_u) {
+                choices.push_back(pos[v]);
+            }
+        }
+        c.cost = -1.;
+        for (const Vec& p : choices) {
+            double cost = std::max(0., q.Eval(p));
+            if (c.cost < 0. || cost < c.cost) {
+                c.cost = cost;
+                c.p = p;
+            }
+        }
+        // The quadric sums squared distances to all merged planes, so this bounds the distance to each of them
+        if (c.cost > max_error * max_error) {
+            return false;
+        }
+        c.u = u;
+        c.v = v;
+        c.ver_u = version[u];
+        c.ver_v = version[v];
+        return true;
+    }
+
+    // Minimize the quadric under the constraint that the volume enclosed by the faces around u and v does not change.
+    // A small pull towards the midpoint keeps the system regular where the quadric is flat (e.g. planar regions).
+    Vec VolumePreservingOptimum(unsigned int u, unsigned int v, const Quadric& q) const {
+        Vec mid = {(pos[u][0] + pos[v][0]) / 2., (pos[u][1] + pos[v][1]) / 2., (pos[u][2] + pos[v][2]) / 2.};
+        // Volume after the collapse is p.G / 6 plus the terms that do not involve p; it must equal the volume before
+        Vec G = {0., 0., 0.};
+        double h = 0.;
+        std::vector<unsigned int> around = vert_tris[u];
+        around.insert(around.end(), vert_tris[v].begin(), vert_tris[v].end());
+        std::sort(around.begin(), around.end());
+        around.erase(std::unique(around.begin(), around.end()), around.end());
+        for (unsigned int f : around) {
+            const auto& t = tri[f];
+            h += Dot(pos[t[0]], Cross(pos[t[1]], pos[t[2]]));
+            int k = -1, moving = 0;
+            for (int i = 0; i < 3; i++) {
+                if (t[i] == u || t[i] == v) {
+                    k = i;
+                    moving++;
+                }
+            }
+            if (moving == 2) {
+                continue;  // Vanishes
+            }
+            Vec g = Cross(pos[t[(k + 1) % 3]], pos[t[(k + 2) % 3]]);
+            for (int i = 0; i < 3; i++) {
+                G[i] += g[i];
+            }
+        }
+
+        double eps = 1e-6 * (q.A[0] + q.A[3] + q.A[5]) + 1e-12;
+        double M[4][5] = {{q.A[0] + eps, q.A[1], q.A[2], G[0] / 2., q.b[0] + eps * mid[0]},
+                          {q.A[1], q.A[3] + eps, q.A[4], G[1] / 2., q.b[1] + eps * mid[1]},
+                          {q.A[2], q.A[4], q.A[5] + eps, G[2] / 2., q.b[2] + eps * mid[2]},
+                          {G[0], G[1], G[2], 0., h}};
+        if (Dot(G, G) == 0.) {
+            M[3][3] = 1.;
+            M[3][4] = 0.;
+        }
+        // Gaussian elimination with partial pivoting
+        for (int col = 0; col < 4; col++) {
+            int piv = col;
+            for (int r = col + 1; r < 4; r++) {
+                if (std::abs(M[r][col]) > std::abs(M[piv][col])) {
+                    piv = r;
+                }
+            }
+            if (std::abs(M[piv][col]) < 1e-300) {
+                return mid;
+            }
+            std::swap(M[col], M[piv]);
+            for (int r = 0; r < 4; r++) {
+                if (r != col) {
+                    double f = M[r][col] / M[col][col];
+                    for (int k = col; k < 5; k++) {
+                        M[r][k] -= f * M[col][k];
+                    }
+                }
+            }
+        }
+        Vec p = {M[0][4] / M[0][0], M[1][4] / M[1][1], M[2][4] / M[2][2]};
+        // A badly conditioned solve can throw the vertex far away; the midpoint is then the safer choice
+        Vec off = Sub(p, mid);
+        if (!std::isfinite(p[0] + p[1] + p[2]) || Dot(off, off) > target_edge * target_edge) {
+            return mid;
+        }
+        return p;
+    }
+
+    // Link condition (the collapse keeps the mesh manifold) and no folded or degenerate triangle after it
+    bool CanCollapse(unsigned int u, unsigned int v, const Vec& p) const {
+        std::vector<unsigned int> nu = Neighbors(u), nv = Neighbors(v), common;
+        std::set_intersection(nu.begin(), nu.end(), nv.begin(), nv.end(), std::back_inserter(common));
+        unsigned int shared = 0;
+        for (unsigned int f : vert_tris[u]) {
+            const auto& t = tri[f];
+            shared += (t[0] == v || t[1] == v || t[2] == v);
+        }
+        if (common.size() != shared || shared == 0) {
+            return false;
+        }
+        for (unsigned int x : {u, v}) {
+            for (unsigned int f : vert_tris[x]) {
+                auto t = tri[f];
+                bool has_u = t[0] == u || t[1] == u || t[2] == u;
+                bool has_v = t[0] == v || t[1] == v || t[2] == v;
+                if (has_u && has_v) {
+                    continue;
+                }
+                Vec before = Normal(t);
+                for (int i = 0; i < 3; i++) {
+                    if (t[i] == x) {
+                        // Evaluate the moved triangle with p in place of x
+                        Vec a = (i == 0) ? p : pos[t[0]];
+                        Vec b = (i == 1) ? p : pos[t[1]];
+                        Vec c = (i == 2) ? p : pos[t[2]];
+                        Vec after = Cross(Sub(b, a), Sub(c, a));
+                        double la = Dot(after, after), lb = Dot(before, before);
+                        Vec e = Sub(b, a);
+                        if (la <= 1e-12 * Dot(e, e) * Dot(e, e) || Dot(after, before) <= 0.2 * std::sqrt(la * lb)) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    void Collapse(unsigned int u, unsigned int v, const Vec& p) {
+        // Carry v's feature edges over to u
+        for (unsigned int w : Neighbors(v)) {
+            if (feature_edges.erase(EdgeKey(v, w)) && w != u) {
+                feature_edges.insert(EdgeKey(u, w));
+            }
+        }
+        std::vector<unsigned int> around = vert_tris[v];
+        for (unsigned int f : around) {
+            auto& t = tri[f];
+            if (t[0] == u || t[1] == u || t[2] == u) {
+                tri_alive[f] = 0;
+                for (unsigned int w : t) {
+                    auto& list = vert_tris[w];
+                    list.erase(std::remove(list.begin(), list.end(), f), list.end());
+                }
+            } else {
+                for (auto& w : t) {
+                    if (w == v) {
+                        w = u;
+                    }
+                }
+                vert_tris[u].push_back(f);
+            }
+        }
+        std::sort(vert_tris[u].begin(), vert_tris[u].end());
+        vert_tris[v].clear();
+        vert_alive[v] = 0;
+        pos[u] = p;
+        quadric[u] += quadric[v];
+        version[u]++;
+        version[v]++;
+    }
+};
+
+#endif
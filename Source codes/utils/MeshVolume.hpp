@@ -0,0 +1,326 @@
+// =============================================================================
+// Inside/outside test for closed triangle meshes, for sampling particles inside
+// a container or trench given as a Wavefront OBJ.
+//
+// The mesh is loaded with the same loader AddWavefrontMeshObject uses. Its
+// bounding box is split into voxels, and every voxel not touched by a triangle
+// is classified once by ray parity from its center, so most queries are a
+// lookup. Points in voxels the surface passes through get an exact ray parity
+// test against the triangles of their xy column. Edge and vertex hits follow a
+// top-left rule on the projected triangles, so a ray through a shared edge is
+// counted once. Clearance from the surface (Inside with a margin) is measured
+// against the triangles a MeshBVH finds near the point.
+//
+// A MeshVolume is a clip predicate for LatticeGenerator (Clip(margin)), filters
+// the points of PDSampler/HCPSampler sampled over its bounding box (Keep), and
+// restricts a PolydisperseSampler to the mesh interior (SamplePolydisperse).
+// =============================================================================
+
+#ifndef DEME_DRIVERS_MESH_VOLUME_HPP
+#define DEME_DRIVERS_MESH_VOLUME_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MeshBVH.hpp"
+#include "PolydisperseSampler.hpp"
+
+using namespace deme;
+
+class MeshVolume {
+  public:
+    // voxel_size is the resolution of the lookup grid; a few particle diameters is a good choice
+    MeshVolume(const std::string& filename, float voxel_size, float scale = 1.f) {
+        DEMMeshConnected mesh;
+        if (!mesh.LoadWavefrontMesh(filename, false)) {
+            throw std::runtime_error("Failed to load mesh " + filename);
+        }
+        std::vector<float3> vertices = mesh.GetCoordsVertices();
+        for (auto& v : vertices) {
+            v *= scale;
+        }
+        Build(vertices, mesh.m_face_v_indices, voxel_size);
+    }
+
+    MeshVolume(const std::vector<float3>& vertices, const std::vector<int3>& faces, float voxel_size) {
+        Build(vertices, faces, voxel_size);
+    }
+
+    void SetNumThreads(unsigned int n) { num_threads = std::max(1u, n); }
+
+    float3 GetMin() const { return box_min; }
+    float3 GetMax() const { return box_max; }
+    float3 GetCenter() const { return (box_min + box_max) * 0.5f; }
+    float3 GetBoxHalfSize() const { return (box_max - box_min) * 0.5f; }
+    // Enclosed volume (divergence theorem; exact for a closed mesh of either orientation)
+    double GetVolume() const { return volume; }
+
+    bool Inside(const float3& p) const {
+        int ix, iy, iz;
+        if (!VoxelOf(p, ix, iy, iz)) {
+            return false;
+        }
+        uint8_t s = voxels[VoxelIndex(ix, iy, iz)];
+        return (s == BOUNDARY) ? RayParity(p, ColumnIndex(ix, iy)) : (s == INSIDE);
+    }
+
+    // Inside and at least margin away from the surface (so a sphere of radius margin fits)
+    bool Inside(const float3& p, float margin) const {
+        if (!Inside(p)) {
+            return false;
+        }
+        return margin <= 0.f || SurfaceFartherThan(p, margin);
+    }
+
+    // Clip predicate for LatticeGenerator and ClipAnd; the mesh must outlive it
+    auto Clip(float margin = 0.f) const {
+        return [this, margin](const float3& p) { return Inside(p, margin); };
+    }
+
+    // The points that lie inside, at least margin from the surface, in their original order
+    std::vector<float3> Keep(const std::vector<float3>& xyz, float margin = 0.f) const {
+        std::vector<uint8_t> keep(xyz.size());
+        ParallelFor(xyz.size(), [&](size_t i) { keep[i] = Inside(xyz[i], margin); });
+        std::vector<float3> out;
+        for (size_t i = 0; i < xyz.size(); i++) {
+            if (keep[i]) {
+                out.push_back(xyz[i]);
+            }
+        }
+        return out;
+    }
+
+    // Fill the mesh interior to solid_fraction (of the mesh volume) with the sampler's radius classes. Each sphere
+    // lies fully inside; the sampler's GetClassIds() gives the class of each returned position. Spheres pack loosely
+    // against the walls, so a container only a few tens of grains across jams well below the sampler's 0.38.
+    std::vector<float3> SamplePolydisperse(PolydisperseSampler& sampler, float solid_fraction) const {
+        float3 halfsize = GetBoxHalfSize();
+        double box_vol = 8. * halfsize.x * halfsize.y * halfsize.z;
+        sampler.SetRegion([this](const float3& p, float r) { return Inside(p, r); });
+        auto xyz = sampler.SampleBox(GetCenter(), halfsize, solid_fraction * volume / box_vol);
+        sampler.SetRegion(nullptr);
+        return xyz;
+    }
+
+  private:
+    enum : uint8_t { OUTSIDE = 0, INSIDE = 1, BOUNDARY = 2 };
+
+    std::vector<float3> verts;
+    std::vector<int3> tris;
+    float3 box_min, box_max;
+    float voxel;
+    int nx, ny, nz;
+    double volume = 0.;
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Triangles whose xy bounding box overlaps each column of voxels
+    std::vector<std::vector<unsigned int>> columns;
+    std::vector<uint8_t> voxels;
+    // For the distance to the surface
+    MeshBVH bvh;
+
+    size_t ColumnIndex(int ix, int iy) const { return (size_t)iy * nx + ix; }
+    size_t VoxelIndex(int ix, int iy, int iz) const { return ((size_t)iz * ny + iy) * nx + ix; }
+
+    bool VoxelOf(const float3& p, int& ix, int& iy, int& iz) const {
+        if (p.x < box_min.x || p.y < box_min.y || p.z < box_min.z || p.x > box_max.x || p.y > box_max.y ||
+            p.z > box_max.z) {
+            return false;
+        }
+        ix = std::min(nx - 1, (int)((p.x - box_min.x) / voxel));
+        iy = std::min(ny - 1, (int)((p.y - box_min.y) / voxel));
+        iz = std::min(nz - 1, (int)((p.z - box_min.z) / voxel));
+        return true;
+    }
+
+    template <typename F>
+    void ParallelFor(size_t n, F&& func) const {
+        std::vector<std::thread> threads;
+        size_t chunk = (n + num_threads - 1) / num_threads;
+        for (size_t begin = 0; begin < n; begin += chunk) {
+            size_t end = std::min(begin + chunk, n);
+            threads.emplace_back([&, begin, end]() {
+                for (size_t i = begin; i < end; i++) {
+                    func(i);
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+    }
+
+    void Build(const std::vector<float3>& vertices, const std::vector<int3>& faces, float voxel_size) {
+        if (vertices.empty() || faces.empty()) {
+            throw std::runtime_error("MeshVolume needs a non-empty triangle mesh");
+        }
+        verts = vertices;
+        tris = faces;
+        voxel = voxel_size;
+        bvh.Build(verts, tris);
+        box_min = box_max = verts[0];
+        for (const auto& v : verts) {
+            box_min = make_float3(std::min(box_min.x, v.x), std::min(box_min.y, v.y), std::min(box_min.z, v.z));
+            box_max = make_float3(std::max(box_max.x, v.x), std::max(box_max.y, v.y), std::max(box_max.z, v.z));
+        }
+        nx = std::max(1, (int)std::ceil((box_max.x - box_min.x) / voxel));
+        ny = std::max(1, (int)std::ceil((box_max.y - box_min.y) / voxel));
+        nz = std::max(1, (int)std::ceil((box_max.z - box_min.z) / voxel));
+
+        volume = 0.;
+        for (const auto& t : tris) {
+            const float3 &a = verts[t.x], &b = verts[t.y], &c = verts[t.z];
+            volume += ((double)a.x * (b.y * c.z - b.z * c.y) - (double)a.y * (b.x * c.z - b.z * c.x) +
+                       (double)a.z * (b.x * c.y - b.y * c.x)) /
+                      6.;
+        }
+        volume = std::abs(volume);
+
+        // Bin triangles into xy columns and mark the voxels their bounding boxes touch
+        columns.assign((size_t)nx * ny, {});
+        voxels.assign((size_t)nx * ny * nz, OUTSIDE);
+        for (unsigned int f = 0; f < tris.size(); f++) {
+            int lo[3], hi[3];
+            TriangleVoxelRange(f, lo, hi);
+            for (int iy = lo[1]; iy <= hi[1]; iy++) {
+                for (int ix = lo[0]; ix <= hi[0]; ix++) {
+                    columns[ColumnIndex(ix, iy)].push_back(f);
+                    for (int iz = lo[2]; iz <= hi[2]; iz++) {
+                        voxels[VoxelIndex(ix, iy, iz)] = BOUNDARY;
+                    }
+                }
+            }
+        }
+
+        // Classify the remaining voxels of each column from the surface crossings of a ray through their centers
+        ParallelFor(columns.size(), [&](size_t col) {
+            int ix = col % nx, iy = col / nx;
+            float x = box_min.x + (ix + 0.5f) * voxel, y = box_min.y + (iy + 0.5f) * voxel;
+            std::vector<double> crossings = Crossings(x, y, col);
+            std::sort(crossings.begin(), crossings.end());
+            size_t above = crossings.size();
+            size_t next = 0;
+            for (int iz = 0; iz < nz; iz++) {
+                double z = box_min.z + (iz + 0.5) * voxel;
+                while (next < crossings.size() && crossings[next] <= z) {
+                    next++;
+                    above--;
+                }
+                uint8_t& s = voxels[VoxelIndex(ix, iy, iz)];
+                if (s != BOUNDARY) {
+                    s = (above & 1) ? INSIDE : OUTSIDE;
+                }
+            }
+        });
+    }
+
+    // Voxel index range of a triangle's bounding box, widened a little against rounding
+    void TriangleVoxelRange(unsigned int f, int lo[3], int hi[3]) const {
+        const int3& t = tris[f];
+        const float3 &a = verts[t.x], &b = verts[t.y], &c = verts[t.z];
+        float eps = 1e-4f * voxel;
+        float tmin[3] = {std::min({a.x, b.x, c.x}), std::min({a.y, b.y, c.y}), std::min({a.z, b.z, c.z})};
+        float tmax[3] = {std::max({a.x, b.x, c.x}), std::max({a.y, b.y, c.y}), std::max({a.z, b.z, c.z})};
+        float origin[3] = {box_min.x, box_min.y, box_min.z};
+        int n[3] = {nx, ny, nz};
+        for (int d = 0; d < 3; d++) {
+            lo[d] = std::max(0, (int)std::floor((tmin[d] - eps - origin[d]) / voxel));
+            hi[d] = std::min(n[d] - 1, (int)std::floor((tmax[d] + eps - origin[d]) / voxel));
+        }
+    }
+
+    // Edge function of the projected edge (u, v) at (x, y), evaluated with the endpoints in index order so the two
+    // triangles sharing an edge get exactly opposite values
+    double EdgeFunction(int u, int v, double x, double y) const {
+        bool flip = u > v;
+        const float3& a = verts[flip ? v : u];
+        const float3& b = verts[flip ? u : v];
+        double e = ((double)b.x - a.x) * (y - a.y) - ((double)b.y - a.y) * (x - a.x);
+        return flip ? -e : e;
+    }
+
+    // Top-left rule: a point exactly on an edge belongs to the triangle for which the edge is a top or left edge
+    static bool OnOwnedEdge(double dx, double dy) { return (dy > 0.) || (dy == 0. && dx < 0.); }
+
+    // z of the intersection of the vertical line through (x, y) with triangle f, if it hits
+    bool VerticalHit(unsigned int f, double x, double y, double& z) const {
+        const int3& t = tris[f];
+        int idx[3] = {t.x, t.y, t.z};
+        double area = EdgeFunction(idx[0], idx[1], verts[idx[2]].x, verts[idx[2]].y);
+        if (area == 0.) {
+            return false;  // Vertical triangle, never crossed by a vertical ray
+        }
+        if (area < 0.) {
+            std::swap(idx[1], idx[2]);
+            area = -area;
+        }
+        double w[3];
+        for (int e = 0; e < 3; e++) {
+            int u = idx[(e + 1) % 3], v = idx[(e + 2) % 3];
+            w[e] = EdgeFunction(u, v, x, y);
+            if (w[e] < 0.) {
+                return false;
+            }
+            if (w[e] == 0. && !OnOwnedEdge((double)verts[v].x - verts[u].x, (double)verts[v].y - verts[u].y)) {
+                return false;
+            }
+        }
+        z = (w[0] * verts[idx[0]].z + w[1] * verts[idx[1]].z + w[2] * verts[idx[2]].z) / (w[0] + w[1] + w[2]);
+        return true;
+    }
+
+    std::vector<double> Crossings(double x, double y, size_t col) const {
+        std::vector<double> zs;
+        double z;
+        for (unsigned int f : columns[col]) {
+            if (VerticalHit(f, x, y, z)) {
+                zs.push_back(z);
+            }
+        }
+        return zs;
+    }
+
+    // Odd number of surface crossings above p
+    bool RayParity(const float3& p, size_t col) const {
+        unsigned int n = 0;
+        double z;
+        for (unsigned int f : columns[col]) {
+            if (VerticalHit(f, p.x, p.y, z) && z > p.z) {
+                n++;
+            }
+        }
+        return n & 1;
+    }
+
+    bool SurfaceFartherThan(const float3& p, float margin) const {
+        int ix = 0, iy = 0, iz = 0;
+        VoxelOf(p, ix, iy, iz);
+        int reach = (int)std::ceil(margin / voxel);
+        int x0 = std::max(0, ix - reach), x1 = std::min(nx - 1, ix + reach);
+        int y0 = std::max(0, iy - reach), y1 = std::min(ny - 1, iy + reach);
+        int z0 = std::max(0, iz - reach), z1 = std::min(nz - 1, iz + reach);
+        // No surface voxel nearby: nothing to measure
+        bool near_surface = false;
+        for (int jz = z0; jz <= z1 && !near_surface; jz++) {
+            for (int jy = y0; jy <= y1 && !near_surface; jy++) {
+                for (int jx = x0; jx <= x1 && !near_surface; jx++) {
+                    near_surface = voxels[VoxelIndex(jx, jy, jz)] == BOUNDARY;
+                }
+            }
+        }
+        if (!near_surface) {
+            return true;
+        }
+        return !bvh.AnyWithin(p, margin);
+    }
+};
+
+#endif
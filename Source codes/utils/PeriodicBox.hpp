@@ -0,0 +1,426 @@
+// =============================================================================
+// Periodic boundaries in x and/or y, emulated on the host with image particles.
+//
+// Particles that leave the period through one side are put back through the
+// other, and the number of periods each one crossed is kept, so unwrapped
+// positions stay continuous. Particles within a halo of the lower seam (x = lo
+// or y = lo) get an image beyond the upper one: a clump of the same template,
+// in a fixed family, placed at the particle's position shifted by the period.
+// Particles near the upper seam touch the image as they would touch the
+// particle, and the image's contact force is carried back to its particle.
+// Only one side of each seam has images, so a pair across it meets exactly
+// once. Near a corner, the diagonal images are taken from the same half of the
+// period lattice, (+x, +y) and (+x, -y), for the same reason.
+//
+// Images come from a pool of spare clumps that wait, out of contact, in a
+// parking family on a grid somewhere in the domain. The pool is sized per
+// template as a fraction of the particles; images that find no spare clump are
+// counted as missed in the stats. Images never touch walls, floors or tools
+// (IgnoreFamily): the particles themselves do.
+//
+// Images are placed between syncs. Advance updates them every sync interval,
+// and sooner if the velocities read at the last update show that a particle
+// could reach a seam or a halo edge before then (assuming its speed at most
+// doubles meanwhile), so a particle is wrapped and imaged as it crosses. The
+// force on the images is read every step and given to their particles in the
+// next one, so it lags one step. Images are at rest for the solver, so damping
+// across the seam acts on the particle's absolute velocity; torques across the
+// seam are not carried back.
+//
+// While there are images, every step is a separate solver call with a host
+// round trip, and each update reads back all positions and velocities. That
+// per-step latency is what periodic sides cost over side walls; ShowStats
+// reports the number of solver calls and updates.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_PERIODIC_BOX_HPP
+#define DEME_DRIVERS_PERIODIC_BOX_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace deme;
+
+class PeriodicBox {
+  public:
+    // ghost_family holds the images in use, park_family the spare ones; neither may be used by anything else
+    PeriodicBox(DEMSolver& sim, unsigned int ghost_family, unsigned int park_family)
+        : sim(sim), ghost_family(ghost_family), park_family(park_family) {}
+
+    void SetPeriodX(float lo, float hi) { SetPeriod(0, lo, hi); }
+    void SetPeriodY(float lo, float hi) { SetPeriod(1, lo, hi); }
+    // Particles closer than width to a seam get an image; the largest diameter plus the contact margin is enough
+    void SetHalo(float width) { halo = width; }
+    // Spare images wait on a square grid in the xy plane from origin; spacing should exceed the largest diameter
+    void SetParking(float3 origin, float spacing) {
+        park_origin = origin;
+        park_spacing = spacing;
+    }
+    // Time between image updates, and the solver's step size
+    void SetSyncInterval(double interval, double step_size) {
+        sync_interval = interval;
+        this->step_size = step_size;
+    }
+
+    // Particles in the periodic box: the batch from AddClumps, the templates it was given and the batch's family.
+    // pool_fraction of each template's particles are allocated as spare images; each periodic direction needs about
+    // halo / period of them, plus a few for the corner.
+    void AddParticles(std::shared_ptr<DEMClumpBatch> batch,
+                      const std::vector<std::shared_ptr<DEMClumpTemplate>>& types,
+                      float pool_fraction,
+                      unsigned int family = 0) {
+        if (ghost_batch) {
+            throw std::runtime_error("PeriodicBox particles must be added before Configure");
+        }
+        if (types.size() != batch->GetNumClumps()) {
+            throw std::runtime_error("PeriodicBox needs one template per clump of the batch");
+        }
+        Group g;
+        g.tracker = sim.Track(batch);
+        for (const auto& t : types) {
+            g.pool.push_back(PoolOf(t));
+            pools[g.pool.back()].demand += pool_fraction;
+        }
+        g.image.assign(types.size(), {0, 0});
+        groups.push_back(std::move(g));
+        AddFamily(real_families, family);
+    }
+    void AddParticles(std::shared_ptr<DEMClumpBatch> batch,
+                      std::shared_ptr<DEMClumpTemplate> type,
+                      float pool_fraction,
+                      unsigned int family = 0) {
+        AddParticles(batch, std::vector<std::shared_ptr<DEMClumpTemplate>>(batch->GetNumClumps(), type),
+                     pool_fraction, family);
+    }
+
+    // A family the images must not touch (walls, floors, tools)
+    void IgnoreFamily(unsigned int family) { AddFamily(ignored_families, family); }
+
+    // Add the image pool and set up the families; before sim.Initialize
+    void Configure() {
+        if (!periodic[0] && !periodic[1]) {
+            throw std::runtime_error("PeriodicBox needs SetPeriodX or SetPeriodY before Configure");
+        }
+        for (int a = 0; a < 2; a++) {
+            if (periodic[a] && period_hi[a] - period_lo[a] <= 2.f * halo) {
+                throw std::runtime_error("A periodic direction must be longer than twice the halo");
+            }
+        }
+        std::vector<std::shared_ptr<DEMClumpTemplate>> types;
+        for (size_t p = 0; p < pools.size(); p++) {
+            size_t n = std::max<size_t>(1, (size_t)std::ceil(pools[p].demand));
+            for (size_t k = 0; k < n; k++) {
+                pools[p].slots.push_back(types.size());
+                types.push_back(pools[p].type);
+            }
+        }
+        size_t num_slots = types.size();
+        park_cols = std::max<size_t>(1, (size_t)std::ceil(std::sqrt((double)num_slots)));
+        ghost_pos.resize(num_slots);
+        for (size_t s = 0; s < num_slots; s++) {
+            ghost_pos[s] = ParkPos(s);
+        }
+        ghost_family_of.assign(num_slots, park_family);
+        slot_group.assign(num_slots, 0);
+        slot_index.assign(num_slots, 0);
+        ghost_batch = sim.AddClumps(types, ghost_pos);
+        ghost_batch->SetFamily(park_family);
+        ghost_tracker = sim.Track(ghost_batch);
+
+        sim.SetFamilyFixed(ghost_family);
+        sim.SetFamilyFixed(park_family);
+        sim.DisableContactBetweenFamilies(ghost_family, ghost_family);
+        sim.DisableContactBetweenFamilies(park_family, park_family);
+        sim.DisableContactBetweenFamilies(ghost_family, park_family);
+        for (unsigned int f : real_families) {
+            sim.DisableContactBetweenFamilies(park_family, f);
+        }
+        for (unsigned int f : ignored_families) {
+            sim.DisableContactBetweenFamilies(ghost_family, f);
+            sim.DisableContactBetweenFamilies(park_family, f);
+        }
+    }
+
+    // Give each particle the contact acceleration its image took in the last step, for the next step; call between
+    // steps while the images stay where Update put them
+    void CarryImageForces() {
+        if (active.empty()) {
+            return;
+        }
+        std::vector<float3> acc = ghost_tracker->ContactAccelerations();
+        for (size_t s : active) {
+            groups[slot_group[s]].tracker->AddAcc(acc[s], slot_index[s]);
+        }
+    }
+
+    // Wrap the particles and place the images; must be called right after a sync. The last step's image forces are
+    // carried back first, while each image still belongs to its particle.
+    void Update() {
+        CarryImageForces();
+        for (size_t s : active) {
+            ghost_pos[s] = ParkPos(s);
+            ghost_family_of[s] = park_family;
+        }
+        active.clear();
+        for (Pool& p : pools) {
+            p.next = 0;
+        }
+
+        size_t num_wrapped = 0;
+        steps_to_crossing = std::numeric_limits<size_t>::max();
+        for (size_t gi = 0; gi < groups.size(); gi++) {
+            Group& g = groups[gi];
+            std::vector<float3> pos = g.tracker->Positions();
+            std::vector<float3> vel = g.tracker->Velocities();
+            for (size_t i = 0; i < pos.size(); i++) {
+                if (Wrap(pos[i], g.image[i])) {
+                    g.tracker->SetPos(pos[i], i);
+                    num_wrapped++;
+                }
+                steps_to_crossing = std::min(steps_to_crossing, StepsToCrossing(pos[i], vel[i]));
+                float3 shift[3];
+                int num_shifts = ImageShifts(pos[i], shift);
+                for (int k = 0; k < num_shifts; k++) {
+                    Pool& p = pools[g.pool[i]];
+                    if (p.next == p.slots.size()) {
+                        num_missed++;
+                        continue;
+                    }
+                    size_t s = p.slots[p.next++];
+                    ghost_pos[s] = pos[i] + shift[k];
+                    ghost_family_of[s] = ghost_family;
+                    slot_group[s] = gi;
+                    slot_index[s] = i;
+                    active.push_back(s);
+                }
+            }
+        }
+        ghost_tracker->SetPos(ghost_pos);
+        ghost_tracker->SetFamily(ghost_family_of);
+        for (size_t s : active) {
+            ghost_tracker->SetOriQ(groups[slot_group[s]].tracker->OriQ(slot_index[s]), s);
+        }
+        total_wrapped += num_wrapped;
+        max_active = std::max(max_active, active.size());
+        num_updates++;
+    }
+
+    // Run for duration, updating the images every sync interval or at the next predicted crossing, whichever comes
+    // first, and carrying their forces back every step
+    void Advance(double duration) {
+        size_t total = std::max<size_t>(1, (size_t)std::llround(duration / step_size));
+        size_t interval = std::max<size_t>(1, (size_t)std::llround(sync_interval / step_size));
+        for (size_t done = 0; done < total;) {
+            Update();
+            size_t steps = std::min(interval, total - done);
+            if (steps_to_crossing < steps) {
+                steps = std::max<size_t>(1, steps_to_crossing);
+                num_early_updates++;
+            }
+            if (active.empty()) {
+                // No image forces to carry back, so the interval is one call
+                sim.DoDynamicsThenSync(steps * step_size);
+                num_solver_calls++;
+            } else {
+                for (size_t j = 0; j < steps; j++) {
+                    if (j > 0) {
+                        CarryImageForces();
+                    }
+                    if (j + 1 < steps) {
+                        sim.DoDynamics(step_size);
+                    } else {
+                        sim.DoDynamicsThenSync(step_size);
+                    }
+                }
+                num_solver_calls += steps;
+            }
+            num_steps += steps;
+            done += steps;
+        }
+    }
+
+    // Positions of group gi with the periods crossed added back, so displacements carry across the seams
+    std::vector<float3> GetUnwrappedPositions(size_t gi) const {
+        const Group& g = groups.at(gi);
+        std::vector<float3> pos = g.tracker->Positions();
+        for (size_t i = 0; i < pos.size(); i++) {
+            pos[i].x += g.image[i][0] * Period(0);
+            pos[i].y += g.image[i][1] * Period(1);
+        }
+        return pos;
+    }
+
+    size_t GetNumImages() const { return active.size(); }
+    size_t GetNumMissed() const { return num_missed; }
+
+    void ShowStats() const {
+        std::cout << "Periodic images: " << active.size() << " in use, at most " << max_active << " of "
+                  << ghost_pos.size() << std::endl;
+        std::cout << "Images missed for lack of spares: " << num_missed << std::endl;
+        std::cout << "Particles wrapped across a seam: " << total_wrapped << std::endl;
+        std::cout << "Image updates: " << num_updates << ", " << num_early_updates
+                  << " of them brought forward by a predicted crossing" << std::endl;
+        std::cout << "Solver calls: " << num_solver_calls << " for " << num_steps << " steps" << std::endl;
+    }
+
+  private:
+    struct Group {
+        std::shared_ptr<DEMTracker> tracker;
+        // Pool of each particle's template, and the periods it crossed in x and y
+        std::vector<size_t> pool;
+        std::vector<std::array<int, 2>> image;
+    };
+    struct Pool {
+        std::shared_ptr<DEMClumpTemplate> type;
+        float demand = 0.f;
+        // Image slots of this template, and the first one not yet used in this update
+        std::vector<size_t> slots;
+        size_t next = 0;
+    };
+
+    DEMSolver& sim;
+    unsigned int ghost_family, park_family;
+    bool periodic[2] = {false, false};
+    float period_lo[2] = {0.f, 0.f}, period_hi[2] = {0.f, 0.f};
+    float halo = 0.f;
+    float3 park_origin = make_float3(0);
+    float park_spacing = 1.f;
+    size_t park_cols = 1;
+    double sync_interval = 1e-4, step_size = 1e-5;
+
+    std::vector<Group> groups;
+    std::vector<Pool> pools;
+    std::vector<unsigned int> real_families, ignored_families;
+
+    std::shared_ptr<DEMClumpBatch> ghost_batch;
+    std::shared_ptr<DEMTracker> ghost_tracker;
+    // Per image slot
+    std::vector<float3> ghost_pos;
+    std::vector<unsigned int> ghost_family_of;
+    std::vector<size_t> slot_group, slot_index;
+    // Slots in use since the last update
+    std::vector<size_t> active;
+
+    // Steps before any particle could reach a seam or a halo edge, from the last update
+    size_t steps_to_crossing = std::numeric_limits<size_t>::max();
+
+    size_t num_missed = 0, total_wrapped = 0, max_active = 0;
+    size_t num_updates = 0, num_early_updates = 0, num_solver_calls = 0, num_steps = 0;
+
+    static void AddFamily(std::vector<unsigned int>& families, unsigned int f) {
+        if (std::find(families.begin(), families.end(), f) == families.end()) {
+            families.push_back(f);
+        }
+    }
+
+    void SetPeriod(int axis, float lo, float hi) {
+        if (!(hi > lo)) {
+            throw std::runtime_error("A periodic direction needs hi > lo");
+        }
+        periodic[axis] = true;
+        period_lo[axis] = lo;
+        period_hi[axis] = hi;
+    }
+
+    float Period(int axis) const { return periodic[axis] ? period_hi[axis] - period_lo[axis] : 0.f; }
+
+    size_t PoolOf(const std::shared_ptr<DEMClumpTemplate>& type) {
+        for (size_t p = 0; p < pools.size(); p++) {
+            if (pools[p].type == type) {
+                return p;
+            }
+        }
+        Pool p;
+        p.type = type;
+        pools.push_back(p);
+        return pools.size() - 1;
+    }
+
+    float3 ParkPos(size_t s) const {
+        return park_origin + make_float3((s % park_cols) * park_spacing, (s / park_cols) * park_spacing, 0);
+    }
+
+    // Bring p back into the period, counting the periods crossed; returns whether it moved
+    bool Wrap(float3& p, std::array<int, 2>& image) const {
+        bool moved = false;
+        float* c[2] = {&p.x, &p.y};
+        for (int a = 0; a < 2; a++) {
+            if (!periodic[a]) {
+                continue;
+            }
+            float L = Period(a);
+            while (*c[a] < period_lo[a]) {
+                *c[a] += L;
+                image[a]--;
+                moved = true;
+            }
+            while (*c[a] >= period_hi[a]) {
+                *c[a] -= L;
+                image[a]++;
+                moved = true;
+            }
+        }
+        return moved;
+    }
+
+    // Steps before p, moving at v, could reach a seam or a halo edge of a periodic direction, if its speed along it
+    // at most doubles meanwhile
+    size_t StepsToCrossing(const float3& p, const float3& v) const {
+        double steps = std::numeric_limits<double>::max();
+        float c[2] = {p.x, p.y}, u[2] = {v.x, v.y};
+        for (int a = 0; a < 2; a++) {
+            if (!periodic[a] || u[a] == 0.f) {
+                continue;
+            }
+            float edges[4] = {period_lo[a], period_lo[a] + halo, period_hi[a] - halo, period_hi[a]};
+            float dist = (u[a] > 0.f) ? period_hi[a] - c[a] : c[a] - period_lo[a];
+            for (float e : edges) {
+                if (u[a] > 0.f && e > c[a]) {
+                    dist = std::min(dist, e - c[a]);
+                } else if (u[a] < 0.f && e < c[a]) {
+                    dist = std::min(dist, c[a] - e);
+                }
+            }
+            steps = std::min(steps, dist / (2. * std::abs(u[a]) * step_size));
+        }
+        return (size_t)std::min(steps, 1e15);
+    }
+
+    // Shifts from p to its images. Only shifts with +x, or with no x and +y, are used: a pair across the seams is
+    // one such shift apart one way or the other, so it meets through exactly one image.
+    int ImageShifts(const float3& p, float3 shift[3]) const {
+        bool near_lo[2] = {false, false}, near_hi[2] = {false, false};
+        float c[2] = {p.x, p.y};
+        for (int a = 0; a < 2; a++) {
+            if (periodic[a]) {
+                near_lo[a] = c[a] < period_lo[a] + halo;
+                near_hi[a] = c[a] > period_hi[a] - halo;
+            }
+        }
+        float Lx = Period(0), Ly = Period(1);
+        int n = 0;
+        if (near_lo[0]) {
+            shift[n++] = make_float3(Lx, 0, 0);
+            if (near_lo[1]) {
+                shift[n++] = make_float3(Lx, Ly, 0);
+            } else if (near_hi[1]) {
+                shift[n++] = make_float3(Lx, -Ly, 0);
+            }
+        }
+        if (near_lo[1]) {
+            shift[n++] = make_float3(0, Ly, 0);
+        }
+        return n;
+    }
+};
+
+#endif
@@ -0,0 +1,261 @@
+// =============================================================================
+// Polydisperse Poisson-disk sampler.
+//
+// PDSampler/HCPSampler space points for the largest diameter, so a polydisperse
+// bed starts out loose and takes long to settle. This sampler places spheres of
+// their actual radii (drawn from a set of radius classes) by dart throwing on a
+// uniform grid of cell size 2 * r_max, until a target solid fraction is met or
+// no more spheres fit.
+//
+// Cells are processed in 8 colors (parity of the cell index in x, y and z).
+// Two cells of the same color are at least one cell apart, so spheres placed in
+// them cannot overlap and a whole color is processed in parallel. Each cell
+// draws from its own counter-based stream keyed by (seed, case, cell, pass),
+// and radii are handed to cells in a fixed order, so the result does not depend
+// on the thread count.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_POLYDISPERSE_SAMPLER_HPP
+#define DEME_DRIVERS_POLYDISPERSE_SAMPLER_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "CounterRNG.hpp"
+
+using namespace deme;
+
+class PolydisperseSampler {
+  public:
+    // Radius classes and their number fractions (normalized internally)
+    PolydisperseSampler(const std::vector<float>& class_radii, const std::vector<float>& number_weights)
+        : class_radii(class_radii), number_weights(number_weights) {
+        if (class_radii.empty() || class_radii.size() != number_weights.size()) {
+            throw std::runtime_error("PolydisperseSampler needs one weight per radius class");
+        }
+        r_max = *std::max_element(class_radii.begin(), class_radii.end());
+    }
+
+    void SetSeed(uint64_t seed, uint64_t case_id = 0) {
+        this->seed = seed;
+        this->case_id = case_id;
+    }
+    void SetNumThreads(unsigned int n) { num_threads = std::max(1u, n); }
+    // Darts thrown per sphere and pass before it is deferred to the next pass
+    void SetAttemptsPerSphere(unsigned int n) { attempts = n; }
+    void SetMaxPasses(unsigned int n) { max_passes = n; }
+    // Minimum gap between surfaces, as a fraction of the smaller radius
+    void SetGapRatio(float gap) { gap_ratio = gap; }
+    // Further restrict where a sphere of radius r may be centered (e.g. inside a mesh); nullptr for the whole box
+    void SetRegion(std::function<bool(const float3&, float)> accept) { region = std::move(accept); }
+
+    // Sample the box [center - halfsize, center + halfsize] up to the requested solid fraction. Each sphere lies fully
+    // inside the box. Random sequential placement jams at a solid fraction of about 0.38 (less with few attempts), so
+    // higher targets fall short. Returns positions; GetClassIds() gives the radius class of each one.
+    std::vector<float3> SampleBox(float3 center, float3 halfsize, float solid_fraction) {
+        box_min = center - halfsize;
+        box_max = center + halfsize;
+        float box_vol = 8. * halfsize.x * halfsize.y * halfsize.z;
+        std::vector<unsigned int> pending = DrawClasses(solid_fraction * box_vol);
+
+        cell_size = 2.f * r_max * (1.f + gap_ratio);
+        nx = std::max(1, (int)std::ceil(2.f * halfsize.x / cell_size));
+        ny = std::max(1, (int)std::ceil(2.f * halfsize.y / cell_size));
+        nz = std::max(1, (int)std::ceil(2.f * halfsize.z / cell_size));
+        cells.assign((size_t)nx * ny * nz, {});
+        cell_fail_radius.assign(cells.size(), 2.f * r_max);
+
+        for (unsigned int pass = 0; pass < max_passes && !pending.empty(); pass++) {
+            size_t placed_before = NumPlaced();
+            for (int color = 0; color < 8 && !pending.empty(); color++) {
+                pending = RunColor(pass, color, pending);
+            }
+            if (NumPlaced() == placed_before) {
+                break;
+            }
+        }
+
+        std::vector<float3> xyz;
+        ids.clear();
+        placed_volume = 0.;
+        for (const auto& c : cells) {
+            for (const auto& s : c) {
+                xyz.push_back(s.pos);
+                ids.push_back(s.cls);
+                placed_volume += 4. / 3. * PI * std::pow(class_radii[s.cls], 3);
+            }
+        }
+        achieved_fraction = placed_volume / box_vol;
+        if (achieved_fraction < 0.99 * solid_fraction) {
+            std::cout << "PolydisperseSampler: the box only took a solid fraction of " << achieved_fraction
+                      << " (asked for " << solid_fraction << ")" << std::endl;
+        }
+        return xyz;
+    }
+
+    const std::vector<unsigned int>& GetClassIds() const { return ids; }
+    double GetAchievedSolidFraction() const { return achieved_fraction; }
+
+  private:
+    struct Sphere {
+        float3 pos;
+        unsigned int cls;
+    };
+
+    std::vector<float> class_radii;
+    std::vector<float> number_weights;
+    float r_max;
+    uint64_t seed = 0;
+    uint64_t case_id = 0;
+    unsigned int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    unsigned int attempts = 30;
+    unsigned int max_passes = 20;
+    float gap_ratio = 0.005;
+    std::function<bool(const float3&, float)> region;
+
+    float3 box_min, box_max;
+    float cell_size;
+    int nx, ny, nz;
+    std::vector<std::vector<Sphere>> cells;
+    // Smallest radius that could not be placed in a cell; anything at least as large is not tried there again
+    std::vector<float> cell_fail_radius;
+    std::vector<unsigned int> ids;
+    double placed_volume = 0.;
+    double achieved_fraction = 0.;
+
+    // Classes of the spheres to place, enough to fill target_volume, largest first
+    std::vector<unsigned int> DrawClasses(double target_volume) {
+        CounterRNG rng(seed, case_id);
+        std::vector<unsigned int> cls;
+        double vol = 0.;
+        while (vol < target_volume) {
+            unsigned int c = rng.Stream(cls.size()).Discrete(number_weights);
+            cls.push_back(c);
+            vol += 4. / 3. * PI * std::pow(class_radii[c], 3);
+        }
+        std::stable_sort(cls.begin(), cls.end(),
+                         [&](unsigned int a, unsigned int b) { return class_radii[a] > class_radii[b]; });
+        return cls;
+    }
+
+    size_t NumPlaced() const {
+        size_t n = 0;
+        for (const auto& c : cells) {
+            n += c.size();
+        }
+        return n;
+    }
+
+    size_t CellIndex(int ix, int iy, int iz) const { return ((size_t)iz * ny + iy) * nx + ix; }
+
+    bool Fits(const float3& p, float r, int ix, int iy, int iz) const {
+        for (int dz = -1; dz <= 1; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    int jx = ix + dx, jy = iy + dy, jz = iz + dz;
+                    if (jx < 0 || jy < 0 || jz < 0 || jx >= nx || jy >= ny || jz >= nz) {
+                        continue;
+                    }
+                    for (const auto& s : cells[CellIndex(jx, jy, jz)]) {
+                        float rs = class_radii[s.cls];
+                        float min_dist = (r + rs) + gap_ratio * std::min(r, rs);
+                        float3 d = p - s.pos;
+                        if (dot(d, d) < min_dist * min_dist) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Hand the pending spheres round-robin to the cells of one color, place them in parallel, and return the ones
+    // that did not fit, in a deterministic order
+    std::vector<unsigned int> RunColor(unsigned int pass, int color, const std::vector<unsigned int>& pending) {
+        std::vector<size_t> color_cells;
+        for (int iz = (color >> 2) & 1; iz < nz; iz += 2) {
+            for (int iy = (color >> 1) & 1; iy < ny; iy += 2) {
+                for (int ix = color & 1; ix < nx; ix += 2) {
+                    color_cells.push_back(CellIndex(ix, iy, iz));
+                }
+            }
+        }
+        // Cells that cannot take even the smallest pending sphere are done
+        float r_min_pending = class_radii[pending.back()];
+        color_cells.erase(std::remove_if(color_cells.begin(), color_cells.end(),
+                                         [&](size_t c) { return cell_fail_radius[c] <= r_min_pending; }),
+                          color_cells.end());
+        if (color_cells.empty()) {
+            return pending;
+        }
+        // A cell can hold a handful of spheres; hand out a bounded batch so the large ones go first everywhere
+        size_t batch = std::min(pending.size(), color_cells.size() * 8);
+        std::vector<std::vector<unsigned int>> failed(color_cells.size());
+
+        CounterRNG rng(seed, case_id);
+        auto work = [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++) {
+                size_t cell = color_cells[k];
+                int ix = cell % nx, iy = (cell / nx) % ny, iz = cell / ((size_t)nx * ny);
+                RandomStream gen = rng.Stream(cell, 1 + pass);
+                float3 lo = box_min + make_float3(ix, iy, iz) * cell_size;
+                for (size_t i = k; i < batch; i += color_cells.size()) {
+                    unsigned int cls = pending[i];
+                    float r = class_radii[cls];
+                    // Region where this sphere's center may land: the cell, clipped to the shrunk box
+                    float3 a = make_float3(std::max(lo.x, box_min.x + r), std::max(lo.y, box_min.y + r),
+                                           std::max(lo.z, box_min.z + r));
+                    float3 b = make_float3(std::min(lo.x + cell_size, box_max.x - r),
+                                           std::min(lo.y + cell_size, box_max.y - r),
+                                           std::min(lo.z + cell_size, box_max.z - r));
+                    bool ok = false;
+                    if (r < cell_fail_radius[cell] && a.x <= b.x && a.y <= b.y && a.z <= b.z) {
+                        for (unsigned int t = 0; t < attempts && !ok; t++) {
+                            float3 p = make_float3(a.x + gen.Uniform() * (b.x - a.x), a.y + gen.Uniform() * (b.y - a.y),
+                                                   a.z + gen.Uniform() * (b.z - a.z));
+                            if (Fits(p, r, ix, iy, iz) && (!region || region(p, r))) {
+                                cells[cell].push_back({p, cls});
+                                ok = true;
+                            }
+                        }
+                    }
+                    if (!ok) {
+                        failed[k].push_back(cls);
+                        cell_fail_radius[cell] = std::min(cell_fail_radius[cell], r);
+                    }
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        size_t chunk = (color_cells.size() + num_threads - 1) / num_threads;
+        for (size_t begin = 0; begin < color_cells.size(); begin += chunk) {
+            threads.emplace_back(work, begin, std::min(begin + chunk, color_cells.size()));
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+
+        std::vector<unsigned int> remaining;
+        for (const auto& f : failed) {
+            remaining.insert(remaining.end(), f.begin(), f.end());
+        }
+        remaining.insert(remaining.end(), pending.begin() + batch, pending.end());
+        std::stable_sort(remaining.begin(), remaining.end(),
+                         [&](unsigned int a, unsigned int b) { return class_radii[a] > class_radii[b]; });
+        return remaining;
+    }
+};
+
+#endif
@@ -0,0 +1,199 @@
+// =============================================================================
+// Exact-size primitive meshes with exact mass properties.
+//
+// Boxes, cone frusta (a cone tip when one radius is zero) and capped cylinders
+// are generated directly at their final dimensions, so no non-uniform Scale is
+// applied afterwards and no MOI has to be patched by hand. The number of
+// segments around the axis is chosen from a surface tolerance, normally a
+// fraction of the particle radius, so the faceting error is the same for any
+// tool size and the triangle count is no larger than that accuracy needs.
+//
+// Volume, centroid and inertia are integrated over the generated polyhedron
+// (signed tetrahedra from the origin), so they describe exactly the surface
+// the particles collide with; for a box that is m (b^2 + c^2) / 12 about each
+// axis. The shapes are symmetric about their axes, so the mesh axes are
+// principal. AddPrimitiveMesh writes the OBJ, loads it and sets mass, MOI and
+// the centroid; the returned mesh takes families and trackers like any other.
+//
+// These are triangle meshes, not analytic primitives: contact with them is
+// sphere-triangle as for any OBJ, and the cost follows the triangle count
+// (cone_mesh_benchmark.cpp compares it with the stock meshes).
+// =============================================================================
+
+#ifndef DEME_DRIVERS_PRIMITIVE_MESH_HPP
+#define DEME_DRIVERS_PRIMITIVE_MESH_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace deme;
+
+struct PrimitiveMesh {
+    std::vector<float3> vertices;
+    // 0-based, counter-clockwise seen from outside
+    std::vector<int3> faces;
+    // Per unit density, MOI about the centroid along the mesh axes
+    double volume = 0.;
+    float3 centroid = make_float3(0);
+    float3 MOI = make_float3(0);
+    // Largest distance between the facets and the ideal curved surface
+    double max_deviation = 0.;
+
+    size_t GetNumTriangles() const { return faces.size(); }
+
+    void WriteObj(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file) {
+            throw std::runtime_error("Cannot write mesh file " + filename);
+        }
+        file.precision(9);
+        for (const auto& v : vertices) {
+            file << "v " << v.x << " " << v.y << " " << v.z << "\n";
+        }
+        for (const auto& f : faces) {
+            file << "f " << f.x + 1 << " " << f.y + 1 << " " << f.z + 1 << "\n";
+        }
+    }
+};
+
+// Integrate volume, centroid and inertia over a closed, outward-oriented triangle mesh
+inline void ComputePrimitiveMassProperties(PrimitiveMesh& mesh) {
+    double vol = 0., first[3] = {0., 0., 0.}, second[3][3] = {{0., 0., 0.}, {0., 0., 0.}, {0., 0., 0.}};
+    for (const auto& f : mesh.faces) {
+        const float3 t[3] = {mesh.vertices[f.x], mesh.vertices[f.y], mesh.vertices[f.z]};
+        double v[3][3], s[3];
+        for (int k = 0; k < 3; k++) {
+            v[k][0] = t[k].x;
+            v[k][1] = t[k].y;
+            v[k][2] = t[k].z;
+        }
+        double det = v[0][0] * (v[1][1] * v[2][2] - v[1][2] * v[2][1]) -
+                     v[0][1] * (v[1][0] * v[2][2] - v[1][2] * v[2][0]) +
+                     v[0][2] * (v[1][0] * v[2][1] - v[1][1] * v[2][0]);
+        vol += det / 6.;
+        for (int i = 0; i < 3; i++) {
+            s[i] = v[0][i] + v[1][i] + v[2][i];
+            first[i] += det / 24. * s[i];
+        }
+        // Tetrahedron (0, a, b, c): integral of x x^T is det / 120 * (sum of v v^T + s s^T)
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                double vv = v[0][i] * v[0][j] + v[1][i] * v[1][j] + v[2][i] * v[2][j];
+                second[i][j] += det / 120. * (vv + s[i] * s[j]);
+            }
+        }
+    }
+    if (vol <= 0.) {
+        throw std::runtime_error("Primitive mesh is not closed or not oriented outward");
+    }
+    double c[3] = {first[0] / vol, first[1] / vol, first[2] / vol};
+    double cov[3];
+    for (int i = 0; i < 3; i++) {
+        cov[i] = second[i][i] - vol * c[i] * c[i];
+    }
+    mesh.volume = vol;
+    mesh.centroid = make_float3(c[0], c[1], c[2]);
+    mesh.MOI = make_float3(cov[1] + cov[2], cov[0] + cov[2], cov[0] + cov[1]);
+}
+
+// Segments around a circle of this radius so that the chords stay within max_deviation of it
+inline int SegmentsForDeviation(double radius, double max_deviation, int min_segments = 8) {
+    if (radius <= 0. || max_deviation >= radius) {
+        return min_segments;
+    }
+    int n = (int)std::ceil(PI / std::acos(1. - max_deviation / radius));
+    return std::max(n, min_segments);
+}
+
+// Frustum along +z with radius r_bottom at z = 0 and r_top at z = height. A zero radius gives a cone with its tip
+// at that end; e.g. (0, r, h) is a tip pointing down with its apex at the origin.
+inline PrimitiveMesh MakeConeFrustum(double r_bottom, double r_top, double height, int segments) {
+    if (segments < 3 || height <= 0. || r_bottom < 0. || r_top < 0. || (r_bottom == 0. && r_top == 0.)) {
+        throw std::runtime_error("Invalid cone frustum dimensions");
+    }
+    PrimitiveMesh mesh;
+    // Each end is either a single apex or a ring plus a cap center
+    auto add_end = [&](double r, double z) {
+        int first = (int)mesh.vertices.size();
+        if (r == 0.) {
+            mesh.vertices.push_back(make_float3(0, 0, z));
+            return first;
+        }
+        for (int i = 0; i < segments; i++) {
+            double a = 2. * PI * i / segments;
+            mesh.vertices.push_back(make_float3(r * std::cos(a), r * std::sin(a), z));
+        }
+        mesh.vertices.push_back(make_float3(0, 0, z));
+        return first;
+    };
+    int bottom = add_end(r_bottom, 0.);
+    int top = add_end(r_top, height);
+    auto ring = [&](int end, double r, int i) { return (r == 0.) ? end : end + (i % segments); };
+
+    for (int i = 0; i < segments; i++) {
+        int b0 = ring(bottom, r_bottom, i), b1 = ring(bottom, r_bottom, i + 1);
+        int t0 = ring(top, r_top, i), t1 = ring(top, r_top, i + 1);
+        if (r_bottom > 0.) {
+            mesh.faces.push_back(make_int3(b0, b1, t0));
+            mesh.faces.push_back(make_int3(bottom + segments, b1, b0));
+        }
+        if (r_top > 0.) {
+            mesh.faces.push_back(make_int3(b1, t1, t0));
+            mesh.faces.push_back(make_int3(top + segments, t0, t1));
+        }
+    }
+    ComputePrimitiveMassProperties(mesh);
+    double r_max = std::max(r_bottom, r_top);
+    mesh.max_deviation = r_max * (1. - std::cos(PI / segments));
+    return mesh;
+}
+
+// Closed cylinder along +z, from z = 0 to z = height
+inline PrimitiveMesh MakeCappedCylinder(double radius, double height, int segments) {
+    return MakeConeFrustum(radius, radius, height, segments);
+}
+
+// Box of the given edge lengths centered at the origin, 12 triangles
+inline PrimitiveMesh MakeBox(float3 size) {
+    if (size.x <= 0.f || size.y <= 0.f || size.z <= 0.f) {
+        throw std::runtime_error("Invalid box dimensions");
+    }
+    PrimitiveMesh mesh;
+    // Vertex i has its x, y, z on the positive side for bits 0, 1, 2 of i
+    for (int i = 0; i < 8; i++) {
+        mesh.vertices.push_back(make_float3((i & 1) ? size.x / 2 : -size.x / 2, (i & 2) ? size.y / 2 : -size.y / 2,
+                                            (i & 4) ? size.z / 2 : -size.z / 2));
+    }
+    const int quads[6][4] = {{0, 4, 6, 2}, {1, 3, 7, 5}, {0, 1, 5, 4}, {2, 6, 7, 3}, {0, 2, 3, 1}, {4, 5, 7, 6}};
+    for (const auto& q : quads) {
+        mesh.faces.push_back(make_int3(q[0], q[1], q[2]));
+        mesh.faces.push_back(make_int3(q[0], q[2], q[3]));
+    }
+    ComputePrimitiveMassProperties(mesh);
+    return mesh;
+}
+
+// Write the primitive to filename, load it as a mesh object of the given density and inform DEME of its centroid
+// and principal axes. Positions given to the mesh or its tracker afterwards refer to the centroid.
+inline std::shared_ptr<DEMMeshConnected> AddPrimitiveMesh(DEMSolver& sim,
+                                                           const PrimitiveMesh& mesh,
+                                                           const std::string& filename,
+                                                           std::shared_ptr<DEMMaterial> mat,
+                                                           double density) {
+    mesh.WriteObj(filename);
+    auto obj = sim.AddWavefrontMeshObject(filename, mat);
+    obj->SetMass(density * mesh.volume);
+    obj->SetMOI(mesh.MOI * (float)density);
+    obj->InformCentroidPrincipal(mesh.centroid, make_float4(0, 0, 0, 1));
+    return obj;
+}
+
+#endif
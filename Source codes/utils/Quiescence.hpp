@@ -0,0 +1,318 @@
+// =============================================================================
+// Quiescence-based sleeping for the settling phases of our drivers.
+//
+// Particles whose speed and contact-acceleration change stay below thresholds
+// for a number of consecutive checks are moved into a fixed `sleep' family: the
+// solver stops integrating them, and contacts between two sleepers are disabled
+// so they drop out of contact detection altogether. Sleepers are woken when an
+// awake neighbor moving faster than the wake speed comes close, when a watched
+// external object (the drop cube, the CPT cone) moves near them, or when their
+// own contact load changes: a sleeper still feels its awake neighbors and the
+// walls, so a load passed down through the bed wakes it layer by layer.
+//
+// Checks happen on the host between DoDynamicsThenSync calls, so call Update()
+// once per output frame or so; it is cheap compared to a frame of dynamics.
+// A sleeper is rigid until the next check, so leave sleeping off in runs whose
+// output is a wall force under an impact.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_QUIESCENCE_HPP
+#define DEME_DRIVERS_QUIESCENCE_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+using namespace deme;
+
+class QuiescenceManager {
+  public:
+    // sleep_family must not be used by anything else in the driver
+    QuiescenceManager(DEMSolver& sim, unsigned int sleep_family) : DEMSim(sim), sleep_family(sleep_family) {}
+
+    // Thresholds: a particle is a sleep candidate if |v| < sleep_vel and its contact acceleration changed by less
+    // than sleep_acc_change since the last check. It sleeps after quiet_checks such checks in a row.
+    void SetSleepThresholds(float sleep_vel, float sleep_acc_change, unsigned int quiet_checks) {
+        this->sleep_vel = sleep_vel;
+        this->sleep_acc_change = sleep_acc_change;
+        this->quiet_checks = quiet_checks;
+    }
+
+    // Sleepers within wake_radius of an awake particle faster than wake_vel are woken up, and so are sleepers whose
+    // contact acceleration moved by more than wake_acc_change from what it was when they fell asleep. wake_radius is
+    // also the reach within which a new sleeper takes a neighbor's contact away; a few particle radii is right.
+    void SetWakeThresholds(float wake_vel, float wake_radius, float wake_acc_change) {
+        if (!(wake_radius > 0.f)) {
+            throw std::runtime_error("QuiescenceManager needs a positive wake radius");
+        }
+        this->wake_vel = wake_vel;
+        this->wake_radius = wake_radius;
+        this->wake_acc_change = wake_acc_change;
+    }
+
+    // Must be called before DEMSim.Initialize(), after SetWakeThresholds
+    void Configure() {
+        if (!(wake_radius > 0.f)) {
+            throw std::runtime_error("QuiescenceManager needs SetWakeThresholds before Configure");
+        }
+        DEMSim.SetFamilyFixed(sleep_family);
+        DEMSim.DisableContactBetweenFamilies(sleep_family, sleep_family);
+    }
+
+    // Watch the clumps tracked by this tracker; awake_family is the family they go back to when woken
+    void Watch(std::shared_ptr<DEMTracker> tracker, size_t num_owners, unsigned int awake_family) {
+        Group g;
+        g.tracker = tracker;
+        g.awake_family = awake_family;
+        g.asleep.assign(num_owners, 0);
+        g.quiet_count.assign(num_owners, 0);
+        g.last_acc.assign(num_owners, make_float3(0));
+        g.sleep_acc.assign(num_owners, make_float3(0));
+        g.fresh.assign(num_owners, 0);
+        groups.push_back(g);
+        num_watched += num_owners;
+    }
+
+    // An external object that wakes particles within influence_radius of its CoM whenever it moves faster than
+    // wake_vel, e.g. the cube released by ChangeFamily(2, 1) or the penetrometer tip. The reach grows by the
+    // distance it covers in one check interval, so it cannot run into sleepers before the next check.
+    void WatchDisturber(std::shared_ptr<DEMTracker> tracker, float influence_radius) {
+        disturbers.push_back({tracker, influence_radius});
+    }
+
+    // Run one sleep/wake check; interval is the simulation time covered since the last call, used for the skipped
+    // particle-steps statistics. Must be called right after a sync.
+    void Update(double interval) {
+        std::vector<float3> hot_pos;
+        std::vector<float> hot_reach;
+        for (auto& d : disturbers) {
+            float speed = length(d.tracker->Vel());
+            if (speed > wake_vel) {
+                hot_pos.push_back(d.tracker->Pos());
+                hot_reach.push_back(d.radius + speed * (float)interval);
+            }
+        }
+        num_hot_disturbers = hot_pos.size();
+
+        // First pass: pull states and collect the fast-moving awake particles
+        std::vector<std::vector<float3>> pos(groups.size()), vel(groups.size()), acc(groups.size());
+        for (size_t gi = 0; gi < groups.size(); gi++) {
+            pos[gi] = groups[gi].tracker->Positions();
+            vel[gi] = groups[gi].tracker->Velocities();
+            acc[gi] = groups[gi].tracker->ContactAccelerations();
+            for (size_t i = 0; i < pos[gi].size(); i++) {
+                if (!groups[gi].asleep[i] && length(vel[gi][i]) > wake_vel) {
+                    hot_pos.push_back(pos[gi][i]);
+                    hot_reach.push_back(wake_radius);
+                }
+            }
+        }
+        BuildHotGrid(hot_pos);
+
+        // Second pass: decide who sleeps and who wakes
+        size_t num_asleep = 0;
+        std::vector<float3> new_sleepers;
+        for (size_t gi = 0; gi < groups.size(); gi++) {
+            Group& g = groups[gi];
+            bool changed = false;
+            for (size_t i = 0; i < pos[gi].size(); i++) {
+                if (g.asleep[i]) {
+                    // The load a sleeper carries is taken at its first check asleep, once the contacts with its
+                    // sleeping neighbors are gone
+                    if (g.fresh[i]) {
+                        g.sleep_acc[i] = acc[gi][i];
+                        g.fresh[i] = 0;
+                    }
+                    bool reloaded = length(acc[gi][i] - g.sleep_acc[i]) > wake_acc_change;
+                    if (reloaded || IsDisturbed(pos[gi][i], hot_pos, hot_reach)) {
+                        g.asleep[i] = 0;
+                        g.quiet_count[i] = 0;
+                        changed = true;
+                        num_woken++;
+                    }
+                } else {
+                    float acc_change = length(acc[gi][i] - g.last_acc[i]);
+                    if (length(vel[gi][i]) < sleep_vel && acc_change < sleep_acc_change) {
+                        g.quiet_count[i]++;
+                    } else {
+                        g.quiet_count[i] = 0;
+                    }
+                    if (g.quiet_count[i] >= quiet_checks && !IsDisturbed(pos[gi][i], hot_pos, hot_reach)) {
+                        g.asleep[i] = 1;
+                        g.fresh[i] = 1;
+                        changed = true;
+                        new_sleepers.push_back(pos[gi][i]);
+                    }
+                }
+                g.last_acc[i] = acc[gi][i];
+                num_asleep += g.asleep[i];
+            }
+            if (changed) {
+                std::vector<unsigned int> fams(g.asleep.size());
+                for (size_t i = 0; i < fams.size(); i++) {
+                    fams[i] = g.asleep[i] ? sleep_family : g.awake_family;
+                }
+                g.tracker->SetFamily(fams);
+            }
+        }
+        // Sleepers touching a new sleeper lose that contact; take their load again at the next check
+        RebaseNear(new_sleepers, pos);
+        // The states we just set hold for the coming interval
+        skipped_owner_time += (double)num_asleep * interval;
+        total_owner_time += (double)num_watched * interval;
+        last_num_asleep = num_asleep;
+    }
+
+    // Wake everything, e.g. before a phase where the whole bed must respond
+    void WakeAll() {
+        for (auto& g : groups) {
+            std::fill(g.asleep.begin(), g.asleep.end(), 0);
+            std::fill(g.quiet_count.begin(), g.quiet_count.end(), 0);
+            g.tracker->SetFamily(g.awake_family);
+        }
+        last_num_asleep = 0;
+    }
+
+    size_t GetNumAsleep() const { return last_num_asleep; }
+
+    // Fraction of particle-steps that were not integrated so far
+    double GetSkippedFraction() const { return (total_owner_time > 0.) ? skipped_owner_time / total_owner_time : 0.; }
+
+    void ShowStats() const {
+        std::cout << "Sleeping particles: " << last_num_asleep << " of " << num_watched << std::endl;
+        std::cout << "Fraction of particle-steps skipped: " << GetSkippedFraction() << std::endl;
+        std::cout << "Number of wake-ups: " << num_woken << std::endl;
+    }
+
+  private:
+    struct Group {
+        std::shared_ptr<DEMTracker> tracker;
+        unsigned int awake_family;
+        std::vector<char> asleep;
+        std::vector<unsigned int> quiet_count;
+        std::vector<float3> last_acc;
+        // Contact acceleration when asleep, and whether it is still to be taken
+        std::vector<float3> sleep_acc;
+        std::vector<char> fresh;
+    };
+    struct Disturber {
+        std::shared_ptr<DEMTracker> tracker;
+        float radius;
+    };
+
+    DEMSolver& DEMSim;
+    unsigned int sleep_family;
+    float sleep_vel = 1e-3;
+    float sleep_acc_change = 0.1;
+    unsigned int quiet_checks = 3;
+    float wake_vel = 5e-3;
+    float wake_radius = 0.;
+    float wake_acc_change = 0.1;
+
+    std::vector<Group> groups;
+    std::vector<Disturber> disturbers;
+    size_t num_watched = 0;
+    size_t last_num_asleep = 0;
+    size_t num_woken = 0;
+    double skipped_owner_time = 0.;
+    double total_owner_time = 0.;
+
+    // Hashed grid over the disturbance sources, so a wake test is not O(num_hot)
+    float cell_size = 0.;
+    size_t num_hot_disturbers = 0;
+    std::unordered_map<int64_t, std::vector<size_t>> hot_grid;
+
+    static int64_t CellKey(int64_t ix, int64_t iy, int64_t iz) {
+        return ((ix & 0x1FFFFF) << 42) | ((iy & 0x1FFFFF) << 21) | (iz & 0x1FFFFF);
+    }
+
+    void BuildHotGrid(const std::vector<float3>& hot_pos) {
+        hot_grid.clear();
+        cell_size = wake_radius;
+        // Disturbers have their own (larger) reach, they are checked brute force as there are only a few of them
+        for (size_t k = num_hot_disturbers; k < hot_pos.size(); k++) {
+            const float3& p = hot_pos[k];
+            hot_grid[CellKey((int64_t)std::floor(p.x / cell_size), (int64_t)std::floor(p.y / cell_size),
+                             (int64_t)std::floor(p.z / cell_size))]
+                .push_back(k);
+        }
+    }
+
+    void RebaseNear(const std::vector<float3>& new_sleepers, const std::vector<std::vector<float3>>& pos) {
+        if (new_sleepers.empty()) {
+            return;
+        }
+        float reach = wake_radius;
+        std::unordered_map<int64_t, std::vector<size_t>> grid;
+        for (size_t k = 0; k < new_sleepers.size(); k++) {
+            const float3& p = new_sleepers[k];
+            grid[CellKey((int64_t)std::floor(p.x / reach), (int64_t)std::floor(p.y / reach),
+                         (int64_t)std::floor(p.z / reach))]
+                .push_back(k);
+        }
+        for (size_t gi = 0; gi < groups.size(); gi++) {
+            Group& g = groups[gi];
+            for (size_t i = 0; i < pos[gi].size(); i++) {
+                if (!g.asleep[i] || g.fresh[i]) {
+                    continue;
+                }
+                const float3& p = pos[gi][i];
+                int64_t ix = (int64_t)std::floor(p.x / reach);
+                int64_t iy = (int64_t)std::floor(p.y / reach);
+                int64_t iz = (int64_t)std::floor(p.z / reach);
+                for (int64_t dx = -1; dx <= 1; dx++) {
+                    for (int64_t dy = -1; dy <= 1; dy++) {
+                        for (int64_t dz = -1; dz <= 1; dz++) {
+                            auto it = grid.find(CellKey(ix + dx, iy + dy, iz + dz));
+                            if (it == grid.end()) {
+                                continue;
+                            }
+                            for (size_t k : it->second) {
+                                if (length(p - new_sleepers[k]) < reach) {
+                                    g.fresh[i] = 1;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    bool IsDisturbed(const float3& p, const std::vector<float3>& hot_pos, const std::vector<float>& hot_reach) const {
+        for (size_t k = 0; k < num_hot_disturbers; k++) {
+            if (length(p - hot_pos[k]) < hot_reach[k]) {
+                return true;
+            }
+        }
+        int64_t ix = (int64_t)std::floor(p.x / cell_size);
+        int64_t iy = (int64_t)std::floor(p.y / cell_size);
+        int64_t iz = (int64_t)std::floor(p.z / cell_size);
+        for (int64_t dx = -1; dx <= 1; dx++) {
+            for (int64_t dy = -1; dy <= 1; dy++) {
+                for (int64_t dz = -1; dz <= 1; dz++) {
+                    auto it = hot_grid.find(CellKey(ix + dx, iy + dy, iz + dz));
+                    if (it == hot_grid.end()) {
+                        continue;
+                    }
+                    for (size_t k : it->second) {
+                        if (length(p - hot_pos[k]) < wake_radius) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,184 @@
+// =============================================================================
+// Quantization of a continuous radius distribution into a few template classes.
+//
+// Loading one sphere template per sampled radius (DistBed loads 4000) bloats
+// the template arrays the solver keeps on the device and JIT-compiles into its
+// kernels, while a few dozen classes reproduce the size distribution to well
+// within its sampling noise. Classes are cut at equal-mass quantiles of the
+// sample, so each class carries the same share of the bed's mass, and a class
+// radius is the cube root of the mean r^3 of its members, which keeps the mass
+// of each class exact. Samples can carry a mass per radius, which is how
+// GradedBed cuts a continuous grain-size curve.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_RADIUS_CLASSES_HPP
+#define DEME_DRIVERS_RADIUS_CLASSES_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace deme;
+
+class RadiusQuantizer {
+  public:
+    RadiusQuantizer(unsigned int num_classes) : num_classes(std::max(1u, num_classes)) {}
+
+    // Cut the sample into equal-mass classes. Each radius is one particle unless masses are given: then radii[i] stands
+    // for masses[i] worth of particles of that size (in any unit), e.g. a band of a grain-size curve.
+    void Fit(const std::vector<float>& radii, const std::vector<double>& masses = {}) {
+        if (radii.empty()) {
+            throw std::runtime_error("RadiusQuantizer needs a non-empty radius sample");
+        }
+        if (!masses.empty() && masses.size() != radii.size()) {
+            throw std::runtime_error("RadiusQuantizer needs one mass per radius");
+        }
+        std::vector<size_t> order(radii.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return radii[a] < radii[b]; });
+        sorted.resize(radii.size());
+        sorted_mass.resize(radii.size());
+        num_sampled = radii.size();
+        double total_mass = 0.;
+        for (size_t i = 0; i < order.size(); i++) {
+            float r = radii[order[i]];
+            sorted[i] = r;
+            sorted_mass[i] = masses.empty() ? (double)r * r * r : masses[order[i]];
+            total_mass += sorted_mass[i];
+        }
+
+        upper_edges.clear();
+        class_radii.clear();
+        class_masses.clear();
+        class_counts.clear();
+        double mass_per_class = total_mass / num_classes;
+        double acc = 0., class_mass = 0., class_count = 0.;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            double m = sorted_mass[i];
+            acc += m;
+            class_mass += m;
+            class_count += m / ((double)sorted[i] * sorted[i] * sorted[i]);
+            bool last = (i + 1 == sorted.size());
+            // Close the class once it holds its share (up to rounding), but never between two equal radii
+            if (last || (acc >= mass_per_class * (class_radii.size() + 1) * (1. - 1e-9) && sorted[i + 1] > sorted[i] &&
+                         class_radii.size() + 1 < num_classes)) {
+                upper_edges.push_back(last ? sorted[i] : 0.5f * (sorted[i] + sorted[i + 1]));
+                class_radii.push_back(std::cbrt(class_mass / class_count));
+                class_masses.push_back(class_mass);
+                class_counts.push_back(class_count);
+                class_mass = 0.;
+                class_count = 0.;
+            }
+        }
+    }
+
+    // Increase the number of classes from the current one until the mass-weighted distribution error is below tol
+    // or max_classes is reached
+    void FitToTolerance(const std::vector<float>& radii, double tol, unsigned int max_classes) {
+        for (; num_classes <= max_classes; num_classes++) {
+            Fit(radii);
+            if (GetMassDistributionError() <= tol) {
+                return;
+            }
+        }
+        num_classes = max_classes;
+        Fit(radii);
+    }
+
+    unsigned int GetNumClasses() const { return class_radii.size(); }
+    const std::vector<float>& GetClassRadii() const { return class_radii; }
+    // Mass and particle count of each class, in the units of the fitted masses (r^3 and particles without them)
+    const std::vector<double>& GetClassMasses() const { return class_masses; }
+    const std::vector<double>& GetClassCounts() const { return class_counts; }
+
+    unsigned int GetClassOf(float r) const {
+        size_t c = std::lower_bound(upper_edges.begin(), upper_edges.end(), r) - upper_edges.begin();
+        return std::min(c, class_radii.size() - 1);
+    }
+
+    std::vector<unsigned int> Assign(const std::vector<float>& radii) const {
+        std::vector<unsigned int> ids(radii.size());
+        for (size_t i = 0; i < radii.size(); i++) {
+            ids[i] = GetClassOf(radii[i]);
+        }
+        return ids;
+    }
+
+    // Largest difference between the mass-weighted cumulative distributions of the sample and of its quantized
+    // version (a Kolmogorov-Smirnov distance, 0 to 1)
+    double GetMassDistributionError() const {
+        double total = 0., quantized_total = 0.;
+        std::vector<double> q(sorted.size());
+        for (size_t i = 0; i < sorted.size(); i++) {
+            // Same particle count, at the class radius
+            double r = class_radii[GetClassOf(sorted[i])];
+            q[i] = sorted_mass[i] * (r * r * r) / ((double)sorted[i] * sorted[i] * sorted[i]);
+            total += sorted_mass[i];
+            quantized_total += q[i];
+        }
+        // The quantized radius is monotone in the original one, so both CDFs can be walked in the same order. The
+        // CDFs are compared at every distinct radius of either one.
+        std::vector<std::pair<float, double>> steps;
+        for (size_t i = 0; i < sorted.size(); i++) {
+            steps.push_back({sorted[i], sorted_mass[i] / total});
+            steps.push_back({class_radii[GetClassOf(sorted[i])], -q[i] / quantized_total});
+        }
+        std::sort(steps.begin(), steps.end(), [](const std::pair<float, double>& a, const std::pair<float, double>& b) {
+            return a.first < b.first;
+        });
+        double diff = 0., max_diff = 0.;
+        for (size_t i = 0; i < steps.size(); i++) {
+            diff += steps[i].second;
+            if (i + 1 == steps.size() || steps[i + 1].first > steps[i].first) {
+                max_diff = std::max(max_diff, std::abs(diff));
+            }
+        }
+        return max_diff;
+    }
+
+    // Load one sphere template per class
+    std::vector<std::shared_ptr<DEMClumpTemplate>> LoadSphereTemplates(DEMSolver& DEMSim, double density,
+                                                                       const std::shared_ptr<DEMMaterial>& mat) const {
+        std::vector<std::shared_ptr<DEMClumpTemplate>> templates;
+        for (float r : class_radii) {
+            templates.push_back(DEMSim.LoadSphereType(density * 4. / 3. * PI * r * r * r, r, mat));
+        }
+        return templates;
+    }
+
+    // num_unquantized_templates: how many templates the driver would have loaded otherwise (one per sampled radius
+    // if not given)
+    void ShowStats(size_t num_unquantized_templates = 0) const {
+        if (num_unquantized_templates == 0) {
+            num_unquantized_templates = num_sampled;
+        }
+        // Per single-sphere template the solver keeps mass, volume, MOI (3), and per component radius, relative
+        // position (3) and material offset, all 4-byte values
+        const size_t bytes_per_template = 4 * (1 + 1 + 3 + 1 + 3 + 1);
+        std::cout << "Radius classes: " << class_radii.size() << " (from " << num_unquantized_templates
+                  << " templates)" << std::endl;
+        std::cout << "Mass-weighted size distribution error: " << GetMassDistributionError() << std::endl;
+        std::cout << "Template memory: " << class_radii.size() * bytes_per_template << " bytes instead of "
+                  << num_unquantized_templates * bytes_per_template << " bytes" << std::endl;
+    }
+
+  private:
+    unsigned int num_classes;
+    size_t num_sampled = 0;
+    std::vector<float> sorted;
+    std::vector<double> sorted_mass;
+    std::vector<float> upper_edges;
+    std::vector<float> class_radii;
+    std::vector<double> class_masses;
+    std::vector<double> class_counts;
+};
+
+#endif
@@ -0,0 +1,300 @@
+// =============================================================================
+// Stable time step estimates from the loaded materials and clump templates.
+//
+// Two limits are considered:
+//  - the Rayleigh wave step of each particle template (Zhang et al. 2024, eq. 4),
+//    dt_R = PI * r * sqrt(rho / G) / (0.8766 + 0.163 * nu);
+//  - the Hertzian contact duration of each particle-particle and wall-particle
+//    pair at a given impact speed, t_H = 2.87 * (m*^2 / (R* E*^2 v))^(1/5),
+//    which must be resolved by a number of steps. Wall-particle pairs use the
+//    effective modulus of the two materials, so a stiff wall is accounted for.
+// The controller picks safety * min(dt_R) or t_H / steps_per_contact, whichever
+// is smaller, and can re-evaluate it as the peak velocity of the bed changes.
+//
+// Walls registered as `stiff' (the steel cube, say) are left out of the bulk
+// step. MultiRateStepper then runs the bulk step while no stiff object is near
+// the bed and k sub-steps per bulk step from just before one hits it until it
+// has come to rest.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_STEP_SIZE_HPP
+#define DEME_DRIVERS_STEP_SIZE_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+using namespace deme;
+
+// Critical step of a sphere of radius r and density rho, from the Rayleigh wave speed
+inline double RayleighTimeStep(double radius, double density, double E, double nu) {
+    double G = E / (2. * (1. + nu));
+    return PI * radius * std::sqrt(density / G) / (0.8766 + 0.163 * nu);
+}
+
+// Effective Young's modulus of two materials in Hertzian contact
+inline double EffectiveModulus(double E1, double nu1, double E2, double nu2) {
+    return 1. / ((1. - nu1 * nu1) / E1 + (1. - nu2 * nu2) / E2);
+}
+
+// Duration of a Hertzian impact with effective mass, radius and modulus at approach speed v
+inline double HertzContactDuration(double eff_mass, double eff_radius, double eff_E, double v) {
+    v = std::max(v, 1e-6);
+    return 2.87 * std::pow(eff_mass * eff_mass / (eff_radius * eff_E * eff_E * v), 0.2);
+}
+
+// Maximum Hertzian overlap reached in the same impact
+inline double HertzMaxOverlap(double eff_mass, double eff_radius, double eff_E, double v) {
+    return std::pow(15. * eff_mass * v * v / (16. * eff_E * std::sqrt(eff_radius)), 0.4);
+}
+
+class StableStepController {
+  public:
+    // Fraction of the Rayleigh step actually used
+    void SetSafetyFactor(double safety) { this->safety = safety; }
+    // Number of steps a Hertzian impact must span
+    void SetStepsPerContact(double n) { steps_per_contact = n; }
+    // The step is only updated when the new estimate differs from the current one by more than this fraction
+    void SetAdaptTolerance(double tol) { adapt_tol = tol; }
+    // Never go above this step, e.g. to keep output frames an integer number of steps
+    void SetMaxStep(double max_step) { this->max_step = max_step; }
+
+    // Register a particle template; each component sphere is considered with the clump's bulk density
+    void AddParticleTemplate(const std::shared_ptr<DEMClumpTemplate>& tmpl) {
+        double vol = 0.;
+        for (float r : tmpl->radii) {
+            vol += 4. / 3. * PI * r * r * r;
+        }
+        // Overlapping component spheres make vol an over-estimate, so density is under-estimated and the step is
+        // on the safe side
+        double density = tmpl->mass / vol;
+        for (size_t i = 0; i < tmpl->radii.size(); i++) {
+            const auto& mat = tmpl->materials.at(std::min(i, tmpl->materials.size() - 1));
+            Particle p;
+            p.radius = tmpl->radii[i];
+            p.mass = tmpl->mass;
+            p.density = density;
+            p.E = mat->mat_prop.at("E");
+            p.nu = mat->mat_prop.at("nu");
+            particles.push_back(p);
+        }
+    }
+
+    // Register a wall (analytical boundary or mesh) material the particles may hit. Stiff walls only count towards
+    // the sub-stepped size, see GetStiffStepSize.
+    void AddWallMaterial(const std::shared_ptr<DEMMaterial>& mat, bool stiff = false) {
+        walls.push_back({mat->mat_prop.at("E"), mat->mat_prop.at("nu"), stiff});
+    }
+
+    double GetRayleighStep() const {
+        double dt = std::numeric_limits<double>::max();
+        for (const auto& p : particles) {
+            dt = std::min(dt, RayleighTimeStep(p.radius, p.density, p.E, p.nu));
+        }
+        return dt;
+    }
+
+    // Shortest Hertzian impact among all particle-particle and wall-particle pairs at approach speed v
+    double GetContactDuration(double v, bool include_stiff = true) const {
+        double tc = std::numeric_limits<double>::max();
+        for (size_t i = 0; i < particles.size(); i++) {
+            const auto& a = particles[i];
+            for (size_t j = i; j < particles.size(); j++) {
+                const auto& b = particles[j];
+                double m = a.mass * b.mass / (a.mass + b.mass);
+                double R = a.radius * b.radius / (a.radius + b.radius);
+                tc = std::min(tc, HertzContactDuration(m, R, EffectiveModulus(a.E, a.nu, b.E, b.nu), v));
+            }
+            for (const auto& w : walls) {
+                if (w.stiff && !include_stiff) {
+                    continue;
+                }
+                tc = std::min(tc, HertzContactDuration(a.mass, a.radius, EffectiveModulus(a.E, a.nu, w.E, w.nu), v));
+            }
+        }
+        return tc;
+    }
+
+    // Largest overlap/radius ratio expected at approach speed v, a sanity check on the material stiffness
+    double GetMaxOverlapRatio(double v) const {
+        double ratio = 0.;
+        for (const auto& a : particles) {
+            for (const auto& w : walls) {
+                ratio = std::max(
+                    ratio, HertzMaxOverlap(a.mass, a.radius, EffectiveModulus(a.E, a.nu, w.E, w.nu), v) / a.radius);
+            }
+            double m = a.mass / 2.;
+            ratio = std::max(ratio, HertzMaxOverlap(m, a.radius / 2., EffectiveModulus(a.E, a.nu, a.E, a.nu), v) /
+                                        a.radius);
+        }
+        return ratio;
+    }
+
+    // Stable step at approach speed v, for the bulk (stiff walls excluded)
+    double GetStepSize(double v) const {
+        double dt = std::min(safety * GetRayleighStep(), GetContactDuration(v, false) / steps_per_contact);
+        return std::min(dt, max_step);
+    }
+
+    // Stable step at approach speed v when stiff walls are in contact too
+    double GetStiffStepSize(double v) const {
+        double dt = std::min(safety * GetRayleighStep(), GetContactDuration(v, true) / steps_per_contact);
+        return std::min(dt, max_step);
+    }
+
+    // Number of sub-steps a bulk step is split into while stiff walls are in contact
+    unsigned int GetSubsteps(double v) const {
+        return (unsigned int)std::ceil(GetStepSize(v) / GetStiffStepSize(v) - 1e-6);
+    }
+
+    // Re-evaluate the step with the current peak velocity and push it to the solver if it changed enough. Must be
+    // called between syncs. Returns the step in use afterwards.
+    double Adapt(DEMSolver& DEMSim, double peak_vel) {
+        double dt = GetStepSize(peak_vel);
+        if (current_step <= 0. || std::abs(dt - current_step) > adapt_tol * current_step) {
+            DEMSim.UpdateStepSize(dt);
+            current_step = dt;
+        }
+        return current_step;
+    }
+
+    // Set the initial step of the solver from an expected peak velocity
+    double Apply(DEMSolver& DEMSim, double expected_vel) {
+        current_step = GetStepSize(expected_vel);
+        DEMSim.SetInitTimeStep(current_step);
+        return current_step;
+    }
+
+    void ShowStats(double v) const {
+        std::cout << "Rayleigh critical step: " << GetRayleighStep() << std::endl;
+        std::cout << "Shortest Hertzian contact at " << v << " m/s: " << GetContactDuration(v) << std::endl;
+        std::cout << "Largest overlap ratio at " << v << " m/s: " << GetMaxOverlapRatio(v) << std::endl;
+        std::cout << "Selected step size: " << GetStepSize(v) << std::endl;
+        std::cout << "Sub-steps with stiff walls in contact: " << GetSubsteps(v) << std::endl;
+    }
+
+  private:
+    struct Particle {
+        double radius, mass, density, E, nu;
+    };
+    struct Wall {
+        double E, nu;
+        bool stiff;
+    };
+    std::vector<Particle> particles;
+    std::vector<Wall> walls;
+    double safety = 0.1;
+    double steps_per_contact = 50.;
+    double adapt_tol = 0.1;
+    double max_step = std::numeric_limits<double>::max();
+    double current_step = 0.;
+};
+
+// Switches the solver between the bulk step and bulk / k around the impacts of stiff objects (registered with
+// Watch) on the bed, and keeps count of how many steps that saved compared to running the stiff step throughout.
+// An object coming down onto the bed switches sub-stepping on one check before it can reach the bed top, so the
+// impact itself is sub-stepped. Sub-stepping ends once every object has been out of reach of the bed, or slower
+// than the quiet speed, for a number of checks in a row: an object resting on the bed does not need it.
+class MultiRateStepper {
+  public:
+    MultiRateStepper(const StableStepController& controller, double v)
+        : bulk_step(controller.GetStepSize(v)), num_substeps(controller.GetSubsteps(v)) {
+        // The quiet speed is the fastest impact the bulk step still resolves with the stiff materials in contact
+        double lo = 0., hi = v;
+        if (controller.GetStiffStepSize(hi) >= bulk_step) {
+            lo = hi;
+        }
+        for (int k = 0; k < 50 && lo < hi; k++) {
+            double mid = 0.5 * (lo + hi);
+            if (controller.GetStiffStepSize(mid) >= bulk_step) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        quiet_vel = lo;
+    }
+
+    // A stiff object whose lowest point lies reach below its CoM, coming down onto the bed
+    void Watch(std::shared_ptr<DEMTracker> tracker, double reach) { stiff_objects.push_back({tracker, reach}); }
+    // Downward acceleration an object may pick up between two checks (gravity, for a released object)
+    void SetApproachAcceleration(double acc) { approach_acc = acc; }
+    // Sub-stepping ends after quiet_checks checks in a row with no object both near the bed and faster than
+    // quiet_vel
+    void SetQuietCriterion(double quiet_vel, unsigned int quiet_checks) {
+        this->quiet_vel = quiet_vel;
+        this->quiet_checks = quiet_checks;
+    }
+
+    double GetBulkStep() const { return bulk_step; }
+    double GetStiffStep() const { return bulk_step / num_substeps; }
+    double GetQuietSpeed() const { return quiet_vel; }
+
+    // Call after a sync, right before running the solver for interval; bed_top is the height of the highest
+    // particle surface. Returns true if the solver's step was changed.
+    bool Update(DEMSolver& DEMSim, double interval, double bed_top) {
+        bool hot = false;
+        for (auto& obj : stiff_objects) {
+            float3 vel = obj.tracker->Vel();
+            double gap = obj.tracker->Pos().z - obj.reach - bed_top;
+            double approach = std::max(-(double)vel.z, 0.);
+            // Farthest it can come down before the next check
+            double travel = approach * interval + 0.5 * approach_acc * interval * interval;
+            bool in_contact = length(obj.tracker->ContactAcc()) > 0.;
+            // Fastest it can hit the bed before the next check; one not touching anything may still be speeding up
+            double speed = std::max((double)length(vel), in_contact ? 0. : approach + approach_acc * interval);
+            if ((in_contact || gap < travel) && speed > quiet_vel) {
+                hot = true;
+                break;
+            }
+        }
+        quiet_count = hot ? 0 : quiet_count + 1;
+        bool want = (hot || (substepping && quiet_count < quiet_checks)) && num_substeps > 1;
+        bool changed = want != substepping;
+        if (changed) {
+            substepping = want;
+            DEMSim.UpdateStepSize(substepping ? GetStiffStep() : GetBulkStep());
+        }
+        if (substepping) {
+            stiff_time += interval;
+        } else {
+            bulk_time += interval;
+        }
+        return changed;
+    }
+
+    void ShowStats() const {
+        double steps_taken = bulk_time / GetBulkStep() + stiff_time / GetStiffStep();
+        double steps_single_rate = (bulk_time + stiff_time) / GetStiffStep();
+        std::cout << "Sub-steps per bulk step in stiff contact: " << num_substeps << std::endl;
+        std::cout << "Quiet speed of stiff objects: " << quiet_vel << " m/s" << std::endl;
+        std::cout << "Time spent sub-stepping: " << stiff_time << " of " << bulk_time + stiff_time << " s" << std::endl;
+        std::cout << "Force evaluations relative to single-rate stepping: "
+                  << ((steps_single_rate > 0.) ? steps_taken / steps_single_rate : 1.) << std::endl;
+    }
+
+  private:
+    struct StiffObject {
+        std::shared_ptr<DEMTracker> tracker;
+        double reach;
+    };
+
+    double bulk_step;
+    unsigned int num_substeps;
+    double quiet_vel = 0.;
+    unsigned int quiet_checks = 2;
+    double approach_acc = 9.81;
+    bool substepping = false;
+    unsigned int quiet_count = 0;
+    double bulk_time = 0.;
+    double stiff_time = 0.;
+    std::vector<StiffObject> stiff_objects;
+};
+
+#endif
@@ -0,0 +1,193 @@
+// =============================================================================
+// A pre-scheduled timeline of simulation events.
+//
+// Instead of sprinkling `DoDynamicsThenSync(0); ChangeFamily(...)' through the
+// output loop, a driver registers (time, action) pairs up front: family
+// changes, material swaps, contact enabling/disabling, teleports, or any other
+// callable. AdvanceTo then runs the dynamics straight up to the next event with
+// a single DoDynamicsThenSync, applies every event due at that time together,
+// and carries on. No zero-length syncs are issued, and events sharing a time
+// share one sync.
+//
+// Windows registered with During get a callback before every step inside
+// them, e.g. to apply a tabulated load; outside windows the dynamics run in
+// bulk without any host involvement.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_TIMELINE_HPP
+#define DEME_DRIVERS_TIMELINE_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace deme;
+
+class EventTimeline {
+  public:
+    // step_size is needed to advance step by step through During windows
+    EventTimeline(double step_size, double start_time = 0.) : step_size(step_size), now(start_time) {}
+
+    void SetStepSize(double step_size) { this->step_size = step_size; }
+    void SetVerbose(bool verbose) { this->verbose = verbose; }
+
+    // Generic event; events at equal times run in the order they were added
+    void At(double time, const std::string& label, std::function<void(DEMSolver&)> action) {
+        Event e{time, label, std::move(action), seq++};
+        auto it = std::upper_bound(events.begin(), events.end(), e, [](const Event& a, const Event& b) {
+            return a.time < b.time || (a.time == b.time && a.seq < b.seq);
+        });
+        events.insert(it, std::move(e));
+    }
+
+    void ChangeFamilyAt(double time, unsigned int from, unsigned int to) {
+        At(time, "ChangeFamily(" + std::to_string(from) + ", " + std::to_string(to) + ")",
+           [=](DEMSolver& sim) { sim.ChangeFamily(from, to); });
+    }
+
+    void SetFamilyClumpMaterialAt(double time, unsigned int family, std::shared_ptr<DEMMaterial> mat) {
+        At(time, "SetFamilyClumpMaterial(" + std::to_string(family) + ")",
+           [=](DEMSolver& sim) { sim.SetFamilyClumpMaterial(family, mat); });
+    }
+
+    void DisableContactAt(double time, unsigned int fam1, unsigned int fam2) {
+        At(time, "DisableContactBetweenFamilies(" + std::to_string(fam1) + ", " + std::to_string(fam2) + ")",
+           [=](DEMSolver& sim) { sim.DisableContactBetweenFamilies(fam1, fam2); });
+    }
+
+    void EnableContactAt(double time, unsigned int fam1, unsigned int fam2) {
+        At(time, "EnableContactBetweenFamilies(" + std::to_string(fam1) + ", " + std::to_string(fam2) + ")",
+           [=](DEMSolver& sim) { sim.EnableContactBetweenFamilies(fam1, fam2); });
+    }
+
+    void TeleportAt(double time, std::shared_ptr<DEMTracker> tracker, float3 pos) {
+        At(time, "Teleport", [=](DEMSolver&) { tracker->SetPos(pos); });
+    }
+
+    // Call per_step(sim, time since window start) before every step in [t_start, t_end)
+    void During(double t_start, double t_end, std::function<void(DEMSolver&, double)> per_step) {
+        windows.push_back({t_start, t_end, std::move(per_step)});
+    }
+
+    double GetTime() const { return now; }
+
+    // Advance the simulation to t_end, applying everything scheduled on the way. With sync = false the last stretch
+    // is left asynchronous.
+    void AdvanceTo(DEMSolver& sim, double t_end, bool sync = true) {
+        const double eps = 1e-3 * step_size;
+        while (now < t_end - eps) {
+            const Window* active = ActiveWindow();
+            double stop = std::min(t_end, NextEventTime());
+            stop = active ? std::min(stop, active->t_end) : std::min(stop, NextWindowStart());
+            // A sync is only issued where something has to be applied, or where the caller asked for one
+            bool sync_at_stop = EventDueBy(stop + eps) || (sync && stop >= t_end - eps);
+            if (active) {
+                // Step-wise through the window; the last step is cut short at stop if the stretch is not a whole
+                // number of steps, and carries the sync if one is needed
+                while (now < stop - eps) {
+                    active->per_step(sim, now - active->t_start);
+                    bool last = now + step_size >= stop - eps;
+                    double h = last ? stop - now : step_size;
+                    Run(sim, h, sync_at_stop && last);
+                    now = last ? stop : now + h;
+                }
+            } else if (stop > now + eps) {
+                // Whole steps in bulk, then the remainder as one short step, so stop is not overshot
+                double whole = std::floor((stop - now) / step_size + 1e-3) * step_size;
+                double rest = stop - now - whole;
+                bool has_rest = rest > eps;
+                if (whole > eps) {
+                    Run(sim, whole, sync_at_stop && !has_rest);
+                }
+                if (has_rest) {
+                    Run(sim, rest, sync_at_stop);
+                }
+                now = stop;
+            }
+            ApplyDueEvents(sim, eps);
+        }
+    }
+
+  private:
+    struct Event {
+        double time;
+        std::string label;
+        std::function<void(DEMSolver&)> action;
+        size_t seq;
+    };
+    struct Window {
+        double t_start, t_end;
+        std::function<void(DEMSolver&, double)> per_step;
+    };
+
+    double step_size;
+    double now;
+    bool verbose = true;
+    size_t seq = 0;
+    size_t next_event = 0;
+    std::vector<Event> events;
+    std::vector<Window> windows;
+
+    double NextEventTime() const {
+        return (next_event < events.size()) ? events[next_event].time : std::numeric_limits<double>::max();
+    }
+
+    double NextWindowStart() const {
+        double t = std::numeric_limits<double>::max();
+        for (const auto& w : windows) {
+            if (w.t_start > now) {
+                t = std::min(t, w.t_start);
+            }
+        }
+        return t;
+    }
+
+    const Window* ActiveWindow() const {
+        const double eps = 1e-3 * step_size;
+        for (const auto& w : windows) {
+            if (w.t_start <= now + eps && now < w.t_end - eps) {
+                return &w;
+            }
+        }
+        return nullptr;
+    }
+
+    // Run duration; one shorter than a step is run as a single step of that size, as the solver runs whole steps
+    void Run(DEMSolver& sim, double duration, bool sync) {
+        bool short_step = duration < step_size - 1e-3 * step_size;
+        double solver_step = short_step ? sim.GetTimeStepSize() : 0.;
+        if (short_step) {
+            sim.UpdateStepSize(duration);
+        }
+        if (sync) {
+            sim.DoDynamicsThenSync(duration);
+        } else {
+            sim.DoDynamics(duration);
+        }
+        if (short_step) {
+            sim.UpdateStepSize(solver_step);
+        }
+    }
+
+    bool EventDueBy(double t) const { return next_event < events.size() && events[next_event].time <= t; }
+
+    void ApplyDueEvents(DEMSolver& sim, double eps) {
+        while (EventDueBy(now + eps)) {
+            if (verbose) {
+                std::cout << "Timeline: " << events[next_event].label << " at t = " << now << std::endl;
+            }
+            events[next_event].action(sim);
+            next_event++;
+        }
+    }
+};
+
+#endif
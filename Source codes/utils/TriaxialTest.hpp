@@ -0,0 +1,433 @@
+// =============================================================================
+// Triaxial and oedometer tests on a DEM specimen, with servo-controlled walls.
+//
+// The specimen is a box or a vertical cylinder. Every wall is its own
+// external object and family, held fixed by the solver and moved by the test
+// through its tracker.
+//   - A box has six planes: two platens and four side walls.
+//   - A cylinder has two platens and a flexible sleeve, a tube mesh driven by
+//     MembraneSolver. The confining pressure acts on the sleeve's faces, and
+//     its end rings follow the platens.
+//
+// Each control interval, the walls' loads are read with a ForceSensor and the
+// walls are moved, then the solver runs for the interval. The platens either
+// hold, move at a constant axial strain rate or servo to a target stress. The
+// side walls of a box servo to the confining stress or hold (oedometer). A
+// servo moves a wall at gain * (measured - target) stress, capped at the
+// maximum speed, like the PFC wall servo.
+//
+// Stresses, strains and the deviator stress are recorded every interval,
+// compression positive. PastPeak tells when the deviator has dropped below a
+// fraction of its peak. RampIsotropic raises the confinement in steps as
+// PFC's rampUp does.
+//
+// Build the test before sim.Initialize and Start it after. The particles are
+// added by the driver, inside SetBox or SetCylinder's bounds.
+// =============================================================================
+
+#ifndef DEME_DRIVERS_TRIAXIAL_TEST_HPP
+#define DEME_DRIVERS_TRIAXIAL_TEST_HPP
+
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ForceSensor.hpp"
+#include "MembraneSolver.hpp"
+#include "PrimitiveMesh.hpp"
+
+using namespace deme;
+
+enum class SPECIMEN_SHAPE { BOX, CYLINDER };
+enum class WALL_CONTROL { FIXED, STRAIN_RATE, STRESS };
+
+class TriaxialTest {
+  public:
+    // The walls take families first_family to first_family + 6
+    TriaxialTest(DEMSolver& sim, std::shared_ptr<DEMMaterial> wall_mat, unsigned int first_family = 20)
+        : sim(sim), wall_mat(wall_mat), first_family(first_family) {}
+
+    void SetBox(float3 lo, float3 hi) {
+        shape = SPECIMEN_SHAPE::BOX;
+        this->lo = lo;
+        this->hi = hi;
+    }
+    void SetCylinder(float3 base_center, float radius, float height) {
+        shape = SPECIMEN_SHAPE::CYLINDER;
+        this->radius = radius;
+        lo = base_center - make_float3(radius, radius, 0);
+        hi = base_center + make_float3(radius, radius, height);
+    }
+    // Sleeve of a cylindrical specimen: membrane thickness, modulus, Poisson's ratio, density and mesh edge length
+    void SetSleeve(float thickness, float E, float nu, float density, float edge_length) {
+        sleeve = SleeveProps{thickness, E, nu, density, edge_length};
+    }
+
+    // Time between wall updates
+    void SetControlInterval(double dt) { control_dt = dt; }
+    // Servo gain, (m/s)/Pa, and the speed cap of any wall. A gain of 0 moves a wall at the cap when its stress error
+    // equals its target.
+    void SetServo(double gain, double max_speed) {
+        servo_gain = gain;
+        max_wall_speed = max_speed;
+    }
+
+    // Create the walls (and the sleeve mesh, written to work_dir) before sim.Initialize
+    void Build(const std::string& work_dir) {
+        if (!(hi.z > lo.z)) {
+            throw std::runtime_error("TriaxialTest needs SetBox or SetCylinder before Build");
+        }
+        float3 mid = (lo + hi) * 0.5f;
+        AddWall(2, make_float3(mid.x, mid.y, lo.z), make_float3(0, 0, 1));
+        AddWall(2, make_float3(mid.x, mid.y, hi.z), make_float3(0, 0, -1));
+        if (shape == SPECIMEN_SHAPE::BOX) {
+            AddWall(0, make_float3(lo.x, mid.y, mid.z), make_float3(1, 0, 0));
+            AddWall(0, make_float3(hi.x, mid.y, mid.z), make_float3(-1, 0, 0));
+            AddWall(1, make_float3(mid.x, lo.y, mid.z), make_float3(0, 1, 0));
+            AddWall(1, make_float3(mid.x, hi.y, mid.z), make_float3(0, -1, 0));
+        } else {
+            if (sleeve.thickness <= 0.f) {
+                throw std::runtime_error("A cylindrical specimen needs SetSleeve before Build");
+            }
+            std::string sleeve_file = work_dir + "/triaxial_sleeve.obj";
+            MakeSleeveMesh().WriteObj(sleeve_file);
+            sleeve_mesh = sim.AddWavefrontMeshObject(sleeve_file, wall_mat);
+            // Only its deformation matters; the family is fixed
+            sleeve_mesh->SetMass(1.);
+            sleeve_mesh->SetMOI(make_float3(1.));
+            sleeve_mesh->InformCentroidPrincipal(make_float3(0), make_float4(0, 0, 0, 1));
+            sleeve_mesh->SetInitPos(make_float3(mid.x, mid.y, lo.z));
+            unsigned int sleeve_family = GetSleeveFamily();
+            sleeve_mesh->SetFamily(sleeve_family);
+            sim.SetFamilyFixed(sleeve_family);
+            sim.DisableContactBetweenFamilies(sleeve_family, first_family);
+            sim.DisableContactBetweenFamilies(sleeve_family, first_family + 1);
+            sleeve_tracker = sim.Track(sleeve_mesh);
+        }
+    }
+
+    // Pick up the initial dimensions and start the sleeve, after sim.Initialize
+    void Start() {
+        if (sleeve_tracker) {
+            membrane = std::make_unique<MembraneSolver>(sleeve_tracker, sleeve.thickness, sleeve.E, sleeve.nu,
+                                                        sleeve.density);
+            float h = hi.z - lo.z;
+            float tol = 1e-3f * h;
+            for (size_t i = 0; i < membrane->GetNodes().size(); i++) {
+                float z = membrane->GetNodes()[i].z;
+                if (z < tol) {
+                    membrane->FixNode(i);
+                    bottom_ring.push_back(i);
+                } else if (z > h - tol) {
+                    membrane->FixNode(i);
+                    top_ring.push_back(i);
+                }
+            }
+            ring_rest.clear();
+            for (size_t i : bottom_ring) {
+                ring_rest.push_back(membrane->GetNodes()[i]);
+            }
+            for (size_t i : top_ring) {
+                ring_rest.push_back(membrane->GetNodes()[i]);
+            }
+            sleeve_base_z = lo.z;
+            sleeve_height = h;
+        }
+        ResetStrain();
+    }
+
+    // Confining stress: servo of the side walls of a box, or the pressure on the sleeve of a cylinder
+    void SetLateralStress(double s) {
+        lateral_control = WALL_CONTROL::STRESS;
+        lateral_target = s;
+        if (membrane) {
+            membrane->SetPressure(s);
+        }
+    }
+    // Hold the side walls of a box where they are (oedometer)
+    void FixLateral() {
+        if (shape != SPECIMEN_SHAPE::BOX) {
+            throw std::runtime_error("Only a box specimen can hold its side walls; use a box for oedometer tests");
+        }
+        lateral_control = WALL_CONTROL::FIXED;
+    }
+    // Servo both platens to an axial stress
+    void SetAxialStress(double s) {
+        axial_control = WALL_CONTROL::STRESS;
+        axial_target = s;
+    }
+    // Move the top platen down at rate times the reference height per second; the bottom platen holds
+    void SetAxialStrainRate(double rate) {
+        axial_control = WALL_CONTROL::STRAIN_RATE;
+        axial_rate = rate;
+    }
+    void FixAxial() { axial_control = WALL_CONTROL::FIXED; }
+
+    // Run for duration, updating the walls every control interval
+    void Advance(double duration) {
+        size_t n = std::max<size_t>(1, (size_t)std::llround(duration / control_dt));
+        for (size_t k = 0; k < n; k++) {
+            Control();
+            sim.DoDynamics(control_dt);
+            time += control_dt;
+        }
+    }
+
+    // Raise the isotropic stress to p in increments, holding each for hold_time, then hold the target for
+    // settle_time; the walls keep servoing throughout
+    void RampIsotropic(double p, double increment, double hold_time, double settle_time) {
+        double s = (lateral_control == WALL_CONTROL::STRESS) ? lateral_target : 0.;
+        increment = std::abs(increment);
+        while (std::abs(s) < std::abs(p)) {
+            s = (p > s) ? std::min(p, s + increment) : std::max(p, s - increment);
+            SetLateralStress(s);
+            SetAxialStress(s);
+            Advance(hold_time);
+        }
+        Advance(settle_time);
+    }
+
+    // Take the current dimensions as the zero-strain reference (e.g. after consolidation) and clear the peak
+    void ResetStrain() {
+        height0 = hi.z - lo.z;
+        volume0 = Volume();
+        peak_deviator = 0.;
+        peak_strain = 0.;
+    }
+
+    // From the last control step; compression positive
+    double GetAxialStress() const { return axial_stress; }
+    double GetLateralStress() const { return lateral_stress; }
+    double GetDeviatorStress() const { return axial_stress - lateral_stress; }
+    double GetAxialStrain() const { return (height0 - (hi.z - lo.z)) / height0; }
+    double GetVolumetricStrain() const { return (volume0 - Volume()) / volume0; }
+    double GetPeakDeviatorStress() const { return peak_deviator; }
+    double GetPeakAxialStrain() const { return peak_strain; }
+    double GetTime() const { return time; }
+    // The sleeve of a cylindrical specimen (null for a box), e.g. to set its damping; available after Start
+    MembraneSolver* GetSleeve() { return membrane.get(); }
+    unsigned int GetSleeveFamily() const { return first_family + 6; }
+
+    // Whether the deviator stress has fallen below drop times its peak, past min_strain of axial strain
+    bool PastPeak(double drop = 0.85, double min_strain = 0.005) const {
+        return GetAxialStrain() > min_strain && peak_deviator > 0. && GetDeviatorStress() < drop * peak_deviator;
+    }
+
+    // One row per control step
+    void WriteCsv(const std::string& filename) const {
+        std::ofstream file(filename);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open triaxial test output " + filename);
+        }
+        file << "time,axial_strain,volumetric_strain,axial_stress,lateral_stress,deviator_stress\n";
+        for (size_t r = 0; r < history.size(); r++) {
+            const Record& h = history[r];
+            file << h.time << "," << h.axial_strain << "," << h.vol_strain << "," << h.axial_stress << ","
+                 << h.lateral_stress << "," << h.axial_stress - h.lateral_stress << "\n";
+        }
+    }
+
+    void ShowStats() const {
+        std::cout << "Triaxial test at t = " << time << ": axial strain " << GetAxialStrain() << ", volumetric strain "
+                  << GetVolumetricStrain() << ", axial stress " << axial_stress << ", lateral stress "
+                  << lateral_stress << std::endl;
+    }
+
+  private:
+    // A plane wall moving along axis (0, 1, 2); normal points into the specimen
+    struct Wall {
+        std::shared_ptr<DEMExternObj> obj;
+        std::shared_ptr<DEMTracker> tracker;
+        int axis;
+        float3 normal;
+        size_t sensor;
+    };
+    struct SleeveProps {
+        float thickness = 0.f, E = 0.f, nu = 0.f, density = 0.f, edge_length = 0.f;
+    };
+    struct Record {
+        double time, axial_strain, vol_strain, axial_stress, lateral_stress;
+    };
+
+    DEMSolver& sim;
+    std::shared_ptr<DEMMaterial> wall_mat;
+    unsigned int first_family;
+    SPECIMEN_SHAPE shape = SPECIMEN_SHAPE::BOX;
+    // Current extent of the specimen; a cylinder's x and y extent is its initial radius
+    float3 lo = make_float3(0), hi = make_float3(0);
+    float radius = 0.f;
+    // Bottom and top platens first, then the side walls of a box
+    std::vector<Wall> walls;
+    ForceSensor sensors;
+
+    SleeveProps sleeve;
+    std::shared_ptr<DEMMeshConnected> sleeve_mesh;
+    std::shared_ptr<DEMTracker> sleeve_tracker;
+    std::unique_ptr<MembraneSolver> membrane;
+    std::vector<size_t> bottom_ring, top_ring;
+    std::vector<float3> ring_rest;
+    float sleeve_base_z = 0.f, sleeve_height = 0.f;
+    std::vector<float3> points, forces;
+
+    WALL_CONTROL axial_control = WALL_CONTROL::FIXED, lateral_control = WALL_CONTROL::FIXED;
+    double axial_target = 0., lateral_target = 0., axial_rate = 0.;
+    double servo_gain = 0., max_wall_speed = 0.;
+    double control_dt = 1e-4;
+
+    double time = 0.;
+    double height0 = 1., volume0 = 1.;
+    double axial_stress = 0., lateral_stress = 0.;
+    double peak_deviator = 0., peak_strain = 0.;
+    std::vector<Record> history;
+
+    void AddWall(int axis, const float3& pos, const float3& normal) {
+        Wall w;
+        w.obj = sim.AddExternalObject();
+        w.obj->AddPlane(make_float3(0), normal, wall_mat);
+        w.obj->SetInitPos(pos);
+        unsigned int family = first_family + (unsigned int)walls.size();
+        w.obj->SetFamily(family);
+        sim.SetFamilyFixed(family);
+        w.tracker = sim.Track(w.obj);
+        w.axis = axis;
+        w.normal = normal;
+        w.sensor = sensors.Add("wall" + std::to_string(walls.size()), w.tracker);
+        walls.push_back(w);
+    }
+
+    // Open tube along +z from the origin, faces pointing outward
+    PrimitiveMesh MakeSleeveMesh() const {
+        float h = hi.z - lo.z;
+        int n_theta = std::max(12, (int)std::ceil(2. * PI * radius / sleeve.edge_length));
+        int n_z = std::max(2, (int)std::ceil(h / sleeve.edge_length));
+        PrimitiveMesh mesh;
+        for (int j = 0; j <= n_z; j++) {
+            for (int i = 0; i < n_theta; i++) {
+                double a = 2. * PI * i / n_theta;
+                mesh.vertices.push_back(make_float3(radius * std::cos(a), radius * std::sin(a), h * j / n_z));
+            }
+        }
+        for (int j = 0; j < n_z; j++) {
+            for (int i = 0; i < n_theta; i++) {
+                int a = j * n_theta + i, b = j * n_theta + (i + 1) % n_theta;
+                int c = b + n_theta, d = a + n_theta;
+                mesh.faces.push_back(make_int3(a, b, c));
+                mesh.faces.push_back(make_int3(a, c, d));
+            }
+        }
+        return mesh;
+    }
+
+    float Extent(int axis) const {
+        float3 d = hi - lo;
+        return axis == 0 ? d.x : (axis == 1 ? d.y : d.z);
+    }
+
+    // Area of the faces normal to axis
+    double FaceArea(int axis) const {
+        if (shape == SPECIMEN_SHAPE::CYLINDER) {
+            double r = SleeveRadius();
+            return PI * r * r;
+        }
+        return (double)Extent((axis + 1) % 3) * Extent((axis + 2) % 3);
+    }
+
+    // Mean radius of the sleeve nodes
+    double SleeveRadius() const {
+        if (!membrane) {
+            return radius;
+        }
+        double sum = 0.;
+        for (const float3& p : membrane->GetNodes()) {
+            sum += std::sqrt(p.x * p.x + p.y * p.y);
+        }
+        return sum / membrane->GetNodes().size();
+    }
+
+    double Volume() const {
+        if (shape == SPECIMEN_SHAPE::CYLINDER) {
+            double r = SleeveRadius();
+            return PI * r * r * (hi.z - lo.z);
+        }
+        return (double)Extent(0) * Extent(1) * Extent(2);
+    }
+
+    // Compressive stress on a wall
+    double WallStress(const Wall& w) const {
+        return -dot(sensors.Get(w.sensor).force, w.normal) / FaceArea(w.axis);
+    }
+
+    // Outward speed of a servoed wall
+    double ServoSpeed(double stress, double target) const {
+        double cap = (max_wall_speed > 0.) ? max_wall_speed : 0.1 * std::min({Extent(0), Extent(1), Extent(2)});
+        double gain = (servo_gain > 0.) ? servo_gain : cap / std::max(std::abs(target), 1.);
+        return std::clamp(gain * (stress - target), -cap, cap);
+    }
+
+    // Move wall w outward (against its normal) by d
+    void MoveWall(Wall& w, double d) {
+        float3 shift = w.normal * (float)(-d);
+        bool low_side = (w.axis == 0 ? w.normal.x : (w.axis == 1 ? w.normal.y : w.normal.z)) > 0.f;
+        float3& face = low_side ? lo : hi;
+        face = face + shift;
+        w.tracker->SetPos(w.tracker->Pos() + shift);
+    }
+
+    void Control() {
+        sensors.Sample(time, false);
+        double bottom = WallStress(walls[0]), top = WallStress(walls[1]);
+        axial_stress = 0.5 * (bottom + top);
+        if (shape == SPECIMEN_SHAPE::BOX) {
+            lateral_stress = 0.;
+            for (size_t k = 2; k < walls.size(); k++) {
+                lateral_stress += WallStress(walls[k]) / 4.;
+            }
+        } else {
+            lateral_stress = lateral_target;
+        }
+
+        double strain = GetAxialStrain(), deviator = GetDeviatorStress();
+        history.push_back(Record{time, strain, GetVolumetricStrain(), axial_stress, lateral_stress});
+        if (deviator > peak_deviator) {
+            peak_deviator = deviator;
+            peak_strain = strain;
+        }
+
+        if (axial_control == WALL_CONTROL::STRESS) {
+            MoveWall(walls[0], ServoSpeed(bottom, axial_target) * control_dt);
+            MoveWall(walls[1], ServoSpeed(top, axial_target) * control_dt);
+        } else if (axial_control == WALL_CONTROL::STRAIN_RATE) {
+            MoveWall(walls[1], -axial_rate * height0 * control_dt);
+        }
+        if (shape == SPECIMEN_SHAPE::BOX && lateral_control == WALL_CONTROL::STRESS) {
+            for (size_t k = 2; k < walls.size(); k++) {
+                MoveWall(walls[k], ServoSpeed(WallStress(walls[k]), lateral_target) * control_dt);
+            }
+        }
+
+        if (membrane) {
+            // The sleeve's end rings follow the platens
+            float bottom_shift = lo.z - sleeve_base_z, top_shift = hi.z - (sleeve_base_z + sleeve_height);
+            for (size_t k = 0; k < bottom_ring.size(); k++) {
+                membrane->SetNodePosition(bottom_ring[k], ring_rest[k] + make_float3(0, 0, bottom_shift));
+            }
+            for (size_t k = 0; k < top_ring.size(); k++) {
+                float3 p = ring_rest[bottom_ring.size() + k] + make_float3(0, 0, top_shift);
+                membrane->SetNodePosition(top_ring[k], p);
+            }
+            size_t n = sleeve_tracker->GetContactForces(points, forces);
+            membrane->ApplyContactForces(points, forces, n, sleeve.edge_length);
+            membrane->Advance(control_dt);
+        }
+    }
+};
+
+#endif
@@ -18,36 +18,11 @@
 #include <filesystem>
 #include <random>
 
+#include "utils/Lattice.hpp"
+
 using namespace deme;
 using namespace std::filesystem;
 
-std::vector<float3> Generate2DTriangularLattice(float particleRadius, int layers) {
-    std::vector<float3> positions;
-    float diameter = 2.0f * particleRadius;
-    // Apply a 10% safety margin
-    float spacing = diameter * 1.1f;
-    float layerHeight = spacing * sqrt(3) / 2; // Vertical spacing for a triangular lattice
-
-    for (int layer = 0; layer < layers; ++layer) {
-        int particlesInLayer = layer % 2 == 0 ? 61 : 60;
-        // Determine the offset for this layer to stagger the particles
-        float offsetX = (layer % 2 == 0) ? 0 : spacing / 2;
-
-        for (int particle = 0; particle < particlesInLayer; ++particle) {
-            // Calculate positions, keeping Y constant as it's a 2D lattice
-            float x = particle * spacing + offsetX;
-            float z = layer * layerHeight; // Stack layers vertically
-            float3 position;
-            position.x = x;
-            position.y = 0.0f;
-            position.z = z;
-            positions.push_back(position);
-        }
-    }
-
-    return positions;
-}
-
 int main() {
     DEMSolver DEMSim;
     // Output less info at initialization
@@ -84,7 +59,10 @@ int main() {
     auto template_terrain = DEMSim.LoadSphereType(terrain_rad * terrain_rad * terrain_rad * 2.0e3 * 4 / 3 * PI,
                                                       terrain_rad, mat_type_terrain); 
 
-    auto latticePositions = Generate2DTriangularLattice(terrain_rad, layers);
+    // Rows of num_part_per_stack particles in the x-z plane; the staggered odd rows hold one less
+    LatticeGenerator<Triangular2D> lattice(spacing);
+    auto latticePositions = lattice.Generate(
+        make_float3(0), make_float3((num_part_per_stack - 0.75f) * spacing, 0, (layers - 0.5f) * spacing * sqrt(3) / 2));
    
     //add clumps                                               
     DEMSim.AddClumps(template_terrain, latticePositions);